@@ -1,11 +1,29 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <assert.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CSV_SCAN_X86
+#endif
 
 #define HASH_TABLE_LOAD_FACTOR 0.75
 
 #define CSV_MAX_LINE_SIZE 1024
+#define CSV_MAX_FIELDS 256
 #define CSV_SEPARATOR ','
 
 /* ======================================================================
@@ -67,13 +85,13 @@ size_t ask_size_t(const char* question)
  */
 
 /** ----------------------------------------------------------------------
- ** Hash a string for a given hashtable size.
+ ** Hash the first key_len characters of a key, which needs not be
+ ** terminated by '\0'.
  ** See http://en.wikipedia.org/wiki/Jenkins_hash_function
  **/
-size_t hash_function(const char* key, size_t size)
+size_t hash_bytes(const char* key, size_t key_len)
 {
     size_t hash = 0;
-    size_t key_len = strlen(key);
     for (size_t i = 0; i < key_len; ++i) {
         hash += (unsigned char) key[i];
         hash += (hash << 10);
@@ -83,525 +101,7324 @@ size_t hash_function(const char* key, size_t size)
     hash ^= (hash >> 11);
     hash += (hash << 15);
 
-    return hash % size;
+    return hash;
+}
+
+/** ----------------------------------------------------------------------
+ ** Hash a string for a given hashtable size.
+ **/
+size_t hash_function(const char* key, size_t size)
+{
+    return hash_bytes(key, strlen(key)) % size;
 }
 
 /* ****************************************
  * TODO : add your own code here.
  * **************************************** */
 
-/**
- * @brief Datastructure for type bucket with his key, his value,
- * 		  and the pointer to his next element in the linked list
- */
-struct bucket_struct {
-	
-	const char* key;
-	const void* value;
-	struct bucket_struct* next_elem;
-	
-};
+#define ARENA_CHUNK_SIZE 65536
+#define ARENA_ALIGNMENT 8
 
-typedef struct bucket_struct bucket;
+#define HTABLE_INITIAL_SIZE 1024
+#define HTABLE_MIGRATION_STEP 8
+#define HTABLE_ROW_LIST UINT32_MAX
+#define ROW_LIST_FIRST_CAPACITY 4
+
+#define DEFAULT_KEY_HASH hash_words
 
 /**
- * @brief Datastructure for type Htable with his size
- * 		  and the double pointer to his double dimension content
+ * @brief Type of the functions that hash a key for the hash table and
+ * 		  the join. The key needs not be terminated by '\0'. All the
+ * 		  64 bits of the hash must be well spread : the low ones pick
+ * 		  the slot and are kept in it, the high ones pick the partition
  */
-struct hashtable_struct {
-
-	size_t size;
-	struct bucket_struct** content;
-
-};
-
-typedef struct hashtable_struct Htable;
+typedef uint64_t (*key_hash_function)(const char* key, size_t key_len);
 
 /**
- * @brief Constructs a hash table with a given size
+ * @brief Multiplies two 64 bits numbers and folds the 128 bits product
+ * 		  into 64 bits, the mixing step of the word-at-a-time hash
  * 
- * @param size The size of the hash table which is also the
- * 		  maximum number of linked lists it can contains
+ * @param a The first number
+ * 		  b The second number
  */
-Htable* construct_Htable(size_t size) {
-	
-	Htable* new_hash_table = NULL;
+uint64_t hash_mix(uint64_t a, uint64_t b) {
+
+#if defined(__SIZEOF_INT128__)
 	
-	if (size < 1) return NULL;
+	__uint128_t product = (__uint128_t) a * b;
 	
-	new_hash_table = malloc(sizeof(Htable));
+	return (uint64_t) product ^ (uint64_t) (product >> 64);
 	
-	if (new_hash_table == NULL) return NULL;
+#else
 	
-	new_hash_table->size = size;
+	uint64_t a_high = a >> 32, a_low = (uint32_t) a;
+	uint64_t b_high = b >> 32, b_low = (uint32_t) b;
+	uint64_t high_high = a_high * b_high, high_low = a_high * b_low;
+	uint64_t low_high = a_low * b_high, low_low = a_low * b_low;
+	uint64_t middle = (low_low >> 32) + (uint32_t) high_low + low_high;
+	uint64_t low = (middle << 32) | (uint32_t) low_low;
+	uint64_t high = high_high + (high_low >> 32) + (middle >> 32);
 	
-	new_hash_table->content = calloc(size, sizeof(bucket*));
+	return low ^ high;
 	
-	if (new_hash_table->content == NULL) {
-		free(new_hash_table);
-		new_hash_table = NULL;
-		return NULL;
-	}
+#endif
+
+}
+
+/**
+ * @brief Reads 8 bytes of a key, which need not be aligned
+ * 
+ * @param bytes The first byte
+ */
+uint64_t hash_read64(const char* bytes) {
 	
-	int i;
+	uint64_t word = 0;
 	
-	for (i = 0; i < size; i++) {
-		new_hash_table->content[i] = NULL;
-	}
+	memcpy(&word, bytes, sizeof(word));
 	
-	return new_hash_table;
+	return word;
 	
 }
 
 /**
- * @brief Destructs a given hash table
+ * @brief Reads 4 bytes of a key, which need not be aligned
  * 
- * @param hash_table The hash table
+ * @param bytes The first byte
  */
-void delete_Htable_and_content(Htable** hash_table) {
+uint64_t hash_read32(const char* bytes) {
 	
-	if (*hash_table != NULL) {
+	uint32_t word = 0;
 	
-		int i;
+	memcpy(&word, bytes, sizeof(word));
 	
-		bucket* elem_to_delete = NULL;
+	return word;
 	
-		for(i = 0; i < (*hash_table)->size; i++) {
-			while((*hash_table)->content[i] != NULL) {
-				elem_to_delete = (*hash_table)->content[i];
-				(*hash_table)->content[i] = (*hash_table)->content[i]->next_elem;
-				free((void*) elem_to_delete->value);
-				elem_to_delete->value = NULL;
-				free((char*) elem_to_delete->key);
-				elem_to_delete->key = NULL;
-				free(elem_to_delete);
-				elem_to_delete = NULL;
-			}
-		}
+}
 
-		free((*hash_table)->content);
-		(*hash_table)->content = NULL;
+/**
+ * @brief Hashes a key 16 bytes at a time, in the way of wyhash : each
+ * 		  pair of 8 bytes words is mixed with a 64 x 64 bits product.
+ * 		  Keys of up to 16 bytes, the usual join keys, are read with
+ * 		  at most four overlapping loads and no loop. The default hash
+ * 		  of the join
+ * 
+ * @param key The key
+ * 		  key_len The length of the key
+ */
+uint64_t hash_words(const char* key, size_t key_len) {
 	
-		free(*hash_table);
-		*hash_table = NULL;
+	const uint64_t secret0 = 0xa0761d6478bd642fULL;
+	const uint64_t secret1 = 0xe7037ed1a0b428dbULL;
+	const uint64_t secret2 = 0x8ebc6af09c88c6e3ULL;
+	uint64_t seed = secret0;
+	uint64_t a = 0;
+	uint64_t b = 0;
+	size_t left = key_len;
 	
+	if (key_len <= 16) {
+		if (key_len >= 4) {
+			a = (hash_read32(key) << 32) | hash_read32(&key[(key_len >> 3) << 2]);
+			b = (hash_read32(&key[key_len - 4]) << 32) | hash_read32(&key[key_len - 4 - ((key_len >> 3) << 2)]);
+		} else if (key_len > 0) {
+			a = ((uint64_t) (unsigned char) key[0] << 16) | ((uint64_t) (unsigned char) key[key_len >> 1] << 8) | (unsigned char) key[key_len - 1];
+		}
+	} else {
+		while (left > 16) {
+			seed = hash_mix(hash_read64(key) ^ secret1, hash_read64(&key[8]) ^ seed);
+			key += 16;
+			left -= 16;
+		}
+		a = hash_read64(&key[left - 16]);
+		b = hash_read64(&key[left - 8]);
 	}
 	
+	return hash_mix(secret1 ^ key_len, hash_mix(a ^ secret1, b ^ seed ^ secret2));
+	
 }
 
 /**
- * @brief Adds an element to the hash table which will create a linked
- * 		  list, or will be put at the end of a linked list, except 
- * 		  if the key already exists in the hash table, then the 
- * 		  value will be overwritten
+ * @brief Hashes a key with the Jenkins one-at-a-time hash of
+ * 		  hash_bytes, whose result is spread over 64 bits by the
+ * 		  finalizer of MurmurHash3. Slower than hash_words, kept as
+ * 		  an alternative for the join
  * 
- * @param hash_table The given hash table
- * 		  key The given key of the element
- * 		  value The given value of the element
+ * @param key The key
+ * 		  key_len The length of the key
  */
-void add_Htable_value(Htable* hash_table, const char* key, const void* value) {
+uint64_t hash_jenkins(const char* key, size_t key_len) {
 	
-	if (hash_table != NULL && key != NULL && value != NULL) {
+	uint64_t hash = hash_bytes(key, key_len);
 	
-		int hash_key_value = hash_function(key, hash_table->size);
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
 	
-		bucket* current_elem = NULL;
-		bucket* previous_elem = NULL;
-		bucket* added_pair = NULL;
+	return hash;
 	
-		current_elem = hash_table->content[hash_key_value];
+}
+
+/**
+ * @brief Returns the largest power of two that is not above a number,
+ * 		  or 1 for 0
+ * 
+ * @param n The number
+ */
+size_t round_down_power_of_two(size_t n) {
 	
-		while (current_elem != NULL && strcmp(key, current_elem->key) != 0) {
-			previous_elem = current_elem;
-			current_elem = current_elem->next_elem;
-		}
+	size_t power = 1;
 	
-		if (current_elem != NULL) {
-			current_elem->value = value;
-		} else {
-			added_pair = malloc(sizeof(bucket));
-			if (added_pair != NULL) {
-				added_pair->key = key;
-				added_pair->value = value;
-				added_pair->next_elem = NULL;
-				if (previous_elem == NULL) hash_table->content[hash_key_value] = added_pair;
-				else previous_elem->next_elem = added_pair;
-			}
-		}
+	while (power <= n / 2) power *= 2;
 	
-	}
+	return power;
 	
 }
 
 /**
- * @brief Returns the element which has the given key 
- * 		  or NULL if it doesn't exist in the hash table
+ * @brief Returns the smallest power of two that is not below a number,
+ * 		  or 1 for 0
  * 
- * @param hash_table The given hash table
- * 		  key The key of the element we want to find
+ * @param n The number
  */
-const void* get_Htable_value(Htable* hash_table, const char* key) {
-	
-	if (hash_table != NULL && key != NULL) {
+size_t round_up_power_of_two(size_t n) {
 	
-		int hash_key_value = hash_function(key, hash_table->size);
+	size_t power = round_down_power_of_two(n);
 	
-		bucket* current_elem = NULL;
+	return power < n ? 2 * power : power;
 	
-		current_elem = hash_table->content[hash_key_value];
+}
+
+/**
+ * @brief Datastructure for type memory_accountant, which counts the
+ * 		  bytes currently held by the build side of a join against
+ * 		  its budget, and the highest count reached
+ */
+struct memory_accountant_struct {
 	
-		while (current_elem != NULL && strcmp(key, current_elem->key) != 0) {
-			current_elem = current_elem->next_elem;
-		}
+	size_t budget;
+	size_t current;
+	size_t peak;
 	
-		if (current_elem != NULL) {
-			return current_elem->value;
-		}
+};
+
+typedef struct memory_accountant_struct memory_accountant;
+
+/**
+ * @brief Records that some bytes were allocated
+ * 
+ * @param accountant The accountant, which may be NULL
+ * 		  bytes The number of bytes
+ */
+void account_alloc(memory_accountant* accountant, size_t bytes) {
 	
+	if (accountant != NULL) {
+		accountant->current += bytes;
+		if (accountant->current > accountant->peak) accountant->peak = accountant->current;
 	}
 	
-	return NULL;
-	
 }
 
-/* ======================================================================
- * Provided: CSV file parser
- * ======================================================================
+/**
+ * @brief Records that some bytes were freed
+ * 
+ * @param accountant The accountant, which may be NULL
+ * 		  bytes The number of bytes
  */
-
-typedef char* csv_row;
-typedef const char* csv_const_row;
-
-/** ----------------------------------------------------------------------
- ** Allocate and read a CSV row from a file
- **/
-csv_row read_row(FILE* f)
-{
-    char line[CSV_MAX_LINE_SIZE + 1] = "";
-    fgets(line, CSV_MAX_LINE_SIZE, f);
-    line[strcspn(line, "\r\n")] = '\0'; // remove trailing '\n'
-    size_t len = strlen(line);
-
-    assert(len < CSV_MAX_LINE_SIZE); /* We should not have lines that long...
-                                      * Not handled in this homework anyway!
-                                      * Should be properly handled in real-life appli.
-                                      */
-
-    csv_row row;
-    if ((row = calloc(len + 1, sizeof(char))) == NULL) {
-        return NULL;
-    }
-    strncpy(row, line, len);
-
-    return row;
+void account_free(memory_accountant* accountant, size_t bytes) {
+	
+	if (accountant != NULL) accountant->current -= bytes;
+	
 }
 
-/** ----------------------------------------------------------------------
- ** Write a CSV row to a file
- **/
-void write_row(FILE* out, const csv_const_row row, size_t ignore_index)
-{
-    size_t len = strlen(row);
-    size_t current_element = 0;
-    for (size_t i = 0; i < len; ++i) {
-        if (row[i] == CSV_SEPARATOR) {
-            ++current_element;
-        }
-        if (current_element != ignore_index && (current_element != ignore_index + 1 || row[i] != CSV_SEPARATOR)) {
-            fprintf(out, "%c", row[i]);
-        }
-    }
+/**
+ * @brief Tells if some more bytes can be allocated without going
+ * 		  over the budget
+ * 
+ * @param accountant The accountant, which may be NULL
+ * 		  bytes The number of bytes
+ */
+int account_fits(const memory_accountant* accountant, size_t bytes) {
+	
+	return accountant == NULL || accountant->current + bytes <= accountant->budget;
+	
 }
 
-/** ----------------------------------------------------------------------
- ** Write 2 CSV rows side-by-side to a file
- **/
-void write_rows(FILE* out, const csv_const_row row1, const csv_const_row row2, size_t ignore_index)
-{
-    write_row(out, row1, (size_t) -1);
-    fprintf(out, "%c", CSV_SEPARATOR);
-    write_row(out, row2, ignore_index);
-    fprintf(out, "\n");
-}
+/**
+ * @brief Datastructure for type arena_chunk, a contiguous piece of
+ * 		  memory of an arena with his size, the number of bytes
+ * 		  already given out, and the pointer to the next chunk
+ */
+struct arena_chunk_struct {
+	
+	struct arena_chunk_struct* next;
+	size_t size;
+	size_t used;
+	char data[];
+	
+};
 
-/** ----------------------------------------------------------------------
- ** Copy and return the i'th element in the row
- **/
-char* row_element(const csv_const_row row, size_t index)
-{
-    size_t len = strlen(row);
-    size_t start = 0, end = 0;
-    size_t current_element = 0;
-    for (size_t i = 0; i < len; ++i) {
-        if (row[i] == CSV_SEPARATOR || i == len - 1) {
-            ++current_element;
-            if (current_element == index) {
-                start = i + 1;
-            } else if (current_element == index + 1) {
-                end = (i == len - 1) ? len : i;
-                break;
-            }
-        }
-    }
+typedef struct arena_chunk_struct arena_chunk;
 
-    if (end > 0) { // success
-        size_t elem_len = end - start;
-        char* element;
-        if ((element = calloc(elem_len + 1, sizeof(char))) == NULL) {
-            return NULL;
-        }
-        element[elem_len] = '\0';
-        strncpy(element, &row[start], elem_len);
-        return element;
-    } else {
-        return NULL;
-    }
-}
+/**
+ * @brief Datastructure for type Arena, a bump allocator : memory is
+ * 		  carved from chunks one after the other and is only given
+ * 		  back all at once. Every chunk, header included, is counted
+ * 		  by the accountant of the arena
+ */
+struct arena_struct {
+	
+	size_t chunk_size;
+	memory_accountant* accountant;
+	arena_chunk* first;
+	arena_chunk* current;
+	
+};
 
+typedef struct arena_struct Arena;
 
-/* ======================================================================
- * Part II -- Hashjoin
- * ======================================================================
+/**
+ * @brief Initializes an empty arena, no memory is taken before
+ * 		  the first allocation
+ * 
+ * @param arena The arena
+ * 		  chunk_size The usual size of its chunks
+ * 		  accountant The accountant of its chunks, which may be NULL
  */
+void init_Arena(Arena* arena, size_t chunk_size, memory_accountant* accountant) {
+	
+	arena->chunk_size = chunk_size > 0 ? chunk_size : 1;
+	arena->accountant = accountant;
+	arena->first = NULL;
+	arena->current = NULL;
+	
+}
 
-/* ****************************************
- * TODO : add your own code here.
- * **************************************** */
+/**
+ * @brief Returns the number of bytes the arena would have to take from
+ * 		  the system to give out a block of the given size
+ * 
+ * @param arena The arena
+ * 		  size The size of the block
+ */
+size_t arena_cost(const Arena* arena, size_t size) {
+	
+	const arena_chunk* next_chunk = NULL;
+	
+	size = (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+	
+	if (arena->current != NULL && arena->current->size - arena->current->used >= size) return 0;
+	
+	next_chunk = (arena->current == NULL) ? arena->first : arena->current->next;
+	if (next_chunk != NULL && next_chunk->size >= size) return 0;
+	
+	return sizeof(arena_chunk) + (size > arena->chunk_size ? size : arena->chunk_size);
+	
+}
 
 /**
- * @brief Join two files thanks to their column of the same 
- * 		  type of content
+ * @brief Returns a block of memory of the given size from the arena,
+ * 		  or NULL if a new chunk could not be allocated. A request
+ * 		  bigger than the usual chunk size gets a chunk of its own
  * 
- * @param first_file The file that has unique key values
- * 		  second_file The file that can have several same key values
- * 		  output_file The file where the result is written
- * 		  column_first_file The index of the first file's join column
- * 		  column_second_file The index of the second file's join column
- * 		  max_memory The maximum authorized memory in the hash table
+ * @param arena The arena
+ * 		  size The size of the block
  */
-int hash_join(FILE* first_file, FILE* second_file, FILE* output_file, size_t column_first_file, size_t column_second_file, size_t max_memory) {
+void* arena_alloc(Arena* arena, size_t size) {
 	
-	if (first_file == NULL || second_file == NULL || output_file == NULL) {
-		fprintf(stderr, "Un ou plusieurs fichiers déstinés à être écrits ou lus sont invalides");
-		return 9;
+	arena_chunk* next_chunk = NULL;
+	arena_chunk* new_chunk = NULL;
+	size_t chunk_size = 0;
+	void* block = NULL;
+	
+	size = (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+	
+	if (arena->current == NULL || arena->current->size - arena->current->used < size) {
+		
+		/* Chunks kept by a reset are used again before asking for new ones */
+		
+		next_chunk = (arena->current == NULL) ? arena->first : arena->current->next;
+		
+		if (next_chunk != NULL && next_chunk->size >= size) {
+			arena->current = next_chunk;
+		} else {
+			chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+			new_chunk = malloc(sizeof(arena_chunk) + chunk_size);
+			if (new_chunk == NULL) return NULL;
+			new_chunk->size = chunk_size;
+			new_chunk->used = 0;
+			new_chunk->next = next_chunk;
+			account_alloc(arena->accountant, sizeof(arena_chunk) + chunk_size);
+			if (arena->current == NULL) arena->first = new_chunk;
+			else arena->current->next = new_chunk;
+			arena->current = new_chunk;
+		}
+		
 	}
 	
-	Htable* hash_table = NULL;
-	const void* found_elem = NULL;
+	block = arena->current->data + arena->current->used;
+	arena->current->used += size;
 	
-	csv_row row1 = NULL;
-	csv_row row2 = NULL;
-	char* id1 = NULL;
-	char* id2 = NULL;
+	return block;
+	
+}
+
+/**
+ * @brief Gives back at once everything allocated in the arena,
+ * 		  only its first chunk is kept to be used again
+ * 
+ * @param arena The arena
+ */
+void reset_Arena(Arena* arena) {
 	
-	int count = 0;
-	size_t size_given = max_memory/sizeof(bucket);
+	arena_chunk* chunk_to_delete = NULL;
 	
-	if (size_given == 0) {
-		fprintf(stderr, "Mémoire maximum autorisée insuffisante pour la hash table\n");
-		return 8;
+	if (arena->first != NULL) {
+		while (arena->first->next != NULL) {
+			chunk_to_delete = arena->first->next;
+			arena->first->next = chunk_to_delete->next;
+			account_free(arena->accountant, sizeof(arena_chunk) + chunk_to_delete->size);
+			free(chunk_to_delete);
+			chunk_to_delete = NULL;
+		}
+		arena->first->used = 0;
 	}
 	
-	row1 = read_row(first_file);
-	if (row1 == NULL) {
-		fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du premier fichier\n");
-		return 3;
+	arena->current = NULL;
+	
+}
+
+/**
+ * @brief Frees all the chunks of the arena
+ * 
+ * @param arena The arena
+ */
+void delete_Arena_content(Arena* arena) {
+	
+	arena_chunk* chunk_to_delete = NULL;
+	
+	while (arena->first != NULL) {
+		chunk_to_delete = arena->first;
+		arena->first = arena->first->next;
+		account_free(arena->accountant, sizeof(arena_chunk) + chunk_to_delete->size);
+		free(chunk_to_delete);
+		chunk_to_delete = NULL;
 	}
-	if (ferror(first_file) != 0) {
-		fprintf(stderr, "Erreur dans la lecture du premier fichier\n");
+	
+	arena->current = NULL;
+	
+}
+
+/**
+ * @brief Datastructure for type bucket, which is one slot of the open
+ * 		  addressing table : the low 32 bits of the hash of the key,
+ * 		  which also give its slot, the distance of the slot from that
+ * 		  one, the key and the value with their lengths. Keys need not
+ * 		  be terminated by '\0'. An empty slot has a NULL key. A slot
+ * 		  takes 32 bytes, two of them fit in a cache line
+ */
+struct bucket_struct {
+	
+	uint32_t hash;
+	uint32_t distance;
+	uint32_t key_len;
+	uint32_t value_len;
+	const char* key;
+	const void* value;
+	
+};
+
+typedef struct bucket_struct bucket;
+
+/**
+ * @brief Datastructure for type Htable with his size, a power of two,
+ * 		  the size up to which he may grow, his number of elements,
+ * 		  the flat array of his slots, the arena in which the keys and
+ * 		  values of a join block are stored, the accountant of all his
+ * 		  memory, and the function that hashes his keys. While the
+ * 		  table grows, the slots of the previous array are moved to
+ * 		  the new one a few at a time, those before migrated are
+ * 		  already moved
+ */
+struct hashtable_struct {
+	
+	size_t size;
+	size_t max_size;
+	size_t count;
+	struct bucket_struct* content;
+	Arena arena;
+	memory_accountant* accountant;
+	key_hash_function key_hash;
+	
+	struct bucket_struct* old_content;
+	size_t old_size;
+	size_t migrated;
+	
+};
+
+typedef struct hashtable_struct Htable;
+
+/**
+ * @brief Constructs a hash table with a given initial size, whose
+ * 		  arena is made of chunks of the given size, and whose memory
+ * 		  is counted by the given accountant. The table doubles its
+ * 		  size when its load factor is reached, up to its maximum
+ * 		  size and as long as the new slots fit in the budget of the
+ * 		  accountant. The initial size is rounded up and the maximum
+ * 		  size down to a power of two, so that a slot is picked by
+ * 		  masking the hash. The keys are hashed by DEFAULT_KEY_HASH
+ * 
+ * @param size The initial size of the hash table
+ * 		  max_size The size up to which it may grow
+ * 		  chunk_size The usual size of the chunks of the arena
+ * 		  accountant The accountant, which may be NULL
+ */
+Htable* construct_Htable_with_chunks(size_t size, size_t max_size, size_t chunk_size, memory_accountant* accountant) {
+	
+	Htable* new_hash_table = NULL;
+	
+	if (size < 1) return NULL;
+	
+	new_hash_table = malloc(sizeof(Htable));
+	
+	if (new_hash_table == NULL) return NULL;
+	
+	size = round_up_power_of_two(size);
+	max_size = round_down_power_of_two(max_size);
+	
+	new_hash_table->size = size;
+	new_hash_table->max_size = max_size > size ? max_size : size;
+	new_hash_table->count = 0;
+	new_hash_table->accountant = accountant;
+	new_hash_table->key_hash = DEFAULT_KEY_HASH;
+	new_hash_table->old_content = NULL;
+	new_hash_table->old_size = 0;
+	new_hash_table->migrated = 0;
+	init_Arena(&new_hash_table->arena, chunk_size, accountant);
+	
+	/* calloc gives NULL keys, so every slot starts empty */
+	
+	new_hash_table->content = calloc(size, sizeof(bucket));
+	
+	if (new_hash_table->content == NULL) {
+		free(new_hash_table);
+		new_hash_table = NULL;
+		return NULL;
+	}
+	
+	account_alloc(accountant, sizeof(Htable) + size * sizeof(bucket));
+	
+	return new_hash_table;
+	
+}
+
+/**
+ * @brief Constructs a hash table with a given initial size, which
+ * 		  grows without limit
+ * 
+ * @param size The initial size of the hash table
+ */
+Htable* construct_Htable(size_t size) {
+	
+	return construct_Htable_with_chunks(size, SIZE_MAX / 2 / sizeof(bucket), ARENA_CHUNK_SIZE, NULL);
+	
+}
+
+/**
+ * @brief Frees the previous array of slots of a growing hash table
+ * 
+ * @param hash_table The hash table
+ */
+void free_Htable_old_content(Htable* hash_table) {
+	
+	if (hash_table->old_content != NULL) {
+		account_free(hash_table->accountant, hash_table->old_size * sizeof(bucket));
+		free(hash_table->old_content);
+		hash_table->old_content = NULL;
+		hash_table->old_size = 0;
+		hash_table->migrated = 0;
+	}
+	
+}
+
+/**
+ * @brief Empties a hash table in one go : the slots are cleared and
+ * 		  everything allocated in its arena is given back, so that
+ * 		  the next block can reuse the same memory
+ * 
+ * @param hash_table The hash table
+ */
+void clear_Htable(Htable* hash_table) {
+	
+	free_Htable_old_content(hash_table);
+	memset(hash_table->content, 0, hash_table->size * sizeof(bucket));
+	hash_table->count = 0;
+	reset_Arena(&hash_table->arena);
+	
+}
+
+/**
+ * @brief Destructs a given hash table and frees its arena, thus all the
+ * 		  keys and values that were allocated in it
+ * 
+ * @param hash_table The hash table
+ */
+void delete_Htable_and_content(Htable** hash_table) {
+	
+	if (*hash_table != NULL) {
+		
+		free_Htable_old_content(*hash_table);
+		delete_Arena_content(&(*hash_table)->arena);
+		account_free((*hash_table)->accountant, sizeof(Htable) + (*hash_table)->size * sizeof(bucket));
+		
+		free((*hash_table)->content);
+		(*hash_table)->content = NULL;
+		
+		free(*hash_table);
+		*hash_table = NULL;
+		
+	}
+	
+}
+
+/**
+ * @brief Tells if a slot holds the given key. The cached hash and
+ * 		  the length reject almost every other key before the bytes
+ * 		  are compared
+ * 
+ * @param slot The slot
+ * 		  hash The hash of the key
+ * 		  key The key
+ * 		  key_len The length of the key
+ */
+int bucket_has_key(const bucket* slot, uint32_t hash, const char* key, size_t key_len) {
+	
+	return slot->hash == hash && slot->key_len == key_len && memcmp(slot->key, key, key_len) == 0;
+	
+}
+
+/**
+ * @brief Returns the slot of an array that holds the given key or
+ * 		  NULL if there is none. The probe can stop as soon as it
+ * 		  meets an element closer to its own slot than the key would be
+ * 
+ * @param content The array of slots
+ * 		  size The size of the array, a power of two
+ * 		  hash The low 32 bits of the hash of the key
+ * 		  key The key
+ * 		  key_len The length of the key
+ */
+bucket* find_slot(bucket* content, size_t size, uint32_t hash, const char* key, size_t key_len) {
+	
+	size_t index = hash & (size - 1);
+	uint32_t distance = 0;
+	
+	while (content[index].key != NULL && content[index].distance >= distance) {
+		if (bucket_has_key(&content[index], hash, key, key_len)) {
+			return &content[index];
+		}
+		index = (index + 1 == size) ? 0 : index + 1;
+		distance++;
+	}
+	
+	return NULL;
+	
+}
+
+/**
+ * @brief Places an element in the array of a hash table with Robin
+ * 		  Hood linear probing : an element that is further from its
+ * 		  slot than the one it meets takes its place, and the displaced
+ * 		  one goes on probing. If the key is checked and already exists,
+ * 		  its value is overwritten instead. The array must have an
+ * 		  empty slot. Returns 1 if a slot was taken, 0 otherwise
+ * 
+ * @param hash_table The hash table
+ * 		  added_pair The element
+ * 		  check_key Whether the key may already be in the array
+ */
+int place_Htable_slot(Htable* hash_table, bucket added_pair, int check_key) {
+	
+	size_t index = added_pair.hash & (hash_table->size - 1);
+	bucket displaced_pair;
+	bucket* current_elem = NULL;
+	
+	added_pair.distance = 0;
+	
+	while (1) {
+		
+		current_elem = &hash_table->content[index];
+		
+		if (current_elem->key == NULL) {
+			*current_elem = added_pair;
+			return 1;
+		}
+		
+		/* Once an element has been displaced, the key is known to be new */
+		
+		if (check_key != 0 && bucket_has_key(current_elem, added_pair.hash, added_pair.key, added_pair.key_len)) {
+			current_elem->value = added_pair.value;
+			current_elem->value_len = added_pair.value_len;
+			return 0;
+		}
+		
+		if (current_elem->distance < added_pair.distance) {
+			displaced_pair = *current_elem;
+			*current_elem = added_pair;
+			added_pair = displaced_pair;
+			check_key = 0;
+		}
+		
+		index = (index + 1 == hash_table->size) ? 0 : index + 1;
+		added_pair.distance++;
+		
+	}
+	
+}
+
+/**
+ * @brief Moves some slots of the previous array of a growing hash
+ * 		  table to the new one, and frees the previous array once
+ * 		  every slot has been moved
+ * 
+ * @param hash_table The hash table
+ * 		  nb_slots The number of slots to move
+ */
+void migrate_Htable_slots(Htable* hash_table, size_t nb_slots) {
+	
+	while (hash_table->old_content != NULL && nb_slots > 0) {
+		
+		if (hash_table->old_content[hash_table->migrated].key != NULL) {
+			place_Htable_slot(hash_table, hash_table->old_content[hash_table->migrated], 0);
+		}
+		hash_table->migrated++;
+		nb_slots--;
+		
+		if (hash_table->migrated == hash_table->old_size) free_Htable_old_content(hash_table);
+		
+	}
+	
+}
+
+/**
+ * @brief Moves every slot left in the previous array of a growing
+ * 		  hash table, so that lookups only look in one array
+ * 
+ * @param hash_table The hash table
+ */
+void finish_Htable_growth(Htable* hash_table) {
+	
+	if (hash_table->old_content != NULL) migrate_Htable_slots(hash_table, hash_table->old_size - hash_table->migrated);
+	
+}
+
+/**
+ * @brief Returns the size a hash table grows to when its load factor
+ * 		  is reached, which is its size if it cannot grow any more
+ * 
+ * @param hash_table The hash table
+ */
+size_t Htable_next_size(const Htable* hash_table) {
+	
+	return 2 * hash_table->size < hash_table->max_size ? 2 * hash_table->size : hash_table->max_size;
+	
+}
+
+/**
+ * @brief Tells if one more element would take a hash table over its
+ * 		  load factor
+ * 
+ * @param hash_table The hash table
+ */
+int Htable_is_loaded(const Htable* hash_table) {
+	
+	return hash_table->old_content == NULL && hash_table->count + 1 > hash_table->size * HASH_TABLE_LOAD_FACTOR;
+	
+}
+
+/**
+ * @brief Returns the number of bytes a hash table would have to take
+ * 		  to add one more element : the slots of the bigger array
+ * 		  when the load factor is reached, 0 otherwise
+ * 
+ * @param hash_table The hash table
+ */
+size_t Htable_growth_cost(const Htable* hash_table) {
+	
+	if (Htable_is_loaded(hash_table) == 0) return 0;
+	
+	return (Htable_next_size(hash_table) > hash_table->size) ? Htable_next_size(hash_table) * sizeof(bucket) : 0;
+	
+}
+
+/**
+ * @brief Starts the growth of a hash table to twice its size, or its
+ * 		  maximum size, if the new slots fit in the budget : the new
+ * 		  array becomes the one
+ * 		  where elements are added, and the slots of the previous one
+ * 		  are moved HTABLE_MIGRATION_STEP at a time by the next
+ * 		  insertions, so that no insertion has to move them all
+ * 
+ * @param hash_table The hash table
+ */
+void grow_Htable(Htable* hash_table) {
+	
+	size_t new_size = Htable_next_size(hash_table);
+	bucket* new_content = NULL;
+	
+	if (new_size <= hash_table->size || account_fits(hash_table->accountant, new_size * sizeof(bucket)) == 0) return;
+	
+	new_content = calloc(new_size, sizeof(bucket));
+	if (new_content == NULL) return;
+	
+	account_alloc(hash_table->accountant, new_size * sizeof(bucket));
+	
+	/* The accountant counts the new array with the table itself, and the previous one apart */
+	
+	hash_table->old_content = hash_table->content;
+	hash_table->old_size = hash_table->size;
+	hash_table->migrated = 0;
+	hash_table->content = new_content;
+	hash_table->size = new_size;
+	
+}
+
+/**
+ * @brief Adds an element whose key has already been hashed to the hash
+ * 		  table, see place_Htable_slot. If the key already exists in
+ * 		  the hash table, then the value will be overwritten. The table
+ * 		  grows when its load factor is reached, and nothing is added
+ * 		  when it is full and cannot grow
+ * 
+ * @param hash_table The given hash table
+ * 		  hash The hash of the key by the function of the table
+ * 		  key The given key of the element
+ * 		  key_len The length of the key
+ * 		  value The given value of the element
+ * 		  value_len The length of the value
+ */
+void add_Htable_entry_hashed(Htable* hash_table, uint64_t hash, const char* key, size_t key_len, const void* value, size_t value_len) {
+	
+	bucket added_pair = { (uint32_t) hash, 0, key_len, value_len, key, value };
+	bucket* found_elem = NULL;
+	
+	if (hash_table != NULL && key != NULL && value != NULL) {
+		
+		if (Htable_growth_cost(hash_table) > 0) grow_Htable(hash_table);
+		migrate_Htable_slots(hash_table, HTABLE_MIGRATION_STEP);
+		
+		/* A key of the previous array that is not moved yet is updated where it is */
+		
+		if (hash_table->old_content != NULL) {
+			found_elem = find_slot(hash_table->old_content, hash_table->old_size, added_pair.hash, key, key_len);
+			if (found_elem != NULL && (size_t) (found_elem - hash_table->old_content) >= hash_table->migrated) {
+				found_elem->value = value;
+				found_elem->value_len = value_len;
+				return;
+			}
+		}
+		
+		if (hash_table->count >= hash_table->size) {
+			found_elem = find_slot(hash_table->content, hash_table->size, added_pair.hash, key, key_len);
+			if (found_elem != NULL) {
+				found_elem->value = value;
+				found_elem->value_len = value_len;
+			}
+			return;
+		}
+		
+		hash_table->count += place_Htable_slot(hash_table, added_pair, 1);
+		
+	}
+	
+}
+
+/**
+ * @brief Adds an element to the hash table, see add_Htable_entry_hashed
+ * 
+ * @param hash_table The given hash table
+ * 		  key The given key of the element
+ * 		  key_len The length of the key
+ * 		  value The given value of the element
+ * 		  value_len The length of the value
+ */
+void add_Htable_entry(Htable* hash_table, const char* key, size_t key_len, const void* value, size_t value_len) {
+	
+	if (hash_table != NULL && key != NULL) add_Htable_entry_hashed(hash_table, hash_table->key_hash(key, key_len), key, key_len, value, value_len);
+	
+}
+
+/**
+ * @brief Adds an element to the hash table, see add_Htable_entry
+ * 
+ * @param hash_table The given hash table
+ * 		  key The given key of the element
+ * 		  value The given value of the element
+ */
+void add_Htable_value(Htable* hash_table, const char* key, const void* value) {
+	
+	if (key != NULL) add_Htable_entry(hash_table, key, strlen(key), value, 0);
+	
+}
+
+/**
+ * @brief Returns the slot of the element which has the given already
+ * 		  hashed key or NULL if it doesn't exist in the hash table.
+ * 		  While the table grows, the previous array is looked into too
+ * 
+ * @param hash_table The given hash table
+ * 		  hash The hash of the key by the function of the table
+ * 		  key The key of the element we want to find
+ * 		  key_len The length of the key
+ */
+const bucket* get_Htable_entry_hashed(const Htable* hash_table, uint64_t hash, const char* key, size_t key_len) {
+	
+	const bucket* found_elem = NULL;
+	
+	if (hash_table != NULL && key != NULL) {
+		found_elem = find_slot(hash_table->content, hash_table->size, hash, key, key_len);
+		if (found_elem == NULL && hash_table->old_content != NULL) {
+			found_elem = find_slot(hash_table->old_content, hash_table->old_size, hash, key, key_len);
+		}
+	}
+	
+	return found_elem;
+	
+}
+
+/**
+ * @brief Returns the slot of the element which has the given
+ * 		  key or NULL if it doesn't exist in the hash table
+ * 
+ * @param hash_table The given hash table
+ * 		  key The key of the element we want to find
+ * 		  key_len The length of the key
+ */
+const bucket* get_Htable_entry(const Htable* hash_table, const char* key, size_t key_len) {
+	
+	return (hash_table != NULL && key != NULL) ? get_Htable_entry_hashed(hash_table, hash_table->key_hash(key, key_len), key, key_len) : NULL;
+	
+}
+
+/**
+ * @brief Returns the element which has the given key 
+ * 		  or NULL if it doesn't exist in the hash table
+ * 
+ * @param hash_table The given hash table
+ * 		  key The key of the element we want to find
+ */
+const void* get_Htable_value(Htable* hash_table, const char* key) {
+	
+	const bucket* found_elem = NULL;
+	
+	if (key != NULL) found_elem = get_Htable_entry(hash_table, key, strlen(key));
+	
+	return found_elem != NULL ? found_elem->value : NULL;
+	
+}
+
+/**
+ * @brief Datastructure for type row_view, a value kept out of a hash
+ * 		  table, seen through its first byte and its length
+ */
+struct row_view_struct {
+	
+	const char* row;
+	size_t len;
+	
+};
+
+typedef struct row_view_struct row_view;
+
+/**
+ * @brief Datastructure for type row_list, the values of a key added
+ * 		  several times with add_Htable_row_hashed : their number, how
+ * 		  many fit before the list is moved, and the values one after
+ * 		  the other in the arena of the table, so that they are read
+ * 		  in a row. A slot whose value_len is HTABLE_ROW_LIST points
+ * 		  to a row_list instead of a single value
+ */
+struct row_list_struct {
+	
+	uint32_t count;
+	uint32_t capacity;
+	row_view rows[];
+	
+};
+
+typedef struct row_list_struct row_list;
+
+/**
+ * @brief Returns the number of values of a slot
+ * 
+ * @param slot The slot
+ */
+size_t bucket_nb_rows(const bucket* slot) {
+	
+	return slot->value_len == HTABLE_ROW_LIST ? ((const row_list*) slot->value)->count : 1;
+	
+}
+
+/**
+ * @brief Returns a copy of a slot that holds only one of its values
+ * 
+ * @param slot The slot
+ * 		  i The index of the value, below bucket_nb_rows
+ */
+bucket bucket_row(const bucket* slot, size_t i) {
+	
+	bucket single = *slot;
+	const row_list* list = NULL;
+	
+	if (slot->value_len == HTABLE_ROW_LIST) {
+		list = slot->value;
+		single.value = list->rows[i].row;
+		single.value_len = list->rows[i].len;
+	}
+	
+	return single;
+	
+}
+
+/**
+ * @brief Returns the slot where a key lives in a hash table or NULL if
+ * 		  it doesn't exist : while the table grows, a key of the
+ * 		  previous array that is not moved yet lives there
+ * 
+ * @param hash_table The hash table
+ * 		  hash The low 32 bits of the hash of the key
+ * 		  key The key
+ * 		  key_len The length of the key
+ */
+bucket* find_Htable_slot(Htable* hash_table, uint32_t hash, const char* key, size_t key_len) {
+	
+	bucket* found_elem = NULL;
+	
+	if (hash_table->old_content != NULL) {
+		found_elem = find_slot(hash_table->old_content, hash_table->old_size, hash, key, key_len);
+		if (found_elem != NULL && (size_t) (found_elem - hash_table->old_content) >= hash_table->migrated) return found_elem;
+	}
+	
+	return find_slot(hash_table->content, hash_table->size, hash, key, key_len);
+	
+}
+
+/**
+ * @brief Returns the number of bytes the next add_Htable_row_hashed
+ * 		  of a key takes from the arena of a hash table : a new list
+ * 		  when the key has one value or a full list, nothing otherwise
+ * 
+ * @param hash_table The hash table
+ * 		  hash The hash of the key by the function of the table
+ * 		  key The key
+ * 		  key_len The length of the key
+ */
+size_t Htable_row_cost(Htable* hash_table, uint64_t hash, const char* key, size_t key_len) {
+	
+	const bucket* found_elem = find_Htable_slot(hash_table, (uint32_t) hash, key, key_len);
+	const row_list* list = NULL;
+	
+	if (found_elem == NULL) return 0;
+	if (found_elem->value_len != HTABLE_ROW_LIST) return sizeof(row_list) + ROW_LIST_FIRST_CAPACITY * sizeof(row_view);
+	
+	list = found_elem->value;
+	
+	return list->count < list->capacity ? 0 : sizeof(row_list) + 2 * (size_t) list->capacity * sizeof(row_view);
+	
+}
+
+/**
+ * @brief Adds a value to a key whose hash is given and keeps the ones
+ * 		  it already has. A new key is added like with
+ * 		  add_Htable_entry_hashed, a key added again gets a row_list,
+ * 		  moved to twice its capacity in the arena when it is full :
+ * 		  the previous lists are given back with the arena. Returns 0
+ * 		  on success, 1 if a list could not be allocated
+ * 
+ * @param hash_table The hash table
+ * 		  hash The hash of the key by the function of the table
+ * 		  key The key
+ * 		  key_len The length of the key
+ * 		  value The value
+ * 		  value_len The length of the value
+ */
+int add_Htable_row_hashed(Htable* hash_table, uint64_t hash, const char* key, size_t key_len, const void* value, size_t value_len) {
+	
+	bucket* found_elem = find_Htable_slot(hash_table, (uint32_t) hash, key, key_len);
+	row_list* list = NULL;
+	row_list* moved = NULL;
+	size_t capacity = ROW_LIST_FIRST_CAPACITY;
+	
+	if (found_elem == NULL) {
+		add_Htable_entry_hashed(hash_table, hash, key, key_len, value, value_len);
+		return 0;
+	}
+	
+	if (found_elem->value_len == HTABLE_ROW_LIST) {
+		list = (row_list*) found_elem->value;
+		capacity = 2 * (size_t) list->capacity;
+	}
+	
+	if (list == NULL || list->count == list->capacity) {
+		
+		moved = arena_alloc(&hash_table->arena, sizeof(row_list) + capacity * sizeof(row_view));
+		if (moved == NULL) return 1;
+		
+		if (list != NULL) {
+			memcpy(moved, list, sizeof(row_list) + list->count * sizeof(row_view));
+		} else {
+			moved->count = 1;
+			moved->rows[0].row = found_elem->value;
+			moved->rows[0].len = found_elem->value_len;
+		}
+		moved->capacity = capacity;
+		
+		list = moved;
+		found_elem->value = list;
+		found_elem->value_len = HTABLE_ROW_LIST;
+		
+	}
+	
+	list->rows[list->count].row = value;
+	list->rows[list->count].len = value_len;
+	list->count++;
+	
+	return 0;
+	
+}
+
+/* ======================================================================
+ * Provided: CSV file parser
+ * ======================================================================
+ */
+
+typedef char* csv_row;
+typedef const char* csv_const_row;
+
+/** ----------------------------------------------------------------------
+ ** Allocate and read a CSV row from a file
+ **/
+csv_row read_row(FILE* f)
+{
+    csv_row row = NULL;
+    size_t capacity = 0;
+
+    /* getline grows the row as needed, whatever the length of the line */
+    if (getline(&row, &capacity, f) < 0) {
+        free(row);
+        return calloc(1, sizeof(char));
+    }
+    row[strcspn(row, "\r\n")] = '\0'; // remove trailing '\n'
+
+    return row;
+}
+
+/** ----------------------------------------------------------------------
+ ** Write the first len characters of a CSV row to a file
+ **/
+void write_row_n(FILE* out, const char* row, size_t len, size_t ignore_index)
+{
+    size_t current_element = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (row[i] == CSV_SEPARATOR) {
+            ++current_element;
+        }
+        if (current_element != ignore_index && (current_element != ignore_index + 1 || row[i] != CSV_SEPARATOR)) {
+            fprintf(out, "%c", row[i]);
+        }
+    }
+}
+
+/** ----------------------------------------------------------------------
+ ** Write a CSV row to a file
+ **/
+void write_row(FILE* out, const csv_const_row row, size_t ignore_index)
+{
+    write_row_n(out, row, strlen(row), ignore_index);
+}
+
+/** ----------------------------------------------------------------------
+ ** Write 2 CSV rows side-by-side to a file
+ **/
+void write_rows(FILE* out, const csv_const_row row1, const csv_const_row row2, size_t ignore_index)
+{
+    write_row(out, row1, (size_t) -1);
+    fprintf(out, "%c", CSV_SEPARATOR);
+    write_row(out, row2, ignore_index);
+    fprintf(out, "\n");
+}
+
+/** ----------------------------------------------------------------------
+ ** Find where the i'th element in the row starts and ends,
+ ** end is 0 if there is no such element
+ **/
+void row_element_bounds(const csv_const_row row, size_t len, size_t index, size_t* start, size_t* end)
+{
+    size_t current_element = 0;
+    *start = 0;
+    *end = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (row[i] == CSV_SEPARATOR || i == len - 1) {
+            ++current_element;
+            if (current_element == index) {
+                *start = i + 1;
+            } else if (current_element == index + 1) {
+                *end = (i == len - 1) ? len : i;
+                break;
+            }
+        }
+    }
+}
+
+/** ----------------------------------------------------------------------
+ ** Copy and return the i'th element in the row
+ **/
+char* row_element(const csv_const_row row, size_t index)
+{
+    size_t start = 0, end = 0;
+    row_element_bounds(row, strlen(row), index, &start, &end);
+
+    if (end > 0) { // success
+        size_t elem_len = end - start;
+        char* element;
+        if ((element = calloc(elem_len + 1, sizeof(char))) == NULL) {
+            return NULL;
+        }
+        element[elem_len] = '\0';
+        strncpy(element, &row[start], elem_len);
+        return element;
+    } else {
+        return NULL;
+    }
+}
+
+
+/* ======================================================================
+ * Part II -- Hashjoin
+ * ======================================================================
+ */
+
+/* ****************************************
+ * TODO : add your own code here.
+ * **************************************** */
+
+#define GRACE_MAX_PARTITIONS 64
+#define GRACE_MAX_DEPTH 3
+#define GRACE_PARTITION_FILL 0.8
+#define GRACE_BUFFER_SHARE 8
+#define GRACE_MIN_BUFFER_SIZE 64
+
+#define JOIN_ROW_SIZE_ESTIMATE 64
+
+#define PARALLEL_CHUNK_SIZE (4 << 20)
+#define PARALLEL_MIN_CHUNK_SIZE (64 << 10)
+#define BUILD_MAX_PARTITIONS 64
+#define BUILD_PARTITIONS_PER_THREAD 4
+#define BUILD_CHECK_ROWS 4096
+#define BUILD_SAMPLE_SHARE 8
+#define BUILD_DOES_NOT_FIT -1
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+#define BLOOM_BITS_PER_KEY 12
+#define BLOOM_BLOCK_WORDS 8
+#define BLOOM_ALIGNMENT 64
+
+#define KEY_MAX_COLUMNS 8
+#define KEY_TEXT 0
+#define KEY_INTEGER 1
+
+#define JOIN_INNER 0
+#define JOIN_LEFT_OUTER 1
+#define JOIN_RIGHT_OUTER 2
+#define JOIN_FULL_OUTER 3
+#define JOIN_LEFT_SEMI 4
+#define JOIN_LEFT_ANTI 5
+#define JOIN_RIGHT_SEMI 6
+#define JOIN_RIGHT_ANTI 7
+
+/* Only the rows of the second file without a match, padded : the second pass of a block of a block nested join with duplicate keys */
+
+#define JOIN_RIGHT_MISSES 8
+
+#define HOT_SAMPLE_ROWS 1024
+#define HOT_MIN_SHARE 64
+#define HOT_MIN_COUNT 4
+#define HOT_MAX_KEYS 8
+#define HOT_KEY_MAX 56
+
+#define JOIN_PHASE_READ 0
+#define JOIN_PHASE_PARSE 1
+#define JOIN_PHASE_BUILD 2
+#define JOIN_PHASE_PARTITION 3
+#define JOIN_PHASE_PROBE 4
+#define JOIN_PHASE_WRITE 5
+#define JOIN_NB_PHASES 6
+#define JOIN_CHAIN_LENGTHS 16
+
+/* The names of the phases of a join in its report, in the order of their constants */
+
+const char* join_phase_names[JOIN_NB_PHASES] = { "read", "parse", "build", "partition", "probe", "write" };
+
+/**
+ * @brief Datastructure for type join_options, the settings of a join :
+ * 		  the number of threads that probe a mapped file, whether the
+ * 		  rows they find are written in the order of the probe file or
+ * 		  as soon as they are found, whether the output is written by
+ * 		  a background thread, the function that hashes the keys,
+ * 		  whether each file is known to be sorted on its join column,
+ * 		  the mode of the join, one of the JOIN_INNER to
+ * 		  JOIN_RIGHT_ANTI constants, where left is the first file and
+ * 		  right the second one, whether the phases are timed and
+ * 		  reported in JSON at the end, and whether the first file may
+ * 		  have several rows with the same key, which are then all
+ * 		  joined instead of the last one only
+ */
+struct join_options_struct {
+	
+	size_t nb_threads;
+	int ordered_output;
+	int background_writer;
+	key_hash_function key_hash;
+	int first_sorted;
+	int second_sorted;
+	int mode;
+	int report;
+	int duplicate_keys;
+	
+};
+
+typedef struct join_options_struct join_options;
+
+/**
+ * @brief Datastructure for type join_stats, what a join tells about
+ * 		  itself : the number of probe rows tested against a Bloom
+ * 		  filter, those it rejected, and those it let through although
+ * 		  their key is not in the table, the rows and bytes read, the
+ * 		  temporary files included, the bytes written, the matches, the
+ * 		  tables built, the times the second file was read again, the
+ * 		  hot keys found by sampling the second file and the lookups
+ * 		  they answered.
+ * 		  When timed, the nanoseconds of each JOIN_PHASE : reading a
+ * 		  row and finding its separators, and extracting its key, are
+ * 		  summed over the threads and are part of the build, partition
+ * 		  and probe phases, whose times are those of the whole phase.
+ * 		  The lookups that found their key are counted by the number
+ * 		  of slots they went through, the last count holding the
+ * 		  longer ones
+ */
+struct join_stats_struct {
+	
+	size_t tested;
+	size_t rejected;
+	size_t false_positives;
+	size_t rows_read;
+	size_t bytes_read;
+	size_t bytes_written;
+	size_t matches;
+	size_t build_blocks;
+	size_t rescans;
+	size_t hot_keys;
+	size_t hot_hits;
+	int timed;
+	uint64_t phase_ns[JOIN_NB_PHASES];
+	size_t chain_lengths[JOIN_CHAIN_LENGTHS];
+	
+};
+
+typedef struct join_stats_struct join_stats;
+
+/**
+ * @brief Initializes the statistics of a join, all at zero
+ * 
+ * @param stats The statistics
+ * 		  timed Whether the phases are timed
+ */
+void init_join_stats(join_stats* stats, int timed) {
+	
+	memset(stats, 0, sizeof(join_stats));
+	stats->timed = timed;
+	
+}
+
+/**
+ * @brief Returns the current time in nanoseconds if the statistics
+ * 		  are timed, 0 otherwise, so that an untimed join does not pay
+ * 		  for the clock
+ * 
+ * @param stats The statistics
+ */
+uint64_t stats_clock(const join_stats* stats) {
+	
+	struct timespec now;
+	
+	if (stats->timed == 0 || clock_gettime(CLOCK_MONOTONIC, &now) != 0) return 0;
+	
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+	
+}
+
+/**
+ * @brief Adds the time spent since a start given by stats_clock to a
+ * 		  phase of a join
+ * 
+ * @param stats The statistics
+ * 		  phase The phase, one of the JOIN_PHASE constants
+ * 		  start The start of the time spent
+ */
+void stats_add_time(join_stats* stats, int phase, uint64_t start) {
+	
+	if (stats->timed != 0) stats->phase_ns[phase] += stats_clock(stats) - start;
+	
+}
+
+/**
+ * @brief Counts a row read by a join
+ * 
+ * @param stats The statistics
+ * 		  len The length of the row
+ */
+void stats_add_row(join_stats* stats, size_t len) {
+	
+	stats->rows_read++;
+	stats->bytes_read += len + 1;
+	
+}
+
+/**
+ * @brief Counts a lookup that found its key after going through a
+ * 		  number of slots
+ * 
+ * @param stats The statistics
+ * 		  length The number of slots, at least 1
+ */
+void stats_add_match(join_stats* stats, size_t length) {
+	
+	stats->matches++;
+	stats->chain_lengths[length < JOIN_CHAIN_LENGTHS ? length - 1 : JOIN_CHAIN_LENGTHS - 1]++;
+	
+}
+
+/**
+ * @brief Adds the statistics of a thread to those of its join
+ * 
+ * @param total The statistics of the join, updated
+ * 		  part The statistics of the thread
+ */
+void merge_join_stats(join_stats* total, const join_stats* part) {
+	
+	size_t i;
+	
+	total->tested += part->tested;
+	total->rejected += part->rejected;
+	total->false_positives += part->false_positives;
+	total->rows_read += part->rows_read;
+	total->bytes_read += part->bytes_read;
+	total->bytes_written += part->bytes_written;
+	total->matches += part->matches;
+	total->build_blocks += part->build_blocks;
+	total->rescans += part->rescans;
+	total->hot_keys += part->hot_keys;
+	total->hot_hits += part->hot_hits;
+	for (i = 0; i < JOIN_NB_PHASES; i++) {
+		total->phase_ns[i] += part->phase_ns[i];
+	}
+	for (i = 0; i < JOIN_CHAIN_LENGTHS; i++) {
+		total->chain_lengths[i] += part->chain_lengths[i];
+	}
+	
+}
+
+/**
+ * @brief Datastructure for type join_keys, the key of a join : its
+ * 		  columns in each file, in the order they are compared, and
+ * 		  the type of each column, KEY_TEXT or KEY_INTEGER
+ */
+struct join_keys_struct {
+	
+	size_t nb_columns;
+	size_t columns_first[KEY_MAX_COLUMNS];
+	size_t columns_second[KEY_MAX_COLUMNS];
+	int types[KEY_MAX_COLUMNS];
+	
+};
+
+typedef struct join_keys_struct join_keys;
+
+/**
+ * @brief Tells if the key of a join is a single text column, whose
+ * 		  values are compared as they are in the rows, without being
+ * 		  encoded. Returns 1 if so, 0 otherwise
+ * 
+ * @param keys The key of the join
+ */
+int keys_are_raw(const join_keys* keys) {
+	
+	return keys->nb_columns == 1 && keys->types[0] == KEY_TEXT;
+	
+}
+
+/**
+ * @brief Datastructure for type join_context, what every step of a join
+ * 		  needs : the writer of the output, the key of the join, the
+ * 		  number of columns of the first file and the number of
+ * 		  separators a row of the second file adds to a joined row,
+ * 		  which give the padding of the rows without a match, the
+ * 		  accountant of the memory, the options and the statistics of
+ * 		  the join
+ */
+struct join_context_struct {
+	
+	struct output_writer_struct* writer;
+	const join_keys* keys;
+	size_t nb_fields_first;
+	size_t second_padding;
+	memory_accountant* accountant;
+	const join_options* options;
+	join_stats* stats;
+	
+};
+
+typedef struct join_context_struct join_context;
+
+/**
+ * @brief Gives the default options : one probe thread per online
+ * 		  processor, the rows written in the order of the probe file,
+ * 		  a background writer if there is more than one processor,
+ * 		  the keys hashed by DEFAULT_KEY_HASH, files that are not
+ * 		  known to be sorted, an inner join, no report and unique
+ * 		  keys in the first file
+ * 
+ * @param options The options
+ */
+void default_join_options(join_options* options) {
+	
+	long nb_processors = sysconf(_SC_NPROCESSORS_ONLN);
+	
+	options->nb_threads = nb_processors > 0 ? nb_processors : 1;
+	options->ordered_output = 1;
+	options->background_writer = nb_processors > 1;
+	options->key_hash = DEFAULT_KEY_HASH;
+	options->first_sorted = 0;
+	options->second_sorted = 0;
+	options->mode = JOIN_INNER;
+	options->report = 0;
+	options->duplicate_keys = 0;
+	
+}
+
+/**
+ * @brief Tells if a mode of join writes the pairs of matching rows
+ * 
+ * @param mode The mode of the join
+ */
+int join_outputs_pairs(int mode) {
+	
+	return mode == JOIN_INNER || mode == JOIN_LEFT_OUTER || mode == JOIN_RIGHT_OUTER || mode == JOIN_FULL_OUTER;
+	
+}
+
+/**
+ * @brief Tells if a mode of join needs to know which rows of the first
+ * 		  file found a match, once the whole second file is probed
+ * 
+ * @param mode The mode of the join
+ */
+int join_marks_matches(int mode) {
+	
+	return mode == JOIN_LEFT_OUTER || mode == JOIN_FULL_OUTER || mode == JOIN_LEFT_SEMI || mode == JOIN_LEFT_ANTI;
+	
+}
+
+/**
+ * @brief Tells if a mode of join writes the rows of the second file
+ * 		  that have no match
+ * 
+ * @param mode The mode of the join
+ */
+int join_outputs_probe_misses(int mode) {
+	
+	return mode == JOIN_RIGHT_OUTER || mode == JOIN_FULL_OUTER || mode == JOIN_RIGHT_ANTI || mode == JOIN_RIGHT_MISSES;
+	
+}
+
+/**
+ * @brief Datastructure for type join_table, the build side of a join
+ * 		  as seen by the probe : one hash table, or several built in
+ * 		  parallel, each one holding the keys whose high 32 bits of
+ * 		  hash fall in its part of their range
+ */
+struct join_table_struct {
+	
+	size_t nb_partitions;
+	Htable* partitions[BUILD_MAX_PARTITIONS];
+	
+};
+
+typedef struct join_table_struct join_table;
+
+/**
+ * @brief Returns the partition of a join table that holds a key
+ * 
+ * @param hash The hash of the key
+ * 		  nb_partitions The number of partitions
+ */
+size_t join_table_partition(uint64_t hash, size_t nb_partitions) {
+	
+	/* The high bits pick the partition, the low ones stay free to pick the slot */
+	
+	return ((hash >> 32) * nb_partitions) >> 32;
+	
+}
+
+/**
+ * @brief Returns the slot of the element which has the given key
+ * 		  in a join table or NULL if it doesn't exist
+ * 
+ * @param table The join table
+ * 		  hash The hash of the key, computed once by the caller
+ * 		  key The key of the element we want to find
+ * 		  key_len The length of the key
+ */
+const bucket* get_join_table_entry(const join_table* table, uint64_t hash, const char* key, size_t key_len) {
+	
+	return get_Htable_entry_hashed(table->partitions[join_table_partition(hash, table->nb_partitions)], hash, key, key_len);
+	
+}
+
+/**
+ * @brief Datastructure for type bloom_filter, a blocked Bloom filter of
+ * 		  the keys of a join table : a key sets one bit in each of the
+ * 		  BLOOM_BLOCK_WORDS words of a single block, so that testing it
+ * 		  reads one cache line. The bits come from the low 32 bits of
+ * 		  the hash of the key, the ones kept in the slots, so that the
+ * 		  filter is built from the table without hashing again. A
+ * 		  filter without blocks lets every key through
+ */
+struct bloom_filter_struct {
+	
+	uint32_t* blocks;
+	size_t nb_blocks;
+	memory_accountant* accountant;
+	
+};
+
+typedef struct bloom_filter_struct bloom_filter;
+
+/* Odd multipliers, one per word of a block, that each pick a bit of the word from the hash */
+
+const uint32_t bloom_salts[BLOOM_BLOCK_WORDS] = {
+	0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+	0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+/**
+ * @brief Returns the number of bytes of the Bloom filter of a given
+ * 		  number of keys
+ * 
+ * @param nb_keys The number of keys
+ */
+size_t bloom_filter_bytes(size_t nb_keys) {
+	
+	size_t block_bits = BLOOM_BLOCK_WORDS * 32;
+	
+	return (nb_keys * BLOOM_BITS_PER_KEY + block_bits - 1) / block_bits * (block_bits / 8);
+	
+}
+
+/**
+ * @brief Returns the first word of the block of a Bloom filter where a
+ * 		  key sets its bits
+ * 
+ * @param filter The filter
+ * 		  hash The low 32 bits of the hash of the key
+ */
+uint32_t* bloom_block(const bloom_filter* filter, uint32_t hash) {
+	
+	/* The slot of a key comes from its low bits, its block from all of them scrambled */
+	
+	uint32_t scrambled = hash * 0x9E3779B1U;
+	
+	return &filter->blocks[BLOOM_BLOCK_WORDS * (((uint64_t) scrambled * filter->nb_blocks) >> 32)];
+	
+}
+
+/**
+ * @brief Adds a key to a Bloom filter
+ * 
+ * @param filter The filter
+ * 		  hash The low 32 bits of the hash of the key
+ */
+void bloom_add(bloom_filter* filter, uint32_t hash) {
+	
+	uint32_t* block = bloom_block(filter, hash);
+	size_t i;
+	
+	for (i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+		block[i] |= 1U << ((hash * bloom_salts[i]) >> 27);
+	}
+	
+}
+
+/**
+ * @brief Tells if a key may be in the table of a Bloom filter, 0 means
+ * 		  that it is surely not there
+ * 
+ * @param filter The filter
+ * 		  hash The low 32 bits of the hash of the key
+ */
+int bloom_may_contain(const bloom_filter* filter, uint32_t hash) {
+	
+	const uint32_t* block = NULL;
+	uint32_t missing = 0;
+	size_t i;
+	
+	if (filter->nb_blocks == 0) return 1;
+	
+	/* No early exit, so that the 8 words are tested side by side */
+	
+	block = bloom_block(filter, hash);
+	for (i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+		missing |= ~block[i] & (1U << ((hash * bloom_salts[i]) >> 27));
+	}
+	
+	return missing == 0;
+	
+}
+
+/**
+ * @brief Builds the Bloom filter of the keys of a join table, from the
+ * 		  hashes kept in its slots. The filter is counted by the
+ * 		  accountant, and left without blocks if it does not fit in
+ * 		  the budget. Returns 0 on success
+ * 
+ * @param filter The filter
+ * 		  table The join table
+ * 		  accountant The accountant
+ */
+int init_bloom_filter(bloom_filter* filter, const join_table* table, memory_accountant* accountant) {
+	
+	const Htable* hash_table = NULL;
+	void* blocks = NULL;
+	size_t nb_keys = 0;
+	size_t bytes = 0;
+	size_t partition;
+	size_t i;
+	
+	filter->blocks = NULL;
+	filter->nb_blocks = 0;
+	filter->accountant = accountant;
+	
+	for (partition = 0; partition < table->nb_partitions; partition++) {
+		nb_keys += table->partitions[partition]->count;
+	}
+	
+	bytes = bloom_filter_bytes(nb_keys);
+	if (bytes == 0 || account_fits(accountant, bytes) == 0) return 0;
+	
+	if (posix_memalign(&blocks, BLOOM_ALIGNMENT, bytes) != 0) return 1;
+	memset(blocks, 0, bytes);
+	account_alloc(accountant, bytes);
+	
+	filter->blocks = blocks;
+	filter->nb_blocks = bytes / (BLOOM_BLOCK_WORDS * sizeof(uint32_t));
+	
+	for (partition = 0; partition < table->nb_partitions; partition++) {
+		hash_table = table->partitions[partition];
+		for (i = 0; i < hash_table->size; i++) {
+			if (hash_table->content[i].key != NULL) bloom_add(filter, hash_table->content[i].hash);
+		}
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Frees the blocks of a Bloom filter
+ * 
+ * @param filter The filter
+ */
+void delete_bloom_filter(bloom_filter* filter) {
+	
+	if (filter->blocks != NULL) account_free(filter->accountant, filter->nb_blocks * BLOOM_BLOCK_WORDS * sizeof(uint32_t));
+	
+	free(filter->blocks);
+	filter->blocks = NULL;
+	filter->nb_blocks = 0;
+	
+}
+
+/**
+ * @brief Datastructure for type match_marks, one bit per slot of the
+ * 		  tables of a join table, set when a probe row matches the
+ * 		  element of the slot. The bits of a table start at the bit
+ * 		  given by its partition. Marks without bits are not kept
+ */
+struct match_marks_struct {
+	
+	unsigned char* bits;
+	size_t starts[BUILD_MAX_PARTITIONS];
+	size_t nb_bits;
+	memory_accountant* accountant;
+	
+};
+
+typedef struct match_marks_struct match_marks;
+
+/**
+ * @brief Returns the number of bytes of the marks of a number of slots
+ * 
+ * @param nb_slots The number of slots
+ */
+size_t match_marks_bytes(size_t nb_slots) {
+	
+	return (nb_slots + 7) / 8;
+	
+}
+
+/**
+ * @brief Allocates the cleared marks of the slots of a join table when
+ * 		  the mode of the join needs them, counted by the accountant.
+ * 		  Returns 0 on success
+ * 
+ * @param marks The marks
+ * 		  table The join table
+ * 		  mode The mode of the join
+ * 		  accountant The accountant
+ */
+int init_match_marks(match_marks* marks, const join_table* table, int mode, memory_accountant* accountant) {
+	
+	size_t i;
+	
+	marks->bits = NULL;
+	marks->nb_bits = 0;
+	marks->accountant = accountant;
+	
+	if (join_marks_matches(mode) == 0) return 0;
+	
+	for (i = 0; i < table->nb_partitions; i++) {
+		marks->starts[i] = marks->nb_bits;
+		marks->nb_bits += table->partitions[i]->size;
+	}
+	
+	marks->bits = calloc(match_marks_bytes(marks->nb_bits), 1);
+	if (marks->bits == NULL) return 1;
+	account_alloc(accountant, match_marks_bytes(marks->nb_bits));
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Marks the slot of a join table that a probe row matched. The
+ * 		  probe threads may mark the same byte at the same time, so the
+ * 		  bit is set atomically, and only if it is not set yet
+ * 
+ * @param marks The marks
+ * 		  table The join table
+ * 		  hash The hash of the key of the probe row
+ * 		  slot The slot that matched
+ */
+void mark_match(const match_marks* marks, const join_table* table, uint64_t hash, const bucket* slot) {
+	
+	size_t partition = join_table_partition(hash, table->nb_partitions);
+	size_t bit = marks->starts[partition] + (slot - table->partitions[partition]->content);
+	unsigned char mask = 1U << (bit & 7);
+	
+	if ((__atomic_load_n(&marks->bits[bit >> 3], __ATOMIC_RELAXED) & mask) == 0) {
+		__atomic_fetch_or(&marks->bits[bit >> 3], mask, __ATOMIC_RELAXED);
+	}
+	
+}
+
+/**
+ * @brief Tells if the i'th slot of a partition of a join table was
+ * 		  matched by a probe row
+ * 
+ * @param marks The marks
+ * 		  partition The partition
+ * 		  i The index of the slot in the table of the partition
+ */
+int slot_matched(const match_marks* marks, size_t partition, size_t i) {
+	
+	size_t bit = marks->starts[partition] + i;
+	
+	return (marks->bits[bit >> 3] >> (bit & 7)) & 1;
+	
+}
+
+/**
+ * @brief Frees the marks of a join table
+ * 
+ * @param marks The marks
+ */
+void delete_match_marks(match_marks* marks) {
+	
+	if (marks->bits != NULL) account_free(marks->accountant, match_marks_bytes(marks->nb_bits));
+	
+	free(marks->bits);
+	marks->bits = NULL;
+	marks->nb_bits = 0;
+	
+}
+
+/**
+ * @brief Returns the partition of a key for a given recursion level
+ * 		  of the partitioned join. The hash of the key is scrambled
+ * 		  with the level so that a partition too big to fit in memory
+ * 		  is split differently at the next level, and independently
+ * 		  of the bucket index used by the hash table. Only the low 32
+ * 		  bits are used, the ones kept in a slot, so that the rows of
+ * 		  a table can be spilled without hashing their keys again
+ * 
+ * @param key_hash The low 32 bits of the hash of the key
+ * 		  level The recursion level
+ * 		  nb_partitions The number of partitions
+ */
+size_t grace_partition(uint32_t key_hash, size_t level, size_t nb_partitions) {
+	
+	uint64_t hash = key_hash;
+	
+	hash ^= (level + 1) * 0x9E3779B97F4A7C15ULL;
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	
+	return hash % nb_partitions;
+	
+}
+
+/**
+ * @brief Datastructure for type csv_fields, the index of the fields of
+ * 		  a row : the offsets of its separators, in order. Field i goes
+ * 		  from just after separator i - 1 to separator i, or to the end
+ * 		  of the row for the last one. A row with more separators than
+ * 		  CSV_MAX_FIELDS is marked as overflowing
+ */
+struct csv_fields_struct {
+	
+	size_t nb_separators;
+	int overflow;
+	uint32_t separators[CSV_MAX_FIELDS];
+	
+};
+
+typedef struct csv_fields_struct csv_fields;
+
+/**
+ * @brief Records the offset of a separator in the index of a row
+ * 
+ * @param fields The index
+ * 		  offset The offset of the separator in the row
+ */
+void add_csv_separator(csv_fields* fields, size_t offset) {
+	
+	if (fields->nb_separators < CSV_MAX_FIELDS) {
+		fields->separators[fields->nb_separators++] = offset;
+	} else {
+		fields->overflow = 1;
+	}
+	
+}
+
+/**
+ * @brief Scans a row one byte at a time : records its separators in
+ * 		  the index and returns its length, up to the first '\r' or
+ * 		  '\n', or the number of bytes left if there is none
+ * 
+ * @param row The row
+ * 		  left The number of bytes that can be read from row
+ * 		  from The offset where the scan starts, fields before it are
+ * 		  already in the index
+ * 		  fields The index, updated
+ */
+size_t csv_scan_row_scalar(const char* row, size_t left, size_t from, csv_fields* fields) {
+	
+	size_t i;
+	
+	for (i = from; i < left; i++) {
+		if (row[i] == CSV_SEPARATOR) {
+			add_csv_separator(fields, i);
+		} else if (row[i] == '\n' || row[i] == '\r') {
+			return i;
+		}
+	}
+	
+	return left;
+	
+}
+
+#ifdef CSV_SCAN_X86
+
+/**
+ * @brief Scans a row with SSE2, see csv_scan_row_scalar : 16 bytes are
+ * 		  compared to the separator and to the end of line characters
+ * 		  at once, and the positions are taken from the bit masks of
+ * 		  the comparisons. The tail is scanned byte by byte
+ * 
+ * @param row The row
+ * 		  left The number of bytes that can be read from row
+ * 		  fields The index, already reset
+ */
+__attribute__((target("sse2")))
+size_t csv_scan_row_sse2(const char* row, size_t left, csv_fields* fields) {
+	
+	const __m128i separator = _mm_set1_epi8(CSV_SEPARATOR);
+	const __m128i new_line = _mm_set1_epi8('\n');
+	const __m128i carriage_return = _mm_set1_epi8('\r');
+	size_t i = 0;
+	
+	for (; i + 16 <= left; i += 16) {
+		__m128i chars = _mm_loadu_si128((const __m128i*) &row[i]);
+		uint32_t separators = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, separator));
+		uint32_t ends = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, new_line), _mm_cmpeq_epi8(chars, carriage_return)));
+		if (ends != 0) separators &= (1u << __builtin_ctz(ends)) - 1;
+		while (separators != 0) {
+			add_csv_separator(fields, i + __builtin_ctz(separators));
+			separators &= separators - 1;
+		}
+		if (ends != 0) return i + __builtin_ctz(ends);
+	}
+	
+	return csv_scan_row_scalar(row, left, i, fields);
+	
+}
+
+/**
+ * @brief Scans a row with AVX2, 32 bytes at once, see csv_scan_row_sse2
+ * 
+ * @param row The row
+ * 		  left The number of bytes that can be read from row
+ * 		  fields The index, already reset
+ */
+__attribute__((target("avx2")))
+size_t csv_scan_row_avx2(const char* row, size_t left, csv_fields* fields) {
+	
+	const __m256i separator = _mm256_set1_epi8(CSV_SEPARATOR);
+	const __m256i new_line = _mm256_set1_epi8('\n');
+	const __m256i carriage_return = _mm256_set1_epi8('\r');
+	size_t i = 0;
+	
+	for (; i + 32 <= left; i += 32) {
+		__m256i chars = _mm256_loadu_si256((const __m256i*) &row[i]);
+		uint32_t separators = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, separator));
+		uint32_t ends = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chars, new_line), _mm256_cmpeq_epi8(chars, carriage_return)));
+		if (ends != 0) separators &= (1u << __builtin_ctz(ends)) - 1;
+		while (separators != 0) {
+			add_csv_separator(fields, i + __builtin_ctz(separators));
+			separators &= separators - 1;
+		}
+		if (ends != 0) return i + __builtin_ctz(ends);
+	}
+	
+	return csv_scan_row_scalar(row, left, i, fields);
+	
+}
+
+#endif
+
+/**
+ * @brief Returns the name of the scanner csv_scan_row uses on this
+ * 		  processor : "avx2", "sse2" or "scalar"
+ */
+const char* csv_scan_engine(void) {
+	
+#ifdef CSV_SCAN_X86
+	
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return "avx2";
+	if (__builtin_cpu_supports("sse2")) return "sse2";
+	
+#endif
+	
+	return "scalar";
+	
+}
+
+/**
+ * @brief Scans a row and builds the index of its fields in a single
+ * 		  pass, see csv_scan_row_scalar. On x86, the AVX2 or the SSE2
+ * 		  scanner is picked at run time, whatever the flags of the
+ * 		  build, from what the processor supports. The features are
+ * 		  detected by the startup code of the runtime, so checking
+ * 		  them on every row only costs a load
+ * 
+ * @param row The row
+ * 		  left The number of bytes that can be read from row
+ * 		  fields The index, reset
+ */
+size_t csv_scan_row(const char* row, size_t left, csv_fields* fields) {
+	
+	fields->nb_separators = 0;
+	fields->overflow = 0;
+	
+#ifdef CSV_SCAN_X86
+	
+	if (__builtin_cpu_supports("avx2")) return csv_scan_row_avx2(row, left, fields);
+	if (__builtin_cpu_supports("sse2")) return csv_scan_row_sse2(row, left, fields);
+	
+#endif
+	
+	return csv_scan_row_scalar(row, left, 0, fields);
+	
+}
+
+/**
+ * @brief Gives where the i'th element of an indexed row starts and
+ * 		  ends, in constant time. Returns 0 if the row has no such
+ * 		  element, 1 otherwise
+ * 
+ * @param row The row
+ * 		  len The length of the row
+ * 		  fields The index of the row
+ * 		  index The index of the element
+ * 		  start The offset of the first character of the element
+ * 		  end The offset just after its last character
+ */
+int csv_field(const char* row, size_t len, const csv_fields* fields, size_t index, size_t* start, size_t* end) {
+	
+	/* Past the index of an overflowing row, the fields are found the slow way */
+	
+	if (fields->overflow != 0 && index >= CSV_MAX_FIELDS) {
+		row_element_bounds(row, len, index, start, end);
+		return *end > 0;
+	}
+	
+	if (index > fields->nb_separators) return 0;
+	
+	*start = (index == 0) ? 0 : fields->separators[index - 1] + 1;
+	*end = (index == fields->nb_separators) ? len : fields->separators[index];
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Datastructure for type csv_reader, which reads the non empty
+ * 		  rows of a CSV file one after the other and gives them as
+ * 		  views : a pointer to their first character and a length,
+ * 		  without '\0' at the end. A regular file is mapped in memory
+ * 		  and its rows point in the mapping, without any copy. Pipes
+ * 		  and terminals are streamed line after line into a buffer
+ * 		  of the reader, which grows to hold the longest one, and
+ * 		  their rows point in that buffer. Both ways cut the same
+ * 		  bytes into the same rows. The fields of the last row read are indexed
+ * 		  while looking for its end. That row can be given back to be
+ * 		  read again
+ */
+struct csv_reader_struct {
+	
+	FILE* file;
+	const char* map;
+	size_t map_size;
+	size_t position;
+	const char* row;
+	size_t len;
+	int unread;
+	csv_fields fields;
+	char* line;
+	size_t line_capacity;
+	size_t line_size;
+	size_t line_position;
+	
+};
+
+typedef struct csv_reader_struct csv_reader;
+
+/**
+ * @brief Initializes a reader on a file, from its current position.
+ * 		  The file is mapped in memory if it is a regular file,
+ * 		  otherwise it will be streamed
+ * 
+ * @param reader The reader
+ * 		  f The file
+ */
+void init_csv_reader(csv_reader* reader, FILE* f) {
+	
+	struct stat file_stat;
+	long position = ftell(f);
+	void* map = MAP_FAILED;
+	
+	reader->file = f;
+	reader->map = NULL;
+	reader->map_size = 0;
+	reader->position = 0;
+	reader->row = NULL;
+	reader->len = 0;
+	reader->unread = 0;
+	reader->fields.nb_separators = 0;
+	reader->fields.overflow = 0;
+	reader->line = NULL;
+	reader->line_capacity = 0;
+	reader->line_size = 0;
+	reader->line_position = 0;
+	
+	/* The stream may hold written data that the mapping would not see */
+	
+	if (position < 0 || fflush(f) != 0 || fstat(fileno(f), &file_stat) != 0) return;
+	if (S_ISREG(file_stat.st_mode) == 0 || file_stat.st_size <= position) return;
+	
+	map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+	if (map == MAP_FAILED) return;
+	
+	posix_madvise(map, file_stat.st_size, POSIX_MADV_SEQUENTIAL);
+	
+	reader->map = map;
+	reader->map_size = file_stat.st_size;
+	reader->position = position;
+	
+}
+
+/**
+ * @brief Releases the mapping or the buffer of a reader, the views it
+ * 		  gave are no longer valid afterwards. The file itself is not
+ * 		  closed
+ * 
+ * @param reader The reader
+ */
+void close_csv_reader(csv_reader* reader) {
+	
+	if (reader->map != NULL) {
+		munmap((void*) reader->map, reader->map_size);
+		reader->map = NULL;
+	}
+	
+	free(reader->line);
+	reader->line = NULL;
+	reader->line_capacity = 0;
+	reader->line_size = 0;
+	reader->line_position = 0;
+	
+}
+
+/**
+ * @brief Reads the next non empty row. Returns 0 at the end of the
+ * 		  file or on a reading error, 1 otherwise. A streamed row
+ * 		  stays valid until the next call, a mapped row as long as
+ * 		  the reader is not closed
+ * 
+ * @param reader The reader
+ * 		  row The row read
+ * 		  len The length of the row read
+ */
+int reader_next_row(csv_reader* reader, const char** row, size_t* len) {
+	
+	const char* start = NULL;
+	ssize_t read = 0;
+	
+	if (reader->unread != 0) {
+		reader->unread = 0;
+		*row = reader->row;
+		*len = reader->len;
+		return 1;
+	}
+	
+	if (reader->map != NULL) {
+		
+		while (reader->position < reader->map_size) {
+			start = &reader->map[reader->position];
+			reader->len = csv_scan_row(start, reader->map_size - reader->position, &reader->fields);
+			reader->position += reader->len;
+			if (reader->position < reader->map_size) reader->position++;
+			if (reader->len > 0) {
+				reader->row = start;
+				*row = reader->row;
+				*len = reader->len;
+				return 1;
+			}
+		}
+		
+		return 0;
+		
+	}
+	
+	/* A line is cut into rows at its '\r' the way the mapping is */
+	
+	for (;;) {
+		if (reader->line_position >= reader->line_size) {
+			read = getline(&reader->line, &reader->line_capacity, reader->file);
+			if (read < 0) return 0;
+			reader->line_size = read;
+			reader->line_position = 0;
+		}
+		start = &reader->line[reader->line_position];
+		reader->len = csv_scan_row(start, reader->line_size - reader->line_position, &reader->fields);
+		reader->line_position += reader->len;
+		if (reader->line_position < reader->line_size) reader->line_position++;
+		if (reader->len > 0) {
+			reader->row = start;
+			*row = reader->row;
+			*len = reader->len;
+			return 1;
+		}
+	}
+	
+}
+
+/**
+ * @brief Gives where the i'th element of the last row read starts
+ * 		  and ends, in constant time. Returns 0 if the row has no
+ * 		  such element, 1 otherwise
+ * 
+ * @param reader The reader
+ * 		  index The index of the element
+ * 		  start The offset of the first character of the element
+ * 		  end The offset just after its last character
+ */
+int reader_field(const csv_reader* reader, size_t index, size_t* start, size_t* end) {
+	
+	return csv_field(reader->row, reader->len, &reader->fields, index, start, end);
+	
+}
+
+/**
+ * @brief Gives back the last row read, the next call to
+ * 		  reader_next_row will return it again
+ * 
+ * @param reader The reader
+ */
+void reader_unread(csv_reader* reader) {
+	
+	reader->unread = 1;
+	
+}
+
+/**
+ * @brief Tells if there is no row left to read
+ * 
+ * @param reader The reader
+ */
+int reader_at_end(csv_reader* reader) {
+	
+	const char* row = NULL;
+	size_t len = 0;
+	
+	if (reader_next_row(reader, &row, &len) == 0) return 1;
+	
+	reader_unread(reader);
+	return 0;
+	
+}
+
+/**
+ * @brief Tells if an error occurred while reading
+ * 
+ * @param reader The reader
+ */
+int reader_error(const csv_reader* reader) {
+	
+	return reader->map == NULL && ferror(reader->file) != 0;
+	
+}
+
+/**
+ * @brief Returns the position of the next row to read,
+ * 		  or -1 if it is not known
+ * 
+ * @param reader The reader
+ */
+long reader_tell(const csv_reader* reader) {
+	
+	if (reader->unread != 0 || reader->line_position < reader->line_size) return -1;
+	
+	return reader->map != NULL ? (long) reader->position : ftell(reader->file);
+	
+}
+
+/**
+ * @brief Goes back to a position given by reader_tell.
+ * 		  Returns 0 on success
+ * 
+ * @param reader The reader
+ * 		  position The position
+ */
+int reader_seek(csv_reader* reader, long position) {
+	
+	reader->unread = 0;
+	reader->line_size = 0;
+	reader->line_position = 0;
+	
+	if (reader->map != NULL) {
+		reader->position = position;
+		return 0;
+	}
+	
+	return fseek(reader->file, position, SEEK_SET);
+	
+}
+
+/**
+ * @brief Returns the number of bytes left to read,
+ * 		  or -1 if it is not known
+ * 
+ * @param reader The reader
+ */
+long reader_bytes_left(csv_reader* reader) {
+	
+	long here = 0;
+	long end = -1;
+	
+	if (reader->map != NULL) return reader->map_size - reader->position;
+	
+	here = ftell(reader->file);
+	if (here >= 0 && fseek(reader->file, 0, SEEK_END) == 0) {
+		end = ftell(reader->file);
+		if (fseek(reader->file, here, SEEK_SET) != 0) end = -1;
+	}
+	
+	return end >= here ? end - here + (long) (reader->line_size - reader->line_position) : -1;
+	
+}
+
+/**
+ * @brief Datastructure for type output_buffer, a growable block of
+ * 		  memory where joined rows are written before going to a file
+ */
+struct output_buffer_struct {
+	
+	char* data;
+	size_t size;
+	size_t capacity;
+	
+};
+
+typedef struct output_buffer_struct output_buffer;
+
+/**
+ * @brief Makes sure that some more bytes can be appended to a buffer.
+ * 		  Returns 0 on success
+ * 
+ * @param buffer The buffer
+ * 		  more The number of bytes
+ */
+int buffer_reserve(output_buffer* buffer, size_t more) {
+	
+	size_t capacity = buffer->capacity > 0 ? buffer->capacity : CSV_MAX_LINE_SIZE;
+	char* data = NULL;
+	
+	if (buffer->size + more <= buffer->capacity) return 0;
+	
+	while (capacity < buffer->size + more) capacity *= 2;
+	
+	data = realloc(buffer->data, capacity);
+	if (data == NULL) return 1;
+	
+	buffer->data = data;
+	buffer->capacity = capacity;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends 2 CSV rows side-by-side to a buffer, with the same
+ * 		  result as write_rows, but copying whole ranges : the join
+ * 		  column of the second row is left out with the separator
+ * 		  before it, or after it when it is the first column. Returns
+ * 		  0 on success
+ * 
+ * @param buffer The buffer
+ * 		  row1 The first row
+ * 		  len1 The length of the first row
+ * 		  row2 The second row
+ * 		  len2 The length of the second row
+ * 		  key_start The offset of the join column in the second row
+ * 		  key_end The offset just after the join column in the second row
+ */
+int buffer_append_rows(output_buffer* buffer, const char* row1, size_t len1, const char* row2, size_t len2, size_t key_start, size_t key_end) {
+	
+	size_t before = key_start > 0 ? key_start - 1 : 0;
+	size_t after = key_end < len2 ? key_end + 1 : len2;
+	char* out = NULL;
+	
+	if (buffer_reserve(buffer, len1 + before + (len2 - after) + 2) != 0) return 1;
+	
+	out = &buffer->data[buffer->size];
+	memcpy(out, row1, len1);
+	out += len1;
+	*out++ = CSV_SEPARATOR;
+	memcpy(out, row2, before);
+	out += before;
+	memcpy(out, &row2[after], len2 - after);
+	out += len2 - after;
+	*out++ = '\n';
+	buffer->size = out - buffer->data;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Gives the key of a row of one of the files of a join. A raw
+ * 		  key is the view of its column in the row. Otherwise its
+ * 		  columns are encoded one after the other in the scratch
+ * 		  buffer, so that equal keys have the same bytes : an integer
+ * 		  as 8 bytes, big endian with the sign bit flipped so that the
+ * 		  order of the bytes is the order of the numbers, and a text
+ * 		  as its length on 4 bytes followed by its bytes. Returns 0 on
+ * 		  success, 2 if a column is missing, 13 if an integer column
+ * 		  does not hold an integer, 3 if the buffer could not grow
+ * 
+ * @param keys The key of the join
+ * 		  columns The indexes of its columns in the file of the row
+ * 		  row The row
+ * 		  len The length of the row
+ * 		  fields The index of the fields of the row
+ * 		  scratch The buffer where the key is encoded
+ * 		  key The key, set
+ * 		  key_len The length of the key, set
+ */
+int row_key(const join_keys* keys, const size_t* columns, const char* row, size_t len, const csv_fields* fields, output_buffer* scratch, const char** key, size_t* key_len) {
+	
+	size_t start = 0;
+	size_t end = 0;
+	size_t i;
+	size_t j;
+	uint64_t value = 0;
+	uint64_t limit = 0;
+	uint32_t text_len = 0;
+	int negative = 0;
+	unsigned char* out = NULL;
+	
+	if (keys_are_raw(keys) != 0) {
+		if (csv_field(row, len, fields, columns[0], &start, &end) == 0) return 2;
+		*key = &row[start];
+		*key_len = end - start;
+		return 0;
+	}
+	
+	scratch->size = 0;
+	
+	for (i = 0; i < keys->nb_columns; i++) {
+		
+		if (csv_field(row, len, fields, columns[i], &start, &end) == 0) return 2;
+		
+		if (keys->types[i] == KEY_INTEGER) {
+			
+			/* An optional sign, then digits only, so that "01" and "1" are the same key */
+			
+			negative = start < end && row[start] == '-';
+			if (start < end && (row[start] == '-' || row[start] == '+')) start++;
+			if (start == end) return 13;
+			
+			limit = negative ? (uint64_t) INT64_MAX + 1 : (uint64_t) INT64_MAX;
+			value = 0;
+			for (j = start; j < end; j++) {
+				if (row[j] < '0' || row[j] > '9' || value > (limit - (row[j] - '0')) / 10) return 13;
+				value = value * 10 + (row[j] - '0');
+			}
+			value = (negative ? 0 - value : value) ^ ((uint64_t) 1 << 63);
+			
+			if (buffer_reserve(scratch, 8) != 0) return 3;
+			out = (unsigned char*) &scratch->data[scratch->size];
+			for (j = 0; j < 8; j++) {
+				out[j] = value >> (56 - 8 * j);
+			}
+			scratch->size += 8;
+			
+		} else {
+			
+			text_len = end - start;
+			if (buffer_reserve(scratch, 4 + text_len) != 0) return 3;
+			out = (unsigned char*) &scratch->data[scratch->size];
+			for (j = 0; j < 4; j++) {
+				out[j] = text_len >> (24 - 8 * j);
+			}
+			memcpy(&out[4], &row[start], text_len);
+			scratch->size += 4 + text_len;
+			
+		}
+		
+	}
+	
+	*key = scratch->data;
+	*key_len = scratch->size;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Prints the message of an error of row_key
+ * 
+ * @param error The error
+ * 		  where Where the row comes from, such as "du premier fichier"
+ */
+void print_key_error(int error, const char* where) {
+	
+	if (error == 2) fprintf(stderr, "Clé introuvable dans une ligne %s\n", where);
+	if (error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour une clé %s\n", where);
+	if (error == 13) fprintf(stderr, "Clé entière invalide dans une ligne %s\n", where);
+	
+}
+
+/**
+ * @brief Appends the columns of a row of the second file that are not
+ * 		  part of the key to a buffer, each one after a separator, and
+ * 		  ends the line. A single key column is left out as
+ * 		  buffer_append_rows does. Returns 0 on success
+ * 
+ * @param buffer The buffer
+ * 		  row2 The row of the second file
+ * 		  len2 The length of the row
+ * 		  fields2 The index of the fields of the row
+ * 		  keys The key of the join
+ */
+int buffer_append_second_fields(output_buffer* buffer, const char* row2, size_t len2, const csv_fields* fields2, const join_keys* keys) {
+	
+	size_t start = 0;
+	size_t end = 0;
+	size_t field = 0;
+	size_t i;
+	int is_key = 0;
+	
+	if (keys->nb_columns == 1) {
+		csv_field(row2, len2, fields2, keys->columns_second[0], &start, &end);
+		return buffer_append_rows(buffer, row2, 0, row2, len2, start, end);
+	}
+	
+	if (buffer_reserve(buffer, len2 + 2) != 0) return 1;
+	
+	for (field = 0; csv_field(row2, len2, fields2, field, &start, &end) != 0; field++) {
+		is_key = 0;
+		for (i = 0; i < keys->nb_columns; i++) {
+			if (keys->columns_second[i] == field) is_key = 1;
+		}
+		if (is_key == 0) {
+			buffer->data[buffer->size++] = CSV_SEPARATOR;
+			memcpy(&buffer->data[buffer->size], &row2[start], end - start);
+			buffer->size += end - start;
+		}
+	}
+	
+	buffer->data[buffer->size++] = '\n';
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends 2 CSV rows side-by-side to a buffer, leaving out the
+ * 		  key columns of the second row. A single key column is left
+ * 		  out as buffer_append_rows does, with the result of write_rows.
+ * 		  Returns 0 on success
+ * 
+ * @param buffer The buffer
+ * 		  row1 The first row
+ * 		  len1 The length of the first row
+ * 		  row2 The second row
+ * 		  len2 The length of the second row
+ * 		  fields2 The index of the fields of the second row
+ * 		  keys The key of the join
+ */
+int buffer_append_joined(output_buffer* buffer, const char* row1, size_t len1, const char* row2, size_t len2, const csv_fields* fields2, const join_keys* keys) {
+	
+	size_t start = 0;
+	size_t end = 0;
+	
+	if (keys->nb_columns == 1) {
+		csv_field(row2, len2, fields2, keys->columns_second[0], &start, &end);
+		return buffer_append_rows(buffer, row1, len1, row2, len2, start, end);
+	}
+	
+	if (buffer_reserve(buffer, len1) != 0) return 1;
+	
+	memcpy(&buffer->data[buffer->size], row1, len1);
+	buffer->size += len1;
+	
+	return buffer_append_second_fields(buffer, row2, len2, fields2, keys);
+	
+}
+
+/**
+ * @brief Appends a single CSV row to a buffer, the output of semi and
+ * 		  anti joins. Returns 0 on success
+ * 
+ * @param buffer The buffer
+ * 		  row The row
+ * 		  len The length of the row
+ */
+int buffer_append_row(output_buffer* buffer, const char* row, size_t len) {
+	
+	if (buffer_reserve(buffer, len + 1) != 0) return 1;
+	
+	memcpy(&buffer->data[buffer->size], row, len);
+	buffer->size += len;
+	buffer->data[buffer->size++] = '\n';
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends a row of the first file without a match to a buffer,
+ * 		  followed by as many separators as a row of the second file
+ * 		  would have added, so that its fields are empty. Returns 0
+ * 		  on success
+ * 
+ * @param buffer The buffer
+ * 		  row1 The row of the first file
+ * 		  len1 The length of the row
+ * 		  context The context of the join
+ */
+int buffer_append_first_miss(output_buffer* buffer, const char* row1, size_t len1, const join_context* context) {
+	
+	size_t padding = context->second_padding;
+	
+	if (buffer_reserve(buffer, len1 + padding + 1) != 0) return 1;
+	
+	memcpy(&buffer->data[buffer->size], row1, len1);
+	buffer->size += len1;
+	memset(&buffer->data[buffer->size], CSV_SEPARATOR, padding);
+	buffer->size += padding;
+	buffer->data[buffer->size++] = '\n';
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends a row of the second file without a match to a buffer,
+ * 		  after the columns of a first row that are all empty but the
+ * 		  key ones, which take the key of the row. Returns 0 on success
+ * 
+ * @param buffer The buffer
+ * 		  row2 The row of the second file
+ * 		  len2 The length of the row
+ * 		  fields2 The index of the fields of the row
+ * 		  context The context of the join
+ */
+int buffer_append_second_miss(output_buffer* buffer, const char* row2, size_t len2, const csv_fields* fields2, const join_context* context) {
+	
+	const join_keys* keys = context->keys;
+	size_t start = 0;
+	size_t end = 0;
+	size_t field;
+	size_t i;
+	
+	if (buffer_reserve(buffer, len2 + context->nb_fields_first) != 0) return 1;
+	
+	for (field = 0; field < context->nb_fields_first; field++) {
+		if (field > 0) buffer->data[buffer->size++] = CSV_SEPARATOR;
+		for (i = 0; i < keys->nb_columns; i++) {
+			if (keys->columns_first[i] == field && csv_field(row2, len2, fields2, keys->columns_second[i], &start, &end) != 0) {
+				memcpy(&buffer->data[buffer->size], &row2[start], end - start);
+				buffer->size += end - start;
+				break;
+			}
+		}
+	}
+	
+	return buffer_append_second_fields(buffer, row2, len2, fields2, keys);
+	
+}
+
+/**
+ * @brief Appends what the mode of a join writes for a row of the second
+ * 		  file to a buffer : the pairs of rows, or the row of the second
+ * 		  file alone, when it has a match, the row padded, or alone,
+ * 		  when it has none, or nothing. Returns 0 on success
+ * 
+ * @param buffer The buffer
+ * 		  found_elem The slot of the matching rows of the first file, or NULL
+ * 		  row2 The row of the second file
+ * 		  len2 The length of the row
+ * 		  fields2 The index of the fields of the row
+ * 		  context The context of the join
+ */
+int buffer_append_probe(output_buffer* buffer, const bucket* found_elem, const char* row2, size_t len2, const csv_fields* fields2, const join_context* context) {
+	
+	int mode = context->options->mode;
+	bucket single;
+	size_t i;
+	
+	if (found_elem != NULL && join_outputs_pairs(mode) != 0) {
+		for (i = 0; i < bucket_nb_rows(found_elem); i++) {
+			single = bucket_row(found_elem, i);
+			if (buffer_append_joined(buffer, single.value, single.value_len, row2, len2, fields2, context->keys) != 0) return 1;
+		}
+		return 0;
+	}
+	if (found_elem != NULL && mode == JOIN_RIGHT_SEMI) return buffer_append_row(buffer, row2, len2);
+	if (found_elem == NULL && mode == JOIN_RIGHT_ANTI) return buffer_append_row(buffer, row2, len2);
+	if (found_elem == NULL && join_outputs_probe_misses(mode) != 0) return buffer_append_second_miss(buffer, row2, len2, fields2, context);
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends what the mode of a join writes for the rows of a key
+ * 		  of the first file, once the second file is probed, to a
+ * 		  buffer : the rows padded, or alone, when the key has no match,
+ * 		  the rows alone when it has one, or nothing. Returns 0 on
+ * 		  success
+ * 
+ * @param buffer The buffer
+ * 		  slot The slot of the rows of the first file
+ * 		  matched Whether the key has a match
+ * 		  context The context of the join
+ */
+int buffer_append_build(output_buffer* buffer, const bucket* slot, int matched, const join_context* context) {
+	
+	int mode = context->options->mode;
+	bucket single;
+	size_t i;
+	int error = 0;
+	
+	for (i = 0; i < bucket_nb_rows(slot) && error == 0; i++) {
+		single = bucket_row(slot, i);
+		if (matched != 0 && mode == JOIN_LEFT_SEMI) error = buffer_append_row(buffer, single.value, single.value_len);
+		if (matched == 0 && mode == JOIN_LEFT_ANTI) error = buffer_append_row(buffer, single.value, single.value_len);
+		if (matched == 0 && (mode == JOIN_LEFT_OUTER || mode == JOIN_FULL_OUTER)) error = buffer_append_first_miss(buffer, single.value, single.value_len, context);
+	}
+	
+	return error;
+	
+}
+
+/**
+ * @brief Returns the number of slots of a hash table for a given
+ * 		  memory budget, leaving room in the budget for the table
+ * 		  itself, the rows and keys stored in its arena and its Bloom
+ * 		  filter
+ * 
+ * @param max_memory The maximum authorized memory for a block
+ */
+size_t Htable_size_for_budget(size_t max_memory) {
+	
+	if (max_memory < sizeof(Htable)) return 0;
+	
+	return (max_memory - sizeof(Htable)) / (sizeof(bucket) + HASH_TABLE_LOAD_FACTOR * (JOIN_ROW_SIZE_ESTIMATE + BLOOM_BITS_PER_KEY / 8.0));
+	
+}
+
+/**
+ * @brief Reads the rows of the build file into the hash table until
+ * 		  the next row, or the growth of the table it would cause,
+ * 		  would take the memory counted by the accountant of the table
+ * 		  over its budget, room being left for the Bloom filter of the
+ * 		  rows, the marks of the slots and a reserve, or the file ends. That row is given back to
+ * 		  the reader. A block always gets at least one row, so that a
+ * 		  tiny budget still makes progress. Mapped rows and raw keys
+ * 		  are stored as views in the mapping, streamed rows and
+ * 		  encoded keys are copied in the arena of the table. Each key
+ * 		  is hashed once, by the function of the table. When the
+ * 		  options allow duplicate keys, the rows of a key are kept
+ * 		  together in its row_list, whose moves count in the budget,
+ * 		  otherwise the last row of a key replaces the others. A
+ * 		  growth still in progress is then finished, so that the
+ * 		  probe only looks in one array
+ * 
+ * @param hash_table The hash table
+ * 		  build The reader of the file that has unique key values
+ * 		  context The context of the join
+ * 		  reserve The bytes of the budget left for what is allocated
+ * 		  while the table is still full : the partition buffers
+ * 		  count The number of rows in the table, updated
+ * 		  bytes The number of bytes of the rows read, updated
+ */
+int fill_Htable(Htable* hash_table, csv_reader* build, const join_context* context, size_t reserve, size_t* count, size_t* bytes) {
+	
+	const join_keys* keys = context->keys;
+	join_stats* stats = context->stats;
+	int marked = join_marks_matches(context->options->mode);
+	size_t marks_size = 0;
+	const char* row = NULL;
+	size_t len = 0;
+	const char* key = NULL;
+	size_t key_len = 0;
+	size_t block_size = 0;
+	size_t list_size = 0;
+	char* block = NULL;
+	uint64_t hash = 0;
+	output_buffer scratch = { NULL, 0, 0 };
+	uint64_t phase_start = stats_clock(stats);
+	uint64_t start = phase_start;
+	size_t first_count = *count;
+	int error = 0;
+	
+	while (reader_next_row(build, &row, &len) != 0) {
+		
+		stats_add_time(stats, JOIN_PHASE_READ, start);
+		stats_add_row(stats, len);
+		
+		start = stats_clock(stats);
+		error = row_key(keys, keys->columns_first, row, len, &build->fields, &scratch, &key, &key_len);
+		stats_add_time(stats, JOIN_PHASE_PARSE, start);
+		if (error != 0) {
+			print_key_error(error, "du premier fichier");
+			free(scratch.data);
+			scratch.data = NULL;
+			return error;
+		}
+		
+		/* A streamed row is copied in the arena, and an encoded key just after it. A raw key is a view in the row */
+		
+		block_size = (build->map != NULL) ? 0 : len;
+		if (keys_are_raw(keys) == 0) block_size += key_len;
+		
+		hash = hash_table->key_hash(key, key_len);
+		if (context->options->duplicate_keys != 0) list_size = Htable_row_cost(hash_table, hash, key, key_len);
+		
+		if (marked != 0) marks_size = match_marks_bytes(Htable_growth_cost(hash_table) > 0 ? Htable_next_size(hash_table) : hash_table->size);
+		
+		if (*count > 0 && ((Htable_is_loaded(hash_table) != 0 && Htable_next_size(hash_table) == hash_table->size) || account_fits(hash_table->accountant, (block_size + list_size > 0 ? arena_cost(&hash_table->arena, block_size + list_size) : 0) + Htable_growth_cost(hash_table) + bloom_filter_bytes(*count + 1) + marks_size + reserve) == 0)) {
+			
+			/* The row will be read again by the next block or partition */
+			
+			stats->rows_read--;
+			stats->bytes_read -= len + 1;
+			reader_unread(build);
+			break;
+			
+		}
+		
+		if (block_size > 0) {
+			block = arena_alloc(&hash_table->arena, block_size);
+			if (block == NULL) {
+				fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du premier fichier\n");
+				free(scratch.data);
+				scratch.data = NULL;
+				return 3;
+			}
+			if (build->map == NULL) {
+				memcpy(block, row, len);
+				if (keys_are_raw(keys) != 0) key = &block[key - row];
+				row = block;
+				block += len;
+			}
+			if (keys_are_raw(keys) == 0) {
+				memcpy(block, key, key_len);
+				key = block;
+			}
+		}
+		
+		*bytes += len + 1;
+		if (context->options->duplicate_keys == 0) {
+			add_Htable_entry_hashed(hash_table, hash, key, key_len, row, len);
+		} else if (add_Htable_row_hashed(hash_table, hash, key, key_len, row, len) != 0) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour les lignes d'une clé du premier fichier\n");
+			free(scratch.data);
+			scratch.data = NULL;
+			return 3;
+		}
+		++*count;
+		
+		start = stats_clock(stats);
+		
+	}
+	
+	free(scratch.data);
+	scratch.data = NULL;
+	
+	finish_Htable_growth(hash_table);
+	
+	if (*count > first_count) stats->build_blocks++;
+	stats_add_time(stats, JOIN_PHASE_BUILD, phase_start);
+	
+	if (reader_error(build) != 0) {
+		fprintf(stderr, "Erreur dans la lecture du premier fichier\n");
+		return 4;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Cuts the rest of a mapped file in chunks of about a given
+ * 		  size that end on row boundaries. Returns the nb_chunks + 1
+ * 		  boundaries, to be freed, or NULL if they could not be
+ * 		  allocated
+ * 
+ * @param reader The reader of the mapped file
+ * 		  chunk_size The size of the chunks
+ * 		  nb_chunks The number of chunks, set
+ */
+size_t* split_mapping(const csv_reader* reader, size_t chunk_size, size_t* nb_chunks) {
+	
+	size_t* boundaries = NULL;
+	const char* new_line = NULL;
+	size_t i;
+	
+	*nb_chunks = (reader->map_size - reader->position + chunk_size - 1) / chunk_size;
+	boundaries = malloc((*nb_chunks + 1) * sizeof(size_t));
+	if (boundaries == NULL) return NULL;
+	
+	/* Every chunk but the first starts just after the first end of line past its nominal start */
+	
+	boundaries[0] = reader->position;
+	for (i = 1; i < *nb_chunks; i++) {
+		boundaries[i] = reader->position + i * chunk_size;
+		if (boundaries[i] < boundaries[i - 1]) boundaries[i] = boundaries[i - 1];
+		new_line = memchr(&reader->map[boundaries[i]], '\n', reader->map_size - boundaries[i]);
+		boundaries[i] = (new_line != NULL) ? (size_t) (new_line - reader->map) + 1 : reader->map_size;
+	}
+	boundaries[*nb_chunks] = reader->map_size;
+	
+	return boundaries;
+	
+}
+
+/**
+ * @brief Runs the same body in several threads and waits for all of
+ * 		  them. The body takes its work from the shared argument until
+ * 		  there is none left, so if no thread can be started, the
+ * 		  calling thread runs it alone
+ * 
+ * @param nb_threads The number of threads
+ * 		  body The body of the threads
+ * 		  arg The shared argument of the body
+ */
+void run_threads(size_t nb_threads, void* (*body)(void*), void* arg) {
+	
+	pthread_t* threads = malloc(nb_threads * sizeof(pthread_t));
+	size_t nb_started = 0;
+	size_t i;
+	
+	if (threads != NULL) {
+		for (nb_started = 0; nb_started < nb_threads; nb_started++) {
+			if (pthread_create(&threads[nb_started], NULL, body, arg) != 0) break;
+		}
+	}
+	
+	if (nb_started == 0) body(arg);
+	
+	for (i = 0; i < nb_started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	
+	free(threads);
+	
+}
+
+/**
+ * @brief Datastructure for type output_writer, the output stage of a
+ * 		  join : rows are gathered in a big buffer that is written to
+ * 		  the file descriptor of the output file in one call when it
+ * 		  is full. With a background thread, two buffers are used in
+ * 		  turn, one being filled while the thread writes the other.
+ * 		  The bytes written and the time spent writing them go to the
+ * 		  statistics of the join, if any
+ */
+struct output_writer_struct {
+	
+	FILE* file;
+	int fd;
+	output_buffer buffers[2];
+	size_t current;
+	int background;
+	join_stats* stats;
+	
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	output_buffer* pending;
+	int stop;
+	int error;
+	
+};
+
+typedef struct output_writer_struct output_writer;
+
+/**
+ * @brief Writes bytes to the output of a writer, going on after the
+ * 		  partial writes and interruptions of write. Returns 0 on
+ * 		  success
+ * 
+ * @param writer The writer
+ * 		  data The bytes
+ * 		  size The number of bytes
+ */
+int write_all(output_writer* writer, const char* data, size_t size) {
+	
+	ssize_t written = 0;
+	uint64_t start = 0;
+	int error = 0;
+	
+	/* Writes never overlap, so the thread that writes owns these statistics */
+	
+	if (writer->stats != NULL) {
+		start = stats_clock(writer->stats);
+		writer->stats->bytes_written += size;
+	}
+	
+	/* A stream without file descriptor is still written through stdio */
+	
+	if (writer->fd < 0) {
+		error = fwrite(data, 1, size, writer->file) != size;
+	} else {
+		while (size > 0) {
+			written = write(writer->fd, data, size);
+			if (written < 0 && errno == EINTR) continue;
+			if (written <= 0) {
+				error = 1;
+				break;
+			}
+			data += written;
+			size -= written;
+		}
+	}
+	
+	if (writer->stats != NULL) stats_add_time(writer->stats, JOIN_PHASE_WRITE, start);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Body of the background thread of a writer : writes every
+ * 		  buffer handed over by writer_flush until the writer stops
+ * 
+ * @param arg The writer
+ */
+void* writer_thread(void* arg) {
+	
+	output_writer* writer = arg;
+	output_buffer* buffer = NULL;
+	int error = 0;
+	
+	pthread_mutex_lock(&writer->lock);
+	
+	while (1) {
+		
+		while (writer->pending == NULL && writer->stop == 0) {
+			pthread_cond_wait(&writer->changed, &writer->lock);
+		}
+		if (writer->pending == NULL) break;
+		
+		buffer = writer->pending;
+		pthread_mutex_unlock(&writer->lock);
+		
+		error = write_all(writer, buffer->data, buffer->size);
+		
+		pthread_mutex_lock(&writer->lock);
+		buffer->size = 0;
+		if (error != 0) writer->error = 1;
+		writer->pending = NULL;
+		pthread_cond_broadcast(&writer->changed);
+		
+	}
+	
+	pthread_mutex_unlock(&writer->lock);
+	
+	return NULL;
+	
+}
+
+/**
+ * @brief Initializes a writer on an output file, after the rows
+ * 		  already written through stdio. Returns 0 on success
+ * 
+ * @param writer The writer
+ * 		  file The output file
+ * 		  background Whether the buffers are written by a background thread
+ * 		  stats The statistics of the join, or NULL
+ */
+int init_output_writer(output_writer* writer, FILE* file, int background, join_stats* stats) {
+	
+	output_buffer empty = { NULL, 0, 0 };
+	
+	writer->file = file;
+	writer->fd = fileno(file);
+	writer->buffers[0] = empty;
+	writer->buffers[1] = empty;
+	writer->current = 0;
+	writer->background = 0;
+	writer->stats = stats;
+	writer->pending = NULL;
+	writer->stop = 0;
+	writer->error = 0;
+	
+	if (fflush(file) != 0) return 1;
+	if (buffer_reserve(&writer->buffers[0], OUTPUT_BUFFER_SIZE) != 0) return 1;
+	
+	if (background != 0) {
+		pthread_mutex_init(&writer->lock, NULL);
+		pthread_cond_init(&writer->changed, NULL);
+		
+		/* Without a thread, the writer simply writes in the foreground */
+		
+		if (buffer_reserve(&writer->buffers[1], OUTPUT_BUFFER_SIZE) == 0 && pthread_create(&writer->thread, NULL, writer_thread, writer) == 0) {
+			writer->background = 1;
+		} else {
+			pthread_mutex_destroy(&writer->lock);
+			pthread_cond_destroy(&writer->changed);
+		}
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Waits until the background thread of a writer has written
+ * 		  the buffer handed over to it. Returns 0 if every write
+ * 		  succeeded so far
+ * 
+ * @param writer The writer
+ */
+int writer_wait(output_writer* writer) {
+	
+	int error = 0;
+	
+	if (writer->background == 0) return writer->error;
+	
+	pthread_mutex_lock(&writer->lock);
+	while (writer->pending != NULL) {
+		pthread_cond_wait(&writer->changed, &writer->lock);
+	}
+	error = writer->error;
+	pthread_mutex_unlock(&writer->lock);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Writes the buffer being filled, or hands it over to the
+ * 		  background thread and goes on with the other one. Returns 0
+ * 		  if every write succeeded so far
+ * 
+ * @param writer The writer
+ */
+int writer_flush(output_writer* writer) {
+	
+	output_buffer* buffer = &writer->buffers[writer->current];
+	
+	if (buffer->size == 0) return 0;
+	
+	if (writer->background == 0) {
+		if (write_all(writer, buffer->data, buffer->size) != 0) writer->error = 1;
+		buffer->size = 0;
+		return writer->error;
+	}
+	
+	if (writer_wait(writer) != 0) return 1;
+	
+	pthread_mutex_lock(&writer->lock);
+	writer->pending = buffer;
+	writer->current = 1 - writer->current;
+	pthread_cond_signal(&writer->changed);
+	pthread_mutex_unlock(&writer->lock);
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends 2 CSV rows side-by-side to the output, see
+ * 		  buffer_append_rows. Returns 0 on success, an error
+ * 		  code of hash_join otherwise
+ * 
+ * @param writer The writer
+ * 		  row1 The first row
+ * 		  len1 The length of the first row
+ * 		  row2 The second row
+ * 		  len2 The length of the second row
+ * 		  key_start The offset of the join column in the second row
+ * 		  key_end The offset just after the join column in the second row
+ */
+int writer_append_rows(output_writer* writer, const char* row1, size_t len1, const char* row2, size_t len2, size_t key_start, size_t key_end) {
+	
+	output_buffer* buffer = &writer->buffers[writer->current];
+	
+	if (buffer->size + len1 + len2 + 2 > OUTPUT_BUFFER_SIZE && writer_flush(writer) != 0) return 11;
+	
+	if (buffer_append_rows(&writer->buffers[writer->current], row1, len1, row2, len2, key_start, key_end) != 0) return 3;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends what the mode of a join writes for a row of the second
+ * 		  file to the output, see buffer_append_probe. The pairs of a
+ * 		  key with several rows in the first file are appended one by
+ * 		  one, so that the buffer never has to hold all of them.
+ * 		  Returns 0 on success, an error code of hash_join otherwise
+ * 
+ * @param writer The writer
+ * 		  found_elem The slot of the matching rows of the first file, or NULL
+ * 		  row2 The row of the second file
+ * 		  len2 The length of the row
+ * 		  fields2 The index of the fields of the row
+ * 		  context The context of the join
+ */
+int writer_append_probe(output_writer* writer, const bucket* found_elem, const char* row2, size_t len2, const csv_fields* fields2, const join_context* context) {
+	
+	output_buffer* buffer = NULL;
+	size_t nb_rows = (found_elem != NULL && join_outputs_pairs(context->options->mode) != 0) ? bucket_nb_rows(found_elem) : 1;
+	bucket single;
+	size_t i;
+	
+	for (i = 0; i < nb_rows; i++) {
+		
+		if (found_elem != NULL) single = bucket_row(found_elem, i);
+		buffer = &writer->buffers[writer->current];
+		
+		if (buffer->size + (found_elem != NULL ? single.value_len : context->nb_fields_first) + len2 + 2 > OUTPUT_BUFFER_SIZE && writer_flush(writer) != 0) return 11;
+		
+		if (buffer_append_probe(&writer->buffers[writer->current], found_elem != NULL ? &single : NULL, row2, len2, fields2, context) != 0) return 3;
+		
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends what the mode of a join writes for the rows of a key
+ * 		  of the first file to the output, one by one, see
+ * 		  buffer_append_build. Returns 0 on success, an error code of
+ * 		  hash_join otherwise
+ * 
+ * @param writer The writer
+ * 		  slot The slot of the rows of the first file
+ * 		  matched Whether the key has a match
+ * 		  context The context of the join
+ */
+int writer_append_build(output_writer* writer, const bucket* slot, int matched, const join_context* context) {
+	
+	output_buffer* buffer = NULL;
+	bucket single;
+	size_t i;
+	
+	for (i = 0; i < bucket_nb_rows(slot); i++) {
+		
+		single = bucket_row(slot, i);
+		buffer = &writer->buffers[writer->current];
+		
+		if (buffer->size + single.value_len + context->second_padding + 2 > OUTPUT_BUFFER_SIZE && writer_flush(writer) != 0) return 11;
+		
+		if (buffer_append_build(&writer->buffers[writer->current], &single, matched, context) != 0) return 3;
+		
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends bytes to the output. A block at least as big as a
+ * 		  buffer is written directly, after what was appended before.
+ * 		  Returns 0 on success, an error code of hash_join otherwise
+ * 
+ * @param writer The writer
+ * 		  data The bytes
+ * 		  size The number of bytes
+ */
+int writer_write(output_writer* writer, const char* data, size_t size) {
+	
+	output_buffer* buffer = &writer->buffers[writer->current];
+	
+	if (size >= OUTPUT_BUFFER_SIZE) {
+		if (writer_flush(writer) != 0 || writer_wait(writer) != 0) return 11;
+		if (write_all(writer, data, size) != 0) {
+			writer->error = 1;
+			return 11;
+		}
+		return 0;
+	}
+	
+	if (buffer->size + size > OUTPUT_BUFFER_SIZE && writer_flush(writer) != 0) return 11;
+	
+	buffer = &writer->buffers[writer->current];
+	if (buffer_reserve(buffer, size) != 0) return 3;
+	memcpy(&buffer->data[buffer->size], data, size);
+	buffer->size += size;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Writes what is left in a writer, stops its background thread
+ * 		  and frees its buffers. Returns 0 if every write succeeded
+ * 
+ * @param writer The writer
+ */
+int close_output_writer(output_writer* writer) {
+	
+	int error = writer_flush(writer);
+	
+	if (writer->background != 0) {
+		writer_wait(writer);
+		pthread_mutex_lock(&writer->lock);
+		writer->stop = 1;
+		pthread_cond_signal(&writer->changed);
+		pthread_mutex_unlock(&writer->lock);
+		pthread_join(writer->thread, NULL);
+		pthread_mutex_destroy(&writer->lock);
+		pthread_cond_destroy(&writer->changed);
+		writer->background = 0;
+	}
+	
+	free(writer->buffers[0].data);
+	writer->buffers[0].data = NULL;
+	free(writer->buffers[1].data);
+	writer->buffers[1].data = NULL;
+	
+	return error != 0 || writer->error != 0;
+	
+}
+
+/**
+ * @brief Datastructure for type hot_key, a key met often enough in a
+ * 		  sample of the second file to be looked up apart : the slot
+ * 		  of its rows in the join table, or NULL if it has none, and
+ * 		  a copy of the key
+ */
+struct hot_key_struct {
+	
+	const bucket* slot;
+	size_t key_len;
+	char key[HOT_KEY_MAX];
+	
+};
+
+typedef struct hot_key_struct hot_key;
+
+/**
+ * @brief Datastructure for type hot_keys, the small table of the hot
+ * 		  keys of a probe, looked into before the Bloom filter and the
+ * 		  join table. Their hashes sit side by side in one cache line,
+ * 		  so that the other keys are turned away in a few comparisons.
+ * 		  Also the size of the chunks of a parallel probe, smaller when
+ * 		  the keys of the sample have many rows in the first file, so
+ * 		  that the rows of a hot key are shared by more threads
+ */
+struct hot_keys_struct {
+	
+	size_t nb_keys;
+	uint64_t hashes[HOT_MAX_KEYS];
+	hot_key keys[HOT_MAX_KEYS];
+	size_t chunk_size;
+	
+};
+
+typedef struct hot_keys_struct hot_keys;
+
+/**
+ * @brief Datastructure for type hot_sample, a row of the sample of a
+ * 		  mapped probe file : the hash of its key and its offset
+ */
+struct hot_sample_struct {
+	
+	uint64_t hash;
+	size_t row;
+	
+};
+
+typedef struct hot_sample_struct hot_sample;
+
+/**
+ * @brief Compares two rows of a sample on the hash of their key, then
+ * 		  on their offset
+ * 
+ * @param a The first row
+ * 		  b The second row
+ */
+int compare_hot_samples(const void* a, const void* b) {
+	
+	const hot_sample* sample1 = a;
+	const hot_sample* sample2 = b;
+	
+	if (sample1->hash != sample2->hash) return (sample1->hash > sample2->hash) - (sample1->hash < sample2->hash);
+	
+	return (sample1->row > sample2->row) - (sample1->row < sample2->row);
+	
+}
+
+/**
+ * @brief Returns the hot key that has the given key, or NULL
+ * 
+ * @param hot The hot keys
+ * 		  hash The hash of the key
+ * 		  key The key
+ * 		  key_len The length of the key
+ */
+const hot_key* find_hot_key(const hot_keys* hot, uint64_t hash, const char* key, size_t key_len) {
+	
+	size_t i;
+	
+	for (i = 0; i < hot->nb_keys; i++) {
+		if (hot->hashes[i] == hash && hot->keys[i].key_len == key_len && memcmp(hot->keys[i].key, key, key_len) == 0) return &hot->keys[i];
+	}
+	
+	return NULL;
+	
+}
+
+/**
+ * @brief Finds the key of the row of a mapped probe file that starts
+ * 		  at a given offset. Returns 0 on success, an error code of
+ * 		  row_key otherwise
+ * 
+ * @param probe The reader of the mapped probe file
+ * 		  position The offset of the row
+ * 		  context The context of the join
+ * 		  scratch The buffer where the key is encoded
+ * 		  len The length of the row, set
+ * 		  key The key, set
+ * 		  key_len The length of the key, set
+ */
+int hot_row_key(const csv_reader* probe, size_t position, const join_context* context, output_buffer* scratch, size_t* len, const char** key, size_t* key_len) {
+	
+	csv_fields fields;
+	
+	*len = csv_scan_row(&probe->map[position], probe->map_size - position, &fields);
+	
+	return row_key(context->keys, context->keys->columns_second, &probe->map[position], *len, &fields, scratch, key, key_len);
+	
+}
+
+/**
+ * @brief Finds the hot keys of the rest of a mapped probe file from a
+ * 		  sample of HOT_SAMPLE_ROWS rows taken at even steps : the keys
+ * 		  of at least one HOT_MIN_SHARE of the sample, and HOT_MIN_COUNT
+ * 		  rows, the HOT_MAX_KEYS most frequent ones first. With
+ * 		  duplicate keys, the chunks of a parallel probe shrink with the
+ * 		  number of pairs a row of the sample makes. A streamed file,
+ * 		  or a sample that would go over the budget, gives no hot keys
+ * 
+ * @param hot The hot keys, set
+ * 		  table The join table
+ * 		  probe The reader of the probe file, left where it is
+ * 		  context The context of the join
+ */
+void sample_hot_keys(hot_keys* hot, const join_table* table, const csv_reader* probe, const join_context* context) {
+	
+	hot_sample* samples = NULL;
+	size_t nb_samples = 0;
+	size_t candidates[HOT_MAX_KEYS];
+	size_t counts[HOT_MAX_KEYS];
+	size_t nb_candidates = 0;
+	size_t smallest = 0;
+	size_t threshold = 0;
+	size_t pairs = 0;
+	size_t step = 0;
+	size_t next = 0;
+	size_t position = 0;
+	size_t run = 0;
+	size_t len = 0;
+	const char* new_line = NULL;
+	const bucket* found_elem = NULL;
+	const char* key = NULL;
+	size_t key_len = 0;
+	output_buffer scratch = { NULL, 0, 0 };
+	int count_pairs = context->options->duplicate_keys != 0 && join_outputs_pairs(context->options->mode) != 0;
+	int error = 0;
+	size_t i;
+	
+	hot->nb_keys = 0;
+	hot->chunk_size = PARALLEL_CHUNK_SIZE;
+	
+	if (probe->map == NULL || probe->unread != 0 || probe->position >= probe->map_size) return;
+	if (account_fits(context->accountant, HOT_SAMPLE_ROWS * sizeof(hot_sample)) == 0) return;
+	
+	samples = malloc(HOT_SAMPLE_ROWS * sizeof(hot_sample));
+	if (samples == NULL) return;
+	account_alloc(context->accountant, HOT_SAMPLE_ROWS * sizeof(hot_sample));
+	
+	/* Each row of the sample starts at its step or after the previous one, so that a small file is sampled whole */
+	
+	step = (probe->map_size - probe->position) / HOT_SAMPLE_ROWS;
+	next = probe->position;
+	
+	for (i = 0; i < HOT_SAMPLE_ROWS && next < probe->map_size; i++) {
+		
+		position = probe->position + i * step;
+		if (position <= next) {
+			position = next;
+		} else if (probe->map[position - 1] != '\n') {
+			new_line = memchr(&probe->map[position], '\n', probe->map_size - position);
+			if (new_line == NULL) break;
+			position = new_line - probe->map + 1;
+			if (position >= probe->map_size) break;
+		}
+		
+		error = hot_row_key(probe, position, context, &scratch, &len, &key, &key_len);
+		next = position + len + 1;
+		if (len == 0) continue;
+		if (error != 0) break;
+		
+		samples[nb_samples].hash = context->options->key_hash(key, key_len);
+		samples[nb_samples].row = position;
+		nb_samples++;
+		
+	}
+	
+	qsort(samples, nb_samples, sizeof(hot_sample), compare_hot_samples);
+	threshold = nb_samples / HOT_MIN_SHARE > HOT_MIN_COUNT ? nb_samples / HOT_MIN_SHARE : HOT_MIN_COUNT;
+	
+	for (i = 0; i < nb_samples; i = run) {
+		
+		for (run = i + 1; run < nb_samples && samples[run].hash == samples[i].hash; run++);
+		
+		found_elem = NULL;
+		if (count_pairs != 0 && hot_row_key(probe, samples[i].row, context, &scratch, &len, &key, &key_len) == 0) {
+			found_elem = get_join_table_entry(table, samples[i].hash, key, key_len);
+		}
+		pairs += (run - i) * (found_elem != NULL ? bucket_nb_rows(found_elem) : 1);
+		
+		if (run - i < threshold) continue;
+		
+		if (nb_candidates < HOT_MAX_KEYS) {
+			candidates[nb_candidates] = i;
+			counts[nb_candidates++] = run - i;
+			continue;
+		}
+		
+		for (smallest = 0, position = 1; position < HOT_MAX_KEYS; position++) {
+			if (counts[position] < counts[smallest]) smallest = position;
+		}
+		if (counts[smallest] < run - i) {
+			candidates[smallest] = i;
+			counts[smallest] = run - i;
+		}
+		
+	}
+	
+	/* A hot key without a row in the first file is kept too, its rows skip the Bloom filter as well */
+	
+	for (i = 0; i < nb_candidates; i++) {
+		if (hot_row_key(probe, samples[candidates[i]].row, context, &scratch, &len, &key, &key_len) != 0 || key_len > HOT_KEY_MAX) continue;
+		hot->hashes[hot->nb_keys] = samples[candidates[i]].hash;
+		hot->keys[hot->nb_keys].slot = get_join_table_entry(table, samples[candidates[i]].hash, key, key_len);
+		hot->keys[hot->nb_keys].key_len = key_len;
+		memcpy(hot->keys[hot->nb_keys].key, key, key_len);
+		hot->nb_keys++;
+	}
+	
+	if (pairs > nb_samples) {
+		hot->chunk_size = (size_t) ((double) PARALLEL_CHUNK_SIZE * nb_samples / pairs);
+		if (hot->chunk_size < PARALLEL_MIN_CHUNK_SIZE) hot->chunk_size = PARALLEL_MIN_CHUNK_SIZE;
+	}
+	
+	context->stats->hot_keys += hot->nb_keys;
+	
+	free(scratch.data);
+	scratch.data = NULL;
+	free(samples);
+	samples = NULL;
+	account_free(context->accountant, HOT_SAMPLE_ROWS * sizeof(hot_sample));
+	
+}
+
+/**
+ * @brief Looks up the key of a probe row in the hot keys, then through
+ * 		  the Bloom filter in the join table, and counts the lookup.
+ * 		  Returns the slot of the matching rows of the first file, or
+ * 		  NULL
+ * 
+ * @param table The join table
+ * 		  filter The Bloom filter of the join table
+ * 		  hot The hot keys of the probe
+ * 		  hash The hash of the key
+ * 		  key The key
+ * 		  key_len The length of the key
+ * 		  stats The statistics, updated
+ */
+const bucket* probe_lookup(const join_table* table, const bloom_filter* filter, const hot_keys* hot, uint64_t hash, const char* key, size_t key_len, join_stats* stats) {
+	
+	const hot_key* hot_elem = find_hot_key(hot, hash, key, key_len);
+	const bucket* found_elem = NULL;
+	
+	if (hot_elem != NULL) {
+		stats->hot_hits++;
+		found_elem = hot_elem->slot;
+	} else {
+		if (filter->nb_blocks > 0) stats->tested++;
+		if (filter->nb_blocks == 0 || bloom_may_contain(filter, hash) != 0) {
+			found_elem = get_join_table_entry(table, hash, key, key_len);
+			if (found_elem == NULL && filter->nb_blocks > 0) stats->false_positives++;
+		} else {
+			stats->rejected++;
+		}
+	}
+	
+	if (found_elem != NULL) stats_add_match(stats, found_elem->distance + 1);
+	
+	return found_elem;
+	
+}
+
+/**
+ * @brief Datastructure for type parallel_probe, shared by the threads
+ * 		  that probe a mapped file : the immutable join table, its
+ * 		  Bloom filter, the hot keys of the file and the marks of the
+ * 		  matched slots, the chunks of the file, cut on row boundaries, the next chunk to
+ * 		  take and the next one to write when the output is ordered,
+ * 		  and the first error met
+ */
+struct parallel_probe_struct {
+	
+	const join_table* table;
+	const bloom_filter* filter;
+	const hot_keys* hot;
+	const match_marks* marks;
+	const char* map;
+	const size_t* boundaries;
+	size_t nb_chunks;
+	const join_context* context;
+	
+	pthread_mutex_t lock;
+	pthread_cond_t turn;
+	size_t next_chunk;
+	size_t next_to_write;
+	int error;
+	
+};
+
+typedef struct parallel_probe_struct parallel_probe;
+
+/**
+ * @brief Probes the rows of one chunk of the mapped file and writes
+ * 		  what the mode of the join writes for them in the buffer of
+ * 		  the thread. Returns 0 on success, an error code of hash_join
+ * 		  otherwise
+ * 
+ * @param probe The shared state of the probe
+ * 		  chunk The index of the chunk
+ * 		  buffer The buffer of the thread
+ * 		  scratch The buffer of the thread where keys are encoded
+ * 		  stats The statistics of the thread, updated
+ */
+int probe_chunk(const parallel_probe* probe, size_t chunk, output_buffer* buffer, output_buffer* scratch, join_stats* stats) {
+	
+	csv_fields fields;
+	const join_keys* keys = probe->context->keys;
+	const bucket* found_elem = NULL;
+	const char* row = NULL;
+	const char* key = NULL;
+	size_t key_len = 0;
+	uint64_t hash = 0;
+	size_t position = probe->boundaries[chunk];
+	size_t end_of_chunk = probe->boundaries[chunk + 1];
+	size_t len = 0;
+	uint64_t start = 0;
+	int error = 0;
+	
+	while (position < end_of_chunk) {
+		
+		start = stats_clock(stats);
+		row = &probe->map[position];
+		len = csv_scan_row(row, end_of_chunk - position, &fields);
+		position += len + 1;
+		stats_add_time(stats, JOIN_PHASE_READ, start);
+		
+		if (len == 0) continue;
+		stats_add_row(stats, len);
+		
+		start = stats_clock(stats);
+		error = row_key(keys, keys->columns_second, row, len, &fields, scratch, &key, &key_len);
+		stats_add_time(stats, JOIN_PHASE_PARSE, start);
+		if (error != 0) return error;
+		
+		hash = probe->context->options->key_hash(key, key_len);
+		found_elem = probe_lookup(probe->table, probe->filter, probe->hot, hash, key, key_len, stats);
+		
+		if (found_elem != NULL && probe->marks->bits != NULL) mark_match(probe->marks, probe->table, hash, found_elem);
+		if (buffer_append_probe(buffer, found_elem, row, len, &fields, probe->context) != 0) return 3;
+		
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Body of a probe thread : takes chunks one after the other until
+ * 		  there is none left, probes each of them into its buffer, then
+ * 		  writes the buffer to the output file, waiting for its turn if
+ * 		  the output is ordered. The statistics of the thread are added
+ * 		  to those of the join at the end
+ * 
+ * @param arg The shared state of the probe
+ */
+void* probe_thread(void* arg) {
+	
+	parallel_probe* probe = arg;
+	output_buffer buffer = { NULL, 0, 0 };
+	output_buffer scratch = { NULL, 0, 0 };
+	join_stats stats;
+	size_t chunk = 0;
+	int error = 0;
+	
+	init_join_stats(&stats, probe->context->stats->timed);
+	
+	while (1) {
+		
+		pthread_mutex_lock(&probe->lock);
+		if (probe->error != 0 || probe->next_chunk >= probe->nb_chunks) {
+			pthread_mutex_unlock(&probe->lock);
+			break;
+		}
+		chunk = probe->next_chunk++;
+		pthread_mutex_unlock(&probe->lock);
+		
+		buffer.size = 0;
+		error = probe_chunk(probe, chunk, &buffer, &scratch, &stats);
+		
+		pthread_mutex_lock(&probe->lock);
+		if (probe->context->options->ordered_output != 0) {
+			while (probe->error == 0 && probe->next_to_write != chunk) {
+				pthread_cond_wait(&probe->turn, &probe->lock);
+			}
+		}
+		if (error == 0 && probe->error == 0) error = writer_write(probe->context->writer, buffer.data, buffer.size);
+		if (error != 0 && probe->error == 0) probe->error = error;
+		probe->next_to_write++;
+		pthread_cond_broadcast(&probe->turn);
+		pthread_mutex_unlock(&probe->lock);
+		
+	}
+	
+	pthread_mutex_lock(&probe->lock);
+	merge_join_stats(probe->context->stats, &stats);
+	pthread_mutex_unlock(&probe->lock);
+	
+	free(buffer.data);
+	buffer.data = NULL;
+	free(scratch.data);
+	scratch.data = NULL;
+	
+	return NULL;
+	
+}
+
+/**
+ * @brief Probes the rest of a mapped file with several threads sharing
+ * 		  the join table, which is not modified any more. The file is
+ * 		  cut in chunks of the size chosen with the hot keys, see
+ * 		  split_mapping, and each thread takes the next chunk as soon
+ * 		  as it is done with the previous one
+ * 
+ * @param table The join table
+ * 		  filter The Bloom filter of the join table
+ * 		  hot The hot keys of the probe file
+ * 		  marks The marks of the matched slots of the join table
+ * 		  probe The reader of the mapped probe file
+ * 		  context The context of the join
+ */
+int parallel_probe_join_table(const join_table* table, const bloom_filter* filter, const hot_keys* hot, const match_marks* marks, csv_reader* probe, const join_context* context) {
+	
+	parallel_probe shared;
+	size_t nb_chunks = 0;
+	size_t* boundaries = split_mapping(probe, hot->chunk_size, &nb_chunks);
+	size_t nb_threads = context->options->nb_threads < nb_chunks ? context->options->nb_threads : nb_chunks;
+	
+	if (boundaries == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour les threads de sondage\n");
+		return 3;
+	}
+	
+	shared.table = table;
+	shared.filter = filter;
+	shared.hot = hot;
+	shared.marks = marks;
+	shared.map = probe->map;
+	shared.boundaries = boundaries;
+	shared.nb_chunks = nb_chunks;
+	shared.context = context;
+	shared.next_chunk = 0;
+	shared.next_to_write = 0;
+	shared.error = 0;
+	pthread_mutex_init(&shared.lock, NULL);
+	pthread_cond_init(&shared.turn, NULL);
+	
+	run_threads(nb_threads, probe_thread, &shared);
+	
+	pthread_mutex_destroy(&shared.lock);
+	pthread_cond_destroy(&shared.turn);
+	free(boundaries);
+	
+	probe->position = probe->map_size;
+	
+	if (shared.error == 2 || shared.error == 13) print_key_error(shared.error, "du deuxième fichier");
+	if (shared.error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour le résultat d'un thread de sondage\n");
+	if (shared.error == 11) fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+	
+	return shared.error;
+	
+}
+
+/**
+ * @brief Writes what the mode of a join writes for the rows of the
+ * 		  first file in a join table, once the probe file is read :
+ * 		  those that found a match, or those that did not. They come
+ * 		  in the order of the slots, not in the order of the file
+ * 
+ * @param table The join table
+ * 		  marks The marks of the matched slots of the join table
+ * 		  context The context of the join
+ */
+int write_build_side(const join_table* table, const match_marks* marks, const join_context* context) {
+	
+	const Htable* hash_table = NULL;
+	size_t partition;
+	size_t i;
+	int error = 0;
+	
+	for (partition = 0; partition < table->nb_partitions && error == 0; partition++) {
+		hash_table = table->partitions[partition];
+		for (i = 0; i < hash_table->size && error == 0; i++) {
+			if (hash_table->content[i].key != NULL) {
+				error = writer_append_build(context->writer, &hash_table->content[i], slot_matched(marks, partition, i), context);
+			}
+		}
+	}
+	
+	if (error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour le fichier résultat\n");
+	if (error == 11) fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+	
+	return error;
+	
+}
+
+/**
+ * @brief Reads the whole probe file once and writes what the mode of
+ * 		  the join writes for each of its rows. A Bloom filter of
+ * 		  the table is built first, when it fits in the budget, so that
+ * 		  most rows without a match are rejected before the table is
+ * 		  read, and the hot keys of a mapped file are looked up before
+ * 		  both, see sample_hot_keys. A mapped file of more than one chunk is probed by
+ * 		  several threads when the options allow it. When the mode
+ * 		  needs them, the slots that found a match are marked, and the
+ * 		  rows of the table are written at the end of the probe.
+ * 		  Probe rows without a match can be kept in a residual file
+ * 		  instead, to be probed again against the next block of a
+ * 		  block nested join
+ * 
+ * @param table The join table
+ * 		  probe The reader of the file that can have several same key values
+ * 		  context The context of the join
+ * 		  residual The file where the probe rows without a match are
+ * 		  written, or NULL to write them as the mode says
+ */
+int probe_join_table(const join_table* table, csv_reader* probe, const join_context* context, FILE* residual) {
+	
+	const join_keys* keys = context->keys;
+	join_stats* stats = context->stats;
+	const bucket* found_elem = NULL;
+	bloom_filter filter;
+	hot_keys hot;
+	match_marks marks;
+	output_buffer scratch = { NULL, 0, 0 };
+	uint64_t hash = 0;
+	uint64_t phase_start = stats_clock(stats);
+	uint64_t start = 0;
+	int error = 0;
+	
+	const char* row = NULL;
+	size_t len = 0;
+	const char* key = NULL;
+	size_t key_len = 0;
+	
+	if (init_bloom_filter(&filter, table, context->accountant) != 0) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour le filtre de Bloom\n");
+		return 3;
+	}
+	
+	if (init_match_marks(&marks, table, context->options->mode, context->accountant) != 0) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour les marques des lignes appariées\n");
+		delete_bloom_filter(&filter);
+		return 3;
+	}
+	
+	sample_hot_keys(&hot, table, probe, context);
+	
+	if (residual == NULL && probe->map != NULL && probe->unread == 0 && context->options->nb_threads > 1 && probe->map_size - probe->position > hot.chunk_size) {
+		
+		error = parallel_probe_join_table(table, &filter, &hot, &marks, probe, context);
+		
+	} else {
+		
+		start = stats_clock(stats);
+		
+		while (error == 0 && reader_next_row(probe, &row, &len) != 0) {
+			
+			stats_add_time(stats, JOIN_PHASE_READ, start);
+			stats_add_row(stats, len);
+			
+			start = stats_clock(stats);
+			error = row_key(keys, keys->columns_second, row, len, &probe->fields, &scratch, &key, &key_len);
+			stats_add_time(stats, JOIN_PHASE_PARSE, start);
+			if (error != 0) {
+				print_key_error(error, "du deuxième fichier");
+				break;
+			}
+			
+			hash = context->options->key_hash(key, key_len);
+			found_elem = probe_lookup(table, &filter, &hot, hash, key, key_len, stats);
+			
+			if (found_elem != NULL && marks.bits != NULL) mark_match(&marks, table, hash, found_elem);
+			
+			if (found_elem == NULL && residual != NULL) {
+				if (fwrite(row, 1, len, residual) != len || fputc('\n', residual) == EOF) {
+					fprintf(stderr, "Erreur dans l'écriture d'un fichier temporaire de lignes sans correspondance\n");
+					error = 10;
+				}
+			} else {
+				error = writer_append_probe(context->writer, found_elem, row, len, &probe->fields, context);
+				if (error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour le fichier résultat\n");
+				if (error == 11) fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+			}
+			
+			start = stats_clock(stats);
+			
+		}
+		
+		if (error == 0 && reader_error(probe) != 0) {
+			fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
+			error = 4;
+		}
+		
+	}
+	
+	free(scratch.data);
+	scratch.data = NULL;
+	delete_bloom_filter(&filter);
+	
+	if (error == 0 && marks.bits != NULL) error = write_build_side(table, &marks, context);
+	
+	delete_match_marks(&marks);
+	
+	stats_add_time(stats, JOIN_PHASE_PROBE, phase_start);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Joins a build file bigger than the memory block by filling the
+ * 		  hash table block after block and rescanning the whole probe
+ * 		  file for each of them. Only used as a last resort, when
+ * 		  partitioning several times did not make the build side fit.
+ * 		  A probe row has at most one match, in a single block, so
+ * 		  when the mode writes the probe rows without a match, each
+ * 		  block but the last one keeps those it did not match in a
+ * 		  residual file, probed by the next block instead of the
+ * 		  whole file, and the last block writes the ones left. With
+ * 		  duplicate keys, the rows of a key can be in several blocks :
+ * 		  a right semi join keeps a residual file too, so that a probe
+ * 		  row is written once, and a right or full outer join probes
+ * 		  the whole file for the pairs, then the residual file only
+ * 		  for the rows without a match
+ * 
+ * @param hash_table The hash table, already filled with the first block
+ * 		  build The reader of the file that has unique key values
+ * 		  probe The reader of the seekable file that can have several same key values
+ * 		  context The context of the join
+ */
+int block_nested_join(Htable* hash_table, csv_reader* build, csv_reader* probe, const join_context* context) {
+	
+	memory_accountant* accountant = context->accountant;
+	int mode = context->options->mode;
+	int duplicates = context->options->duplicate_keys;
+	int keep_misses = join_outputs_probe_misses(mode) || (duplicates != 0 && mode == JOIN_RIGHT_SEMI);
+	int split = duplicates != 0 && (mode == JOIN_RIGHT_OUTER || mode == JOIN_FULL_OUTER);
+	size_t buffer_size = accountant->budget / GRACE_BUFFER_SHARE / 2;
+	char* buffers = NULL;
+	join_options pairs_options = *context->options;
+	join_options misses_options = *context->options;
+	join_context pairs_context = *context;
+	join_context misses_context = *context;
+	join_table table = { 1, { hash_table } };
+	csv_reader residual_reader;
+	csv_reader* current = probe;
+	FILE* previous = NULL;
+	FILE* residual = NULL;
+	size_t pass = 0;
+	size_t count = 0;
+	size_t bytes = 0;
+	int error = 0;
+	
+	long probe_start = reader_tell(probe);
+	
+	if (probe_start < 0) {
+		fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
+		return 4;
+	}
+	
+	/* A budget too small for the buffers leaves the residual files unbuffered, like the runs of a sort */
+	
+	if (buffer_size < GRACE_MIN_BUFFER_SIZE) buffer_size = 0;
+	if (buffer_size > BUFSIZ) buffer_size = BUFSIZ;
+	
+	/* The pairs keep the rows of the first file the mode writes, the misses are those of the second file */
+	
+	pairs_options.mode = (mode == JOIN_FULL_OUTER) ? JOIN_LEFT_OUTER : JOIN_INNER;
+	misses_options.mode = JOIN_RIGHT_MISSES;
+	pairs_context.options = &pairs_options;
+	misses_context.options = &misses_options;
+	
+	if (keep_misses != 0 && buffer_size > 0) {
+		buffers = malloc(2 * buffer_size);
+		if (buffers == NULL) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour les lignes sans correspondance\n");
+			return 3;
+		}
+		account_alloc(accountant, 2 * buffer_size);
+	}
+	
+	do {
+		
+		/* The residual file of a pass is read by the next one, they use the two buffers in turn */
+		
+		if (keep_misses != 0 && reader_at_end(build) == 0) {
+			residual = tmpfile();
+			if (residual == NULL) {
+				fprintf(stderr, "Impossible de créer un fichier temporaire de lignes sans correspondance\n");
+				error = 10;
+				break;
+			}
+			if (buffer_size > 0) setvbuf(residual, &buffers[(pass % 2) * buffer_size], _IOFBF, buffer_size);
+			else setvbuf(residual, NULL, _IONBF, 0);
+		}
+		
+		if (pass > 0) context->stats->rescans++;
+		if (split != 0) {
+			if (reader_seek(probe, probe_start) != 0) {
+				fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
+				error = 4;
+				break;
+			}
+			error = probe_join_table(&table, probe, &pairs_context, NULL);
+			if (error == 0 && current == probe && reader_seek(probe, probe_start) != 0) {
+				fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
+				error = 4;
+			}
+			if (error == 0) error = probe_join_table(&table, current, &misses_context, residual);
+		} else {
+			error = probe_join_table(&table, current, context, residual);
+		}
+		if (error != 0) break;
+		
+		if (residual != NULL) {
+			if (previous != NULL) {
+				close_csv_reader(&residual_reader);
+				fclose(previous);
+			}
+			rewind(residual);
+			init_csv_reader(&residual_reader, residual);
+			current = &residual_reader;
+			previous = residual;
+			residual = NULL;
+		} else if (reader_seek(probe, probe_start) != 0) {
+			fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
+			error = 4;
+			break;
+		}
+		
+		/* The whole block is released in one go, its memory is reused by the next one */
+		
+		clear_Htable(hash_table);
+		
+		count = 0;
+		error = fill_Htable(hash_table, build, context, 0, &count, &bytes);
+		pass++;
+		
+	} while (error == 0 && count > 0);
+	
+	if (residual != NULL) fclose(residual);
+	if (previous != NULL) {
+		close_csv_reader(&residual_reader);
+		fclose(previous);
+	}
+	
+	if (buffers != NULL) {
+		free(buffers);
+		account_free(accountant, 2 * buffer_size);
+	}
+	
+	return error;
+	
+}
+
+/**
+ * @brief Chooses the number of partitions so that each one of them
+ * 		  should fit in the hash table, from the rows already read
+ * 		  and what remains in the build file
+ * 
+ * @param build The reader of the file that has unique key values
+ * 		  count The number of rows already read, which filled a block
+ * 		  bytes The number of bytes of the rows already read
+ */
+size_t grace_partition_count(csv_reader* build, size_t count, size_t bytes) {
+	
+	long bytes_left = reader_bytes_left(build);
+	double estimated_rows = 0.0;
+	size_t nb_partitions = GRACE_MAX_PARTITIONS;
+	
+	/* A file we cannot seek in gets the maximum fanout, the next levels refine it */
+	
+	if (bytes_left >= 0 && count > 0 && bytes > 0) {
+		estimated_rows = count + (double) bytes_left * count / bytes;
+		nb_partitions = estimated_rows / (count * GRACE_PARTITION_FILL) + 1;
+	}
+	
+	if (nb_partitions < 2) nb_partitions = 2;
+	if (nb_partitions > GRACE_MAX_PARTITIONS) nb_partitions = GRACE_MAX_PARTITIONS;
+	
+	return nb_partitions;
+	
+}
+
+/**
+ * @brief Appends a row to its partition file
+ * 
+ * @param partitions The partition files
+ * 		  nb_partitions The number of partitions
+ * 		  hash The low 32 bits of the hash of the key of the row
+ * 		  row The row
+ * 		  len The length of the row
+ * 		  level The recursion level
+ */
+int spill_row(FILE* partitions[], size_t nb_partitions, uint32_t hash, const char* row, size_t len, size_t level) {
+	
+	FILE* partition = partitions[grace_partition(hash, level, nb_partitions)];
+	
+	if (fwrite(row, 1, len, partition) != len || fputc('\n', partition) == EOF) {
+		fprintf(stderr, "Erreur dans l'écriture d'un fichier temporaire de partition\n");
+		return 10;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Reads a file until its end and spills each of its rows
+ * 		  into its partition file
+ * 
+ * @param reader The reader of the file
+ * 		  partitions The partition files
+ * 		  nb_partitions The number of partitions
+ * 		  keys The key of the join
+ * 		  columns The indexes of the key columns in the file
+ * 		  key_hash The function that hashes the keys
+ * 		  level The recursion level
+ * 		  stats The statistics of the join
+ */
+int spill_rows(csv_reader* reader, FILE* partitions[], size_t nb_partitions, const join_keys* keys, const size_t* columns, key_hash_function key_hash, size_t level, join_stats* stats) {
+	
+	const char* row = NULL;
+	size_t len = 0;
+	const char* key = NULL;
+	size_t key_len = 0;
+	output_buffer scratch = { NULL, 0, 0 };
+	uint64_t start = stats_clock(stats);
+	int error = 0;
+	
+	while (error == 0 && reader_next_row(reader, &row, &len) != 0) {
+		stats_add_time(stats, JOIN_PHASE_READ, start);
+		stats_add_row(stats, len);
+		start = stats_clock(stats);
+		error = row_key(keys, columns, row, len, &reader->fields, &scratch, &key, &key_len);
+		stats_add_time(stats, JOIN_PHASE_PARSE, start);
+		if (error != 0) {
+			print_key_error(error, "à partitionner");
+			break;
+		}
+		error = spill_row(partitions, nb_partitions, key_hash(key, key_len), row, len, level);
+		start = stats_clock(stats);
+	}
+	
+	free(scratch.data);
+	scratch.data = NULL;
+	
+	if (error == 0 && reader_error(reader) != 0) {
+		fprintf(stderr, "Erreur dans la lecture d'un fichier à partitionner\n");
+		return 4;
+	}
+	
+	return error;
+	
+}
+
+/**
+ * @brief Spills the content of the hash table into the partition
+ * 		  files, every row of a key, with the hashes kept in its slots
+ * 
+ * @param hash_table The hash table
+ * 		  partitions The partition files
+ * 		  nb_partitions The number of partitions
+ * 		  level The recursion level
+ */
+int spill_Htable(const Htable* hash_table, FILE* partitions[], size_t nb_partitions, size_t level) {
+	
+	size_t i;
+	size_t j;
+	int error = 0;
+	
+	const bucket* slot = NULL;
+	bucket single;
+	
+	for (i = 0; i < hash_table->size && error == 0; i++) {
+		slot = &hash_table->content[i];
+		for (j = 0; slot->key != NULL && j < bucket_nb_rows(slot) && error == 0; j++) {
+			single = bucket_row(slot, j);
+			error = spill_row(partitions, nb_partitions, slot->hash, single.value, single.value_len, level);
+		}
+	}
+	
+	return error;
+	
+}
+
+int join_partition(csv_reader* build, csv_reader* probe, const join_context* context, size_t level);
+
+/**
+ * @brief Partitioned (Grace) join, used when the build file does not fit
+ * 		  in the hash table. Both files are hashed on their key into
+ * 		  temporary partition files, then each pair of partitions is
+ * 		  joined once, so that the probe file is never rescanned. The
+ * 		  buffers of the partition files take a share of the budget
+ * 
+ * @param hash_table The hash table, already filled with the first block
+ * 		  build The reader of the file that has unique key values
+ * 		  probe The reader of the file that can have several same key values
+ * 		  context The context of the join
+ * 		  count The number of rows in the hash table
+ * 		  bytes The number of bytes of the rows in the hash table
+ * 		  level The recursion level
+ */
+int grace_join(Htable** hash_table, csv_reader* build, csv_reader* probe, const join_context* context, size_t count, size_t bytes, size_t level) {
+	
+	memory_accountant* accountant = context->accountant;
+	size_t nb_partitions = grace_partition_count(build, count, bytes);
+	size_t buffer_size = accountant->budget / GRACE_BUFFER_SHARE / (2 * nb_partitions);
+	char* buffers = NULL;
+	
+	FILE* build_partitions[GRACE_MAX_PARTITIONS] = { NULL };
+	FILE* probe_partitions[GRACE_MAX_PARTITIONS] = { NULL };
+	csv_reader build_partition;
+	csv_reader probe_partition;
+	
+	uint64_t start = 0;
+	size_t i;
+	int error = 0;
+	
+	/* A budget too small for the buffers leaves the partition files unbuffered, like the runs of a sort */
+	
+	if (buffer_size < GRACE_MIN_BUFFER_SIZE) buffer_size = 0;
+	if (buffer_size > BUFSIZ) buffer_size = BUFSIZ;
+	
+	if (buffer_size > 0) {
+		buffers = malloc(2 * nb_partitions * buffer_size);
+		if (buffers == NULL) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour les partitions\n");
+			return 3;
+		}
+		account_alloc(accountant, 2 * nb_partitions * buffer_size);
+	}
+	
+	for (i = 0; i < nb_partitions && error == 0; i++) {
+		build_partitions[i] = tmpfile();
+		probe_partitions[i] = tmpfile();
+		if (build_partitions[i] == NULL || probe_partitions[i] == NULL) {
+			fprintf(stderr, "Impossible de créer un fichier temporaire de partition\n");
+			error = 10;
+		} else if (buffer_size > 0) {
+			setvbuf(build_partitions[i], &buffers[2 * i * buffer_size], _IOFBF, buffer_size);
+			setvbuf(probe_partitions[i], &buffers[(2 * i + 1) * buffer_size], _IOFBF, buffer_size);
+		} else {
+			setvbuf(build_partitions[i], NULL, _IONBF, 0);
+			setvbuf(probe_partitions[i], NULL, _IONBF, 0);
+		}
+	}
+	
+	/* The rows already in memory are spilled first, then the table is released before streaming the rest */
+	
+	start = stats_clock(context->stats);
+	
+	if (error == 0) error = spill_Htable(*hash_table, build_partitions, nb_partitions, level);
+	delete_Htable_and_content(hash_table);
+	
+	if (error == 0) error = spill_rows(build, build_partitions, nb_partitions, context->keys, context->keys->columns_first, context->options->key_hash, level, context->stats);
+	if (error == 0) error = spill_rows(probe, probe_partitions, nb_partitions, context->keys, context->keys->columns_second, context->options->key_hash, level, context->stats);
+	
+	stats_add_time(context->stats, JOIN_PHASE_PARTITION, start);
+	
+	for (i = 0; i < nb_partitions && error == 0; i++) {
+		
+		/* A partition with no row on one of its sides cannot produce any output, unless the mode writes the rows without a match */
+		
+		if ((ftell(build_partitions[i]) > 0 && (ftell(probe_partitions[i]) > 0 || join_marks_matches(context->options->mode) != 0)) || (ftell(probe_partitions[i]) > 0 && join_outputs_probe_misses(context->options->mode) != 0)) {
+			rewind(build_partitions[i]);
+			rewind(probe_partitions[i]);
+			init_csv_reader(&build_partition, build_partitions[i]);
+			init_csv_reader(&probe_partition, probe_partitions[i]);
+			error = join_partition(&build_partition, &probe_partition, context, level + 1);
+			close_csv_reader(&build_partition);
+			close_csv_reader(&probe_partition);
+		}
+		
+		fclose(build_partitions[i]);
+		build_partitions[i] = NULL;
+		fclose(probe_partitions[i]);
+		probe_partitions[i] = NULL;
+		
+	}
+	
+	for (i = 0; i < nb_partitions; i++) {
+		if (build_partitions[i] != NULL) fclose(build_partitions[i]);
+		if (probe_partitions[i] != NULL) fclose(probe_partitions[i]);
+	}
+	
+	free(buffers);
+	account_free(accountant, 2 * nb_partitions * buffer_size);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Datastructure for type build_entry, a row of a mapped build
+ * 		  file found by a scan thread : its offset in the mapping, its
+ * 		  length, the bounds of its key and the hash of the key
+ */
+struct build_entry_struct {
+	
+	size_t row;
+	uint64_t hash;
+	uint32_t len;
+	uint32_t key_start;
+	uint32_t key_len;
+	
+};
+
+typedef struct build_entry_struct build_entry;
+
+/**
+ * @brief Datastructure for type build_chunk, the rows of one chunk of
+ * 		  a mapped build file grouped by partition : the rows of the
+ * 		  partition p are entries[offsets[p]] to entries[offsets[p + 1] - 1],
+ * 		  in the order of the file
+ */
+struct build_chunk_struct {
+	
+	build_entry* entries;
+	size_t offsets[BUILD_MAX_PARTITIONS + 1];
+	
+};
+
+typedef struct build_chunk_struct build_chunk;
+
+/**
+ * @brief Datastructure for type parallel_build, shared by the threads
+ * 		  that build a join table from a mapped file : first each thread
+ * 		  scans chunks of the file, then each one fills whole partitions,
+ * 		  so that no table is ever touched by two threads. The scans add
+ * 		  what they read to their own statistics under the lock, which
+ * 		  only go to the join if the build succeeds, since the rows are
+ * 		  read again otherwise. They also count the rows and bytes they
+ * 		  scanned, to tell early when the tables will not fit
+ */
+struct parallel_build_struct {
+	
+	const char* map;
+	const size_t* boundaries;
+	size_t nb_chunks;
+	build_chunk* chunks;
+	join_table* table;
+	size_t column;
+	key_hash_function key_hash;
+	memory_accountant* accountant;
+	join_stats stats;
+	int marks;
+	
+	pthread_mutex_t lock;
+	size_t scanned_rows;
+	size_t scanned_bytes;
+	size_t base_memory;
+	size_t next_task;
+	size_t nb_tasks;
+	int error;
+	
+};
+
+typedef struct parallel_build_struct parallel_build;
+
+/**
+ * @brief Takes the next task of a parallel build, or returns 0 if
+ * 		  there is none left or an error happened
+ * 
+ * @param build The shared state of the build
+ * 		  task The index of the task, set
+ */
+int next_build_task(parallel_build* build, size_t* task) {
+	
+	int found = 0;
+	
+	pthread_mutex_lock(&build->lock);
+	if (build->error == 0 && build->next_task < build->nb_tasks) {
+		*task = build->next_task++;
+		found = 1;
+	}
+	pthread_mutex_unlock(&build->lock);
+	
+	return found;
+	
+}
+
+/**
+ * @brief Counts some more bytes for a parallel build if they fit in
+ * 		  the budget. Returns 1 if they do, 0 otherwise
+ * 
+ * @param build The shared state of the build
+ * 		  bytes The number of bytes
+ */
+int reserve_build_memory(parallel_build* build, size_t bytes) {
+	
+	int fits = 0;
+	
+	pthread_mutex_lock(&build->lock);
+	fits = account_fits(build->accountant, bytes);
+	if (fits != 0) account_alloc(build->accountant, bytes);
+	pthread_mutex_unlock(&build->lock);
+	
+	return fits;
+	
+}
+
+/**
+ * @brief Gives back bytes counted by reserve_build_memory
+ * 
+ * @param build The shared state of the build
+ * 		  bytes The number of bytes
+ */
+void release_build_memory(parallel_build* build, size_t bytes) {
+	
+	pthread_mutex_lock(&build->lock);
+	account_free(build->accountant, bytes);
+	pthread_mutex_unlock(&build->lock);
+	
+}
+
+/**
+ * @brief Adds the rows a scan of a parallel build just read to those
+ * 		  of all the scans and, once they have read one
+ * 		  BUILD_SAMPLE_SHARE of the file, guesses from them how many
+ * 		  rows the whole file has. Returns BUILD_DOES_NOT_FIT if the
+ * 		  tables and the sorted entries of that many rows would not fit
+ * 		  in what was left of the budget when the build started, so
+ * 		  that the scans stop long before the end of the file when the
+ * 		  rows are much shorter than JOIN_ROW_SIZE_ESTIMATE. Returns
+ * 		  the error of another scan if there was one, 0 otherwise
+ * 
+ * @param build The shared state of the build
+ * 		  rows The number of rows just read
+ * 		  bytes The number of bytes of those rows
+ */
+int check_build_budget(parallel_build* build, size_t rows, size_t bytes) {
+	
+	size_t nb_partitions = build->table->nb_partitions;
+	size_t file_size = build->boundaries[build->nb_chunks] - build->boundaries[0];
+	size_t total_rows = 0;
+	size_t partition_size = 0;
+	size_t needed = 0;
+	int error = 0;
+	
+	pthread_mutex_lock(&build->lock);
+	build->scanned_rows += rows;
+	build->scanned_bytes += bytes;
+	error = build->error;
+	if (error == 0) {
+		
+		/* The start of each chunk may not look like the rest of the file, so a small sample only counts what it read */
+		
+		total_rows = build->scanned_rows;
+		if (build->scanned_bytes >= file_size / BUILD_SAMPLE_SHARE && build->scanned_bytes < file_size) {
+			total_rows = (double) build->scanned_rows / build->scanned_bytes * file_size;
+		}
+		partition_size = round_up_power_of_two(total_rows / nb_partitions / HASH_TABLE_LOAD_FACTOR + 2);
+		needed = nb_partitions * (sizeof(Htable) + partition_size * sizeof(bucket)) + bloom_filter_bytes(total_rows);
+		needed += total_rows * sizeof(build_entry);
+		if (build->marks != 0) needed += match_marks_bytes(nb_partitions * partition_size);
+		if (build->base_memory + needed > build->accountant->budget) error = BUILD_DOES_NOT_FIT;
+		
+	}
+	pthread_mutex_unlock(&build->lock);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Scans the rows of one chunk of a mapped build file, hashes
+ * 		  their keys and groups them by partition with a counting sort.
+ * 		  Every array is counted by the accountant before it is
+ * 		  allocated, and the rows read are checked against the budget
+ * 		  every BUILD_CHECK_ROWS rows. Returns 0 on success,
+ * 		  BUILD_DOES_NOT_FIT if the arrays or the tables would go over
+ * 		  the budget, an error code of hash_join otherwise
+ * 
+ * @param build The shared state of the build
+ * 		  chunk The index of the chunk
+ */
+int scan_build_chunk(parallel_build* build, size_t chunk) {
+	
+	size_t nb_partitions = build->table->nb_partitions;
+	build_chunk* current = &build->chunks[chunk];
+	build_entry* entries = NULL;
+	build_entry* sorted = NULL;
+	size_t nb_entries = 0;
+	size_t capacity = 0;
+	size_t new_capacity = 0;
+	size_t checked_entries = 0;
+	size_t counts[BUILD_MAX_PARTITIONS + 1] = { 0 };
+	
+	csv_fields fields;
+	join_stats stats;
+	const char* row = NULL;
+	size_t position = build->boundaries[chunk];
+	size_t checked_position = position;
+	size_t end_of_chunk = build->boundaries[chunk + 1];
+	size_t len = 0;
+	size_t start = 0;
+	size_t end = 0;
+	uint64_t time = 0;
+	size_t i;
+	int found = 0;
+	int error = 0;
+	
+	init_join_stats(&stats, build->stats.timed);
+	
+	while (position < end_of_chunk && error == 0) {
+		
+		time = stats_clock(&stats);
+		row = &build->map[position];
+		len = csv_scan_row(row, end_of_chunk - position, &fields);
+		position += len + 1;
+		stats_add_time(&stats, JOIN_PHASE_READ, time);
+		
+		if (len == 0) continue;
+		stats_add_row(&stats, len);
+		
+		time = stats_clock(&stats);
+		found = csv_field(row, len, &fields, build->column, &start, &end);
+		stats_add_time(&stats, JOIN_PHASE_PARSE, time);
+		if (found == 0) {
+			error = 2;
+			break;
+		}
+		
+		if (nb_entries == capacity) {
+			new_capacity = capacity > 0 ? 2 * capacity : CSV_MAX_LINE_SIZE;
+			if (reserve_build_memory(build, (new_capacity - capacity) * sizeof(build_entry)) == 0) {
+				error = BUILD_DOES_NOT_FIT;
+				break;
+			}
+			sorted = realloc(entries, new_capacity * sizeof(build_entry));
+			if (sorted == NULL) {
+				release_build_memory(build, (new_capacity - capacity) * sizeof(build_entry));
+				error = 3;
+				break;
+			}
+			entries = sorted;
+			sorted = NULL;
+			capacity = new_capacity;
+		}
+		
+		entries[nb_entries].row = row - build->map;
+		entries[nb_entries].len = len;
+		entries[nb_entries].hash = build->key_hash(&row[start], end - start);
+		entries[nb_entries].key_start = start;
+		entries[nb_entries].key_len = end - start;
+		counts[join_table_partition(entries[nb_entries].hash, nb_partitions) + 1]++;
+		nb_entries++;
+		
+		if (nb_entries - checked_entries >= BUILD_CHECK_ROWS) {
+			error = check_build_budget(build, nb_entries - checked_entries, position - checked_position);
+			checked_entries = nb_entries;
+			checked_position = position;
+		}
+		
+	}
+	
+	/* The scanned entries and their sorted copy are both held for a moment */
+	
+	if (error == 0 && nb_entries > 0) {
+		if (reserve_build_memory(build, nb_entries * sizeof(build_entry)) == 0) {
+			error = BUILD_DOES_NOT_FIT;
+		} else {
+			sorted = malloc(nb_entries * sizeof(build_entry));
+			if (sorted == NULL) {
+				release_build_memory(build, nb_entries * sizeof(build_entry));
+				error = 3;
+			}
+		}
+	}
+	
+	if (error == 0) {
+		for (i = 1; i <= nb_partitions; i++) {
+			counts[i] += counts[i - 1];
+		}
+		memcpy(current->offsets, counts, (nb_partitions + 1) * sizeof(size_t));
+		for (i = 0; i < nb_entries; i++) {
+			sorted[counts[join_table_partition(entries[i].hash, nb_partitions)]++] = entries[i];
+		}
+		current->entries = sorted;
+	}
+	
+	free(entries);
+	entries = NULL;
+	release_build_memory(build, capacity * sizeof(build_entry));
+	
+	pthread_mutex_lock(&build->lock);
+	merge_join_stats(&build->stats, &stats);
+	pthread_mutex_unlock(&build->lock);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Body of a scan thread of a parallel build, see scan_build_chunk
+ * 
+ * @param arg The shared state of the build
+ */
+void* scan_build_thread(void* arg) {
+	
+	parallel_build* build = arg;
+	size_t chunk = 0;
+	int error = 0;
+	
+	while (next_build_task(build, &chunk) != 0) {
+		error = scan_build_chunk(build, chunk);
+		if (error != 0) {
+			pthread_mutex_lock(&build->lock);
+			if (build->error == 0) build->error = error;
+			pthread_mutex_unlock(&build->lock);
+		}
+	}
+	
+	return NULL;
+	
+}
+
+/**
+ * @brief Body of a fill thread of a parallel build : takes partitions
+ * 		  one after the other and adds their rows of every chunk, in
+ * 		  the order of the file, to their own table. The tables already
+ * 		  have their final size and mapped rows are views, so nothing is
+ * 		  allocated and no lock is taken
+ * 
+ * @param arg The shared state of the build
+ */
+void* fill_partition_thread(void* arg) {
+	
+	parallel_build* build = arg;
+	Htable* hash_table = NULL;
+	const build_entry* entry = NULL;
+	const char* row = NULL;
+	size_t partition = 0;
+	size_t chunk;
+	size_t i;
+	
+	while (next_build_task(build, &partition) != 0) {
+		hash_table = build->table->partitions[partition];
+		for (chunk = 0; chunk < build->nb_chunks; chunk++) {
+			for (i = build->chunks[chunk].offsets[partition]; i < build->chunks[chunk].offsets[partition + 1]; i++) {
+				entry = &build->chunks[chunk].entries[i];
+				row = &build->map[entry->row];
+				add_Htable_entry_hashed(hash_table, entry->hash, &row[entry->key_start], entry->key_len, row, entry->len);
+			}
+		}
+	}
+	
+	return NULL;
+	
+}
+
+/**
+ * @brief Frees the partitions of a join table built in parallel
+ * 
+ * @param table The join table
+ */
+void delete_join_table_partitions(join_table* table) {
+	
+	size_t i;
+	
+	for (i = 0; i < table->nb_partitions; i++) {
+		delete_Htable_and_content(&table->partitions[i]);
+	}
+	
+}
+
+/**
+ * @brief Builds a join table from the rest of a mapped build file with
+ * 		  several threads, in two steps that need no lock on the tables :
+ * 		  chunks of the file are scanned in parallel and their rows are
+ * 		  grouped by partition, then each partition is given its own
+ * 		  table, sized for its exact number of rows, and filled by one
+ * 		  thread. Returns 0 on success, BUILD_DOES_NOT_FIT if the whole
+ * 		  build file does not fit in the budget, in which case nothing
+ * 		  was read from it, an error code of hash_join otherwise
+ * 
+ * @param table The join table, set
+ * 		  build The reader of the mapped file that has unique key values
+ * 		  context The context of the join
+ */
+int parallel_build_join_table(join_table* table, csv_reader* build, const join_context* context) {
+	
+	memory_accountant* accountant = context->accountant;
+	parallel_build shared;
+	size_t nb_chunks = 0;
+	size_t* boundaries = split_mapping(build, PARALLEL_CHUNK_SIZE, &nb_chunks);
+	build_chunk* chunks = calloc(nb_chunks, sizeof(build_chunk));
+	size_t nb_threads = context->options->nb_threads;
+	size_t sizes[BUILD_MAX_PARTITIONS] = { 0 };
+	size_t tables_size = 0;
+	size_t total_rows = 0;
+	size_t total_slots = 0;
+	size_t rows = 0;
+	size_t partition;
+	size_t i;
+	uint64_t start = stats_clock(context->stats);
+	int error = 0;
+	
+	if (boundaries == NULL || chunks == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour la construction parallèle\n");
+		free(boundaries);
+		free(chunks);
+		return 3;
+	}
+	account_alloc(accountant, nb_chunks * sizeof(build_chunk));
+	
+	/* A few partitions per thread keep the threads busy even if some partitions are bigger */
+	
+	table->nb_partitions = BUILD_PARTITIONS_PER_THREAD * nb_threads < BUILD_MAX_PARTITIONS ? BUILD_PARTITIONS_PER_THREAD * nb_threads : BUILD_MAX_PARTITIONS;
+	memset(table->partitions, 0, sizeof(table->partitions));
+	
+	shared.map = build->map;
+	shared.boundaries = boundaries;
+	shared.nb_chunks = nb_chunks;
+	shared.chunks = chunks;
+	shared.table = table;
+	shared.column = context->keys->columns_first[0];
+	shared.key_hash = context->options->key_hash;
+	shared.accountant = accountant;
+	init_join_stats(&shared.stats, context->stats->timed);
+	shared.marks = join_marks_matches(context->options->mode);
+	shared.scanned_rows = 0;
+	shared.scanned_bytes = 0;
+	shared.base_memory = accountant->current;
+	shared.next_task = 0;
+	shared.nb_tasks = nb_chunks;
+	shared.error = 0;
+	pthread_mutex_init(&shared.lock, NULL);
+	
+	run_threads(nb_threads < nb_chunks ? nb_threads : nb_chunks, scan_build_thread, &shared);
+	error = shared.error;
+	
+	/* Every table is sized for its partition, and they must all fit with their Bloom filter and marks before any is built */
+	
+	for (partition = 0; partition < table->nb_partitions && error == 0; partition++) {
+		rows = 0;
+		for (i = 0; i < nb_chunks; i++) {
+			rows += chunks[i].offsets[partition + 1] - chunks[i].offsets[partition];
+		}
+		sizes[partition] = round_up_power_of_two(rows / HASH_TABLE_LOAD_FACTOR + 2);
+		tables_size += sizeof(Htable) + sizes[partition] * sizeof(bucket);
+		total_rows += rows;
+		total_slots += sizes[partition];
+	}
+	tables_size += bloom_filter_bytes(total_rows);
+	if (join_marks_matches(context->options->mode) != 0) tables_size += match_marks_bytes(total_slots);
+	if (error == 0 && account_fits(accountant, tables_size) == 0) error = BUILD_DOES_NOT_FIT;
+	
+	for (partition = 0; partition < table->nb_partitions && error == 0; partition++) {
+		table->partitions[partition] = construct_Htable_with_chunks(sizes[partition], sizes[partition], ARENA_CHUNK_SIZE, accountant);
+		if (table->partitions[partition] == NULL) error = 3;
+		else table->partitions[partition]->key_hash = context->options->key_hash;
+	}
+	
+	if (error == 0) {
+		shared.next_task = 0;
+		shared.nb_tasks = table->nb_partitions;
+		run_threads(nb_threads < table->nb_partitions ? nb_threads : table->nb_partitions, fill_partition_thread, &shared);
+		build->position = build->map_size;
+		merge_join_stats(context->stats, &shared.stats);
+		context->stats->build_blocks++;
+	} else {
+		delete_join_table_partitions(table);
+	}
+	
+	for (i = 0; i < nb_chunks; i++) {
+		if (chunks[i].entries != NULL) account_free(accountant, chunks[i].offsets[table->nb_partitions] * sizeof(build_entry));
+		free(chunks[i].entries);
+		chunks[i].entries = NULL;
+	}
+	account_free(accountant, nb_chunks * sizeof(build_chunk));
+	
+	pthread_mutex_destroy(&shared.lock);
+	free(chunks);
+	free(boundaries);
+	
+	if (error == 2) fprintf(stderr, "Clé introuvable dans une ligne du premier fichier\n");
+	if (error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour la construction parallèle\n");
+	
+	stats_add_time(context->stats, JOIN_PHASE_BUILD, start);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Joins the rows of a build file with the rows of a probe file.
+ * 		  If the build file fits in the part of the budget that is left,
+ * 		  the probe file is read only once. A big mapped build file is
+ * 		  then first tried with a parallel build. Otherwise both files
+ * 		  are partitioned, down to GRACE_MAX_DEPTH levels, after which
+ * 		  the remaining rows are joined block after block
+ * 
+ * @param build The reader of the file that has unique key values
+ * 		  probe The reader of the file that can have several same key values
+ * 		  context The context of the join
+ * 		  level The recursion level
+ */
+int join_partition(csv_reader* build, csv_reader* probe, const join_context* context, size_t level) {
+	
+	memory_accountant* accountant = context->accountant;
+	
+	/* A table that may still be partitioned leaves room for the buffers of the partitions, grace_join takes them while it is full */
+	
+	size_t reserve = level < GRACE_MAX_DEPTH ? accountant->budget / GRACE_BUFFER_SHARE : 0;
+	size_t memory_left = accountant->budget > accountant->current + reserve ? accountant->budget - accountant->current - reserve : 0;
+	size_t size = Htable_size_for_budget(memory_left);
+	size_t initial_size = HTABLE_INITIAL_SIZE;
+	long bytes_left = reader_bytes_left(build);
+	
+	/* Small budgets get small chunks, so that the arena does not overshoot them by much */
+	
+	size_t chunk_size = memory_left / 16 < ARENA_CHUNK_SIZE ? memory_left / 16 : ARENA_CHUNK_SIZE;
+	Htable* hash_table = NULL;
+	join_table table = { 1, { NULL } };
+	size_t count = 0;
+	size_t bytes = 0;
+	int error = 0;
+	
+	/* The parallel build is only tried for raw unique keys, and if the whole build file should fit in what is left of the budget */
+	
+	if (keys_are_raw(context->keys) != 0 && context->options->duplicate_keys == 0 && build->map != NULL && build->unread == 0 && context->options->nb_threads > 1 && build->map_size - build->position > PARALLEL_CHUNK_SIZE && (build->map_size - build->position) / JOIN_ROW_SIZE_ESTIMATE <= size * HASH_TABLE_LOAD_FACTOR) {
+		error = parallel_build_join_table(&table, build, context);
+		if (error == 0) error = probe_join_table(&table, probe, context, NULL);
+		if (error != BUILD_DOES_NOT_FIT) {
+			delete_join_table_partitions(&table);
+			return error;
+		}
+		error = 0;
+	}
+	
+	/* The table starts with the size the rest of the build file should need, when it is known, */
+	/* and grows with the rows up to the size the budget allows */
+	
+	if (bytes_left > 0 && bytes_left / JOIN_ROW_SIZE_ESTIMATE / HASH_TABLE_LOAD_FACTOR > initial_size) initial_size = bytes_left / JOIN_ROW_SIZE_ESTIMATE / HASH_TABLE_LOAD_FACTOR;
+	if (initial_size > round_down_power_of_two(size)) initial_size = round_down_power_of_two(size);
+	
+	hash_table = construct_Htable_with_chunks(initial_size > 2 ? initial_size : 2, size, chunk_size, accountant);
+	if (hash_table == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour la hash table\n");
+		return 3;
+	}
+	hash_table->key_hash = context->options->key_hash;
+	
+	error = fill_Htable(hash_table, build, context, reserve, &count, &bytes);
+	
+	if (error == 0) {
+		if (reader_at_end(build) != 0) {
+			table.nb_partitions = 1;
+			table.partitions[0] = hash_table;
+			error = probe_join_table(&table, probe, context, NULL);
+		} else if (level >= GRACE_MAX_DEPTH) {
+			error = block_nested_join(hash_table, build, probe, context);
+		} else {
+			error = grace_join(&hash_table, build, probe, context, count, bytes, level);
+		}
+	}
+	
+	if (hash_table != NULL) delete_Htable_and_content(&hash_table);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Prints the statistics of a join on stderr as a single line of
+ * 		  JSON, to be read by other tools. The false positive rate of
+ * 		  the Bloom filter is the share of the keys missing from the
+ * 		  table that it let through
+ * 
+ * @param stats The statistics of the join
+ * 		  accountant The accountant of the memory of the join
+ * 		  total_ns The nanoseconds taken by the whole join
+ */
+void print_join_report(const join_stats* stats, const memory_accountant* accountant, uint64_t total_ns) {
+	
+	size_t i;
+	
+	fprintf(stderr, "{\"budget\":%zu,\"peak_memory\":%zu,\"rows_read\":%zu,\"bytes_read\":%zu,\"bytes_written\":%zu,", accountant->budget, accountant->peak, stats->rows_read, stats->bytes_read, stats->bytes_written);
+	fprintf(stderr, "\"matches\":%zu,\"build_blocks\":%zu,\"rescans\":%zu,", stats->matches, stats->build_blocks, stats->rescans);
+	fprintf(stderr, "\"hot\":{\"keys\":%zu,\"hits\":%zu},", stats->hot_keys, stats->hot_hits);
+	fprintf(stderr, "\"bloom\":{\"tested\":%zu,\"rejected\":%zu,\"false_positives\":%zu,\"false_positive_rate\":%.4f},", stats->tested, stats->rejected, stats->false_positives, stats->rejected + stats->false_positives > 0 ? (double) stats->false_positives / (stats->rejected + stats->false_positives) : 0.0);
+	fprintf(stderr, "\"phases_ns\":{\"total\":%llu", (unsigned long long) total_ns);
+	for (i = 0; i < JOIN_NB_PHASES; i++) {
+		fprintf(stderr, ",\"%s\":%llu", join_phase_names[i], (unsigned long long) stats->phase_ns[i]);
+	}
+	fprintf(stderr, "},\"chain_lengths\":[");
+	for (i = 0; i < JOIN_CHAIN_LENGTHS; i++) {
+		fprintf(stderr, i > 0 ? ",%zu" : "%zu", stats->chain_lengths[i]);
+	}
+	fprintf(stderr, "]}\n");
+	
+}
+
+/**
+ * @brief Sets the key of a join to a single text column
+ * 
+ * @param keys The key of the join, set
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ */
+void single_join_keys(join_keys* keys, size_t column_first_file, size_t column_second_file) {
+	
+	keys->nb_columns = 1;
+	keys->columns_first[0] = column_first_file;
+	keys->columns_second[0] = column_second_file;
+	keys->types[0] = KEY_TEXT;
+	
+}
+
+/**
+ * @brief Returns the number of columns of a CSV row
+ * 
+ * @param row The row
+ */
+size_t row_nb_fields(const csv_const_row row) {
+	
+	size_t nb_fields = 1;
+	size_t i;
+	
+	for (i = 0; row[i] != '\0'; i++) {
+		if (row[i] == CSV_SEPARATOR) nb_fields++;
+	}
+	
+	return nb_fields;
+	
+}
+
+/**
+ * @brief Reads the header of both files, checks that each column of
+ * 		  the key exists in both of them with the same name, and
+ * 		  writes the header of the result : the header of the file
+ * 		  kept by a semi or anti join, or both headers, without the
+ * 		  key columns of the second file. Returns 0 on success, an
+ * 		  error code of hash_join otherwise
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  keys The key of the join
+ * 		  mode The mode of the join
+ * 		  nb_fields_first The number of columns of the first file, set
+ * 		  second_padding The number of separators a row of the second
+ * 		  file adds to a joined row, set
+ */
+int join_key_headers(FILE* first_file, FILE* second_file, FILE* output_file, const join_keys* keys, int mode, size_t* nb_fields_first, size_t* second_padding) {
+	
+	csv_row row1 = NULL;
+	csv_row row2 = NULL;
+	char* id1 = NULL;
+	char* id2 = NULL;
+	csv_fields fields;
+	output_buffer header = { NULL, 0, 0 };
+	size_t i;
+	int error = 0;
+	
+	row1 = read_row(first_file);
+	if (row1 == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du premier fichier\n");
+		return 3;
+	}
+	if (ferror(first_file) != 0) {
+		fprintf(stderr, "Erreur dans la lecture du premier fichier\n");
+		free(row1);
+		row1 = NULL;
+		return 4;
+	}
+	if (feof(first_file) != 0) {
+		fprintf(stderr, "Absence des données dans le premier fichier\n");
+		free(row1);
+		row1 = NULL;
+		return 5;
+	}
+	
+	row2 = read_row(second_file);
+	if (row2 == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du deuxième fichier\n");
+		free(row1);
+		row1 = NULL;
+		return 3;
+	}
+	if (ferror(second_file) != 0) {
+		fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
+		free(row1);
+		row1 = NULL;
+		free(row2);
+		row2 = NULL;
+		return 4;
+	}
+	if (feof(second_file) != 0) {
+		fprintf(stderr, "Absence des données dans le deuxième fichier\n");
 		free(row1);
 		row1 = NULL;
+		free(row2);
+		row2 = NULL;
+		return 5;
+	}
+	
+	for (i = 0; i < keys->nb_columns && error == 0; i++) {
+		id1 = row_element(row1, keys->columns_first[i]);
+		id2 = row_element(row2, keys->columns_second[i]);
+		if (id1 == NULL || id2 == NULL) {
+			fprintf(stderr, "Indexes entrés invalides\n");
+			error = 6;
+		} else if (strcmp(id1, id2) != 0) {
+			fprintf(stderr, "Colonnes aux types de contenu différents\n");
+			error = 7;
+		}
+		free(id1);
+		id1 = NULL;
+		free(id2);
+		id2 = NULL;
+	}
+	
+	/* The joined header is made like every joined row, and gives the padding of the rows of the first file without a match */
+	
+	if (error == 0) {
+		csv_scan_row(row2, strlen(row2), &fields);
+		if (buffer_append_joined(&header, row1, strlen(row1), row2, strlen(row2), &fields, keys) != 0) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour l'en-tête du fichier résultat\n");
+			error = 3;
+		}
+	}
+	
+	if (error == 0) {
+		*nb_fields_first = row_nb_fields(row1);
+		*second_padding = 0;
+		for (i = strlen(row1); i < header.size; i++) {
+			if (header.data[i] == CSV_SEPARATOR) ++*second_padding;
+		}
+	}
+	
+	if (error == 0 && (mode == JOIN_LEFT_SEMI || mode == JOIN_LEFT_ANTI)) {
+		fprintf(output_file, "%s\n", row1);
+	} else if (error == 0 && (mode == JOIN_RIGHT_SEMI || mode == JOIN_RIGHT_ANTI)) {
+		fprintf(output_file, "%s\n", row2);
+	} else if (error == 0) {
+		fwrite(header.data, 1, header.size, output_file);
+	}
+	
+	free(header.data);
+	header.data = NULL;
+	
+	free(row1);
+	row1 = NULL;
+	free(row2);
+	row2 = NULL;
+	
+	return error;
+	
+}
+
+/**
+ * @brief Reads the header of both files, checks that their join
+ * 		  columns exist and have the same name, and writes the header
+ * 		  of the result. Returns 0 on success, an error code of
+ * 		  hash_join otherwise
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ */
+int join_headers(FILE* first_file, FILE* second_file, FILE* output_file, size_t column_first_file, size_t column_second_file) {
+	
+	join_keys keys;
+	size_t nb_fields_first = 0;
+	size_t second_padding = 0;
+	
+	single_join_keys(&keys, column_first_file, column_second_file);
+	
+	return join_key_headers(first_file, second_file, output_file, &keys, JOIN_INNER, &nb_fields_first, &second_padding);
+	
+}
+
+/**
+ * @brief Join two files thanks to several columns of the same type of
+ * 		  content, a row of the second file matching a row of the
+ * 		  first one if all their key columns are equal. Integer
+ * 		  columns are compared as numbers, text ones byte for byte
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  keys The key of the join, of 1 to KEY_MAX_COLUMNS columns
+ * 		  max_memory The maximum authorized memory for the build side :
+ * 		  hash table, slots, rows, keys and partition buffers
+ * 		  options The number of probe threads, the order of the output,
+ * 		  its background writer, the mode of the join and whether it
+ * 		  is reported
+ */
+int hash_join_on_keys(FILE* first_file, FILE* second_file, FILE* output_file, const join_keys* keys, size_t max_memory, const join_options* options) {
+	
+	if (first_file == NULL || second_file == NULL || output_file == NULL) {
+		fprintf(stderr, "Un ou plusieurs fichiers déstinés à être écrits ou lus sont invalides");
+		return 9;
+	}
+	
+	memory_accountant accountant = { max_memory, 0, 0 };
+	join_stats stats;
+	output_writer writer;
+	join_context context = { &writer, keys, 0, 0, &accountant, options, &stats };
+	csv_reader build;
+	csv_reader probe;
+	uint64_t start = 0;
+	int error = 0;
+	
+	init_join_stats(&stats, options->report);
+	start = stats_clock(&stats);
+	
+	if (keys->nb_columns == 0 || keys->nb_columns > KEY_MAX_COLUMNS) {
+		fprintf(stderr, "Indexes entrés invalides\n");
+		return 6;
+	}
+	
+	if (options->mode < JOIN_INNER || options->mode > JOIN_RIGHT_ANTI) {
+		fprintf(stderr, "Mode de jointure invalide\n");
+		return 14;
+	}
+	
+	error = join_key_headers(first_file, second_file, output_file, keys, options->mode, &context.nb_fields_first, &context.second_padding);
+	if (error != 0) return error;
+	
+	/* The header goes through stdio, every joined row through the writer */
+	
+	if (init_output_writer(&writer, output_file, options->background_writer, &stats) != 0) {
+		fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+		close_output_writer(&writer);
+		return 11;
+	}
+	
+	init_csv_reader(&build, first_file);
+	init_csv_reader(&probe, second_file);
+	
+	error = join_partition(&build, &probe, &context, 0);
+	
+	close_csv_reader(&build);
+	close_csv_reader(&probe);
+	
+	if (close_output_writer(&writer) != 0 && error == 0) {
+		fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+		error = 11;
+	}
+	
+	if (options->report != 0) print_join_report(&stats, &accountant, stats_clock(&stats) - start);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Join two files thanks to their column of the same
+ * 		  type of content
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ * 		  max_memory The maximum authorized memory for the build side :
+ * 		  hash table, slots, rows, keys and partition buffers
+ * 		  options The number of probe threads, the order of the output
+ * 		  and its background writer
+ */
+int hash_join_with_options(FILE* first_file, FILE* second_file, FILE* output_file, size_t column_first_file, size_t column_second_file, size_t max_memory, const join_options* options) {
+	
+	join_keys keys;
+	
+	single_join_keys(&keys, column_first_file, column_second_file);
+	
+	return hash_join_on_keys(first_file, second_file, output_file, &keys, max_memory, options);
+	
+}
+
+/**
+ * @brief Join two files thanks to their column of the same
+ * 		  type of content, with the default options
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ * 		  max_memory The maximum authorized memory for the build side :
+ * 		  hash table, slots, rows, keys and partition buffers
+ */
+int hash_join(FILE* first_file, FILE* second_file, FILE* output_file, size_t column_first_file, size_t column_second_file, size_t max_memory) {
+	
+	join_options options;
+	
+	default_join_options(&options);
+	
+	return hash_join_with_options(first_file, second_file, output_file, column_first_file, column_second_file, max_memory, &options);
+	
+}
+
+/* ======================================================================
+ * Part III -- Merge join
+ * ======================================================================
+ */
+
+#define SORT_MAX_WAYS 64
+#define SORT_BUFFER_SHARE 8
+#define SORT_MIN_BUFFER_SIZE 64
+
+#define SOURCE_READER 0
+#define SOURCE_MEMORY 1
+#define SOURCE_RUNS 2
+
+#define JOIN_HASH 0
+#define JOIN_MERGE 1
+
+/**
+ * @brief Compares two keys byte after byte, a key being smaller than
+ * 		  the longer keys it starts. Returns a negative number, 0 or a
+ * 		  positive number as the first key is smaller, equal or bigger
+ * 
+ * @param key1 The first key
+ * 		  len1 The length of the first key
+ * 		  key2 The second key
+ * 		  len2 The length of the second key
+ */
+int compare_keys(const char* key1, size_t len1, const char* key2, size_t len2) {
+	
+	int order = memcmp(key1, key2, len1 < len2 ? len1 : len2);
+	
+	if (order != 0) return order;
+	
+	return (len1 > len2) - (len1 < len2);
+	
+}
+
+/**
+ * @brief Datastructure for type sort_record, a row held in memory by
+ * 		  the sort : the row, a view in the mapping or a copy in the
+ * 		  arena of the sort, its length, the bounds of its key, and its
+ * 		  rank in the run, so that rows with the same key keep the
+ * 		  order of the file
+ */
+struct sort_record_struct {
+	
+	const char* row;
+	uint32_t len;
+	uint32_t key_start;
+	uint32_t key_len;
+	uint32_t rank;
+	
+};
+
+typedef struct sort_record_struct sort_record;
+
+/**
+ * @brief Compares two sort records on their key, then on their rank
+ * 
+ * @param a The first record
+ * 		  b The second record
+ */
+int compare_sort_records(const void* a, const void* b) {
+	
+	const sort_record* record1 = a;
+	const sort_record* record2 = b;
+	int order = compare_keys(&record1->row[record1->key_start], record1->key_len, &record2->row[record2->key_start], record2->key_len);
+	
+	if (order != 0) return order;
+	
+	return (record1->rank > record2->rank) - (record1->rank < record2->rank);
+	
+}
+
+/**
+ * @brief Datastructure for type sort_run, a sorted run of rows in a
+ * 		  temporary file, with the number of merges it comes from
+ */
+struct sort_run_struct {
+	
+	FILE* file;
+	size_t level;
+	
+};
+
+typedef struct sort_run_struct sort_run;
+
+/**
+ * @brief Datastructure for type run_merger, the k-way merge of sorted
+ * 		  runs : a reader per run, and a binary heap of the readers
+ * 		  that still have rows, ordered on the key of their current
+ * 		  row, then on the index of their run. The row on top of the
+ * 		  heap is the one given last, it is only passed at the next
+ * 		  call, so that it stays valid until then
+ */
+struct run_merger_struct {
+	
+	csv_reader* readers;
+	size_t nb_readers;
+	size_t* heap;
+	size_t heap_size;
+	size_t column;
+	int pending;
+	memory_accountant* accountant;
+	
+};
+
+typedef struct run_merger_struct run_merger;
+
+/**
+ * @brief Tells if the current row of a reader of a merge comes before
+ * 		  the current row of another one
+ * 
+ * @param merger The merge
+ * 		  reader1 The index of the first reader
+ * 		  reader2 The index of the second reader
+ */
+int merger_before(const run_merger* merger, size_t reader1, size_t reader2) {
+	
+	const csv_reader* first = &merger->readers[reader1];
+	const csv_reader* second = &merger->readers[reader2];
+	size_t start1 = 0;
+	size_t end1 = 0;
+	size_t start2 = 0;
+	size_t end2 = 0;
+	int order = 0;
+	
+	reader_field(first, merger->column, &start1, &end1);
+	reader_field(second, merger->column, &start2, &end2);
+	order = compare_keys(&first->row[start1], end1 - start1, &second->row[start2], end2 - start2);
+	
+	return order < 0 || (order == 0 && reader1 < reader2);
+	
+}
+
+/**
+ * @brief Moves the reader at a position of the heap of a merge down
+ * 		  until it comes before both of its children
+ * 
+ * @param merger The merge
+ * 		  position The position in the heap
+ */
+void merger_sift_down(run_merger* merger, size_t position) {
+	
+	size_t child = 0;
+	size_t reader = merger->heap[position];
+	
+	while ((child = 2 * position + 1) < merger->heap_size) {
+		if (child + 1 < merger->heap_size && merger_before(merger, merger->heap[child + 1], merger->heap[child]) != 0) child++;
+		if (merger_before(merger, reader, merger->heap[child]) != 0) break;
+		merger->heap[position] = merger->heap[child];
+		position = child;
+	}
+	
+	merger->heap[position] = reader;
+	
+}
+
+/**
+ * @brief Starts the merge of sorted runs : each run file is mapped
+ * 		  from its beginning and its first row is read. The readers
+ * 		  and the heap are counted by the accountant. Returns 0 on
+ * 		  success
+ * 
+ * @param merger The merge
+ * 		  runs The runs
+ * 		  nb_runs The number of runs
+ * 		  column The index of the join column in the rows of the runs
+ * 		  accountant The accountant
+ */
+int init_run_merger(run_merger* merger, sort_run* runs, size_t nb_runs, size_t column, memory_accountant* accountant) {
+	
+	const char* row = NULL;
+	size_t len = 0;
+	size_t i;
+	
+	merger->readers = malloc(nb_runs * sizeof(csv_reader));
+	merger->heap = malloc(nb_runs * sizeof(size_t));
+	merger->nb_readers = 0;
+	merger->heap_size = 0;
+	merger->column = column;
+	merger->pending = 0;
+	merger->accountant = accountant;
+	
+	if (merger->readers == NULL || merger->heap == NULL) {
+		free(merger->readers);
+		merger->readers = NULL;
+		free(merger->heap);
+		merger->heap = NULL;
+		return 1;
+	}
+	account_alloc(accountant, nb_runs * (sizeof(csv_reader) + sizeof(size_t)));
+	
+	for (i = 0; i < nb_runs; i++) {
+		rewind(runs[i].file);
+		init_csv_reader(&merger->readers[i], runs[i].file);
+		if (reader_next_row(&merger->readers[i], &row, &len) != 0) merger->heap[merger->heap_size++] = i;
+	}
+	merger->nb_readers = nb_runs;
+	
+	for (i = merger->heap_size / 2; i > 0; i--) {
+		merger_sift_down(merger, i - 1);
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Gives the next row of a merge, in the order of the keys.
+ * 		  Returns 0 when every run is read, 1 otherwise. The row stays
+ * 		  valid until the next call
+ * 
+ * @param merger The merge
+ * 		  row The row, set
+ * 		  len The length of the row, set
+ * 		  start The offset of the join column in the row, set
+ * 		  end The offset just after the join column in the row, set
+ */
+int merger_next(run_merger* merger, const char** row, size_t* len, size_t* start, size_t* end) {
+	
+	csv_reader* reader = NULL;
+	
+	if (merger->pending != 0) {
+		merger->pending = 0;
+		if (reader_next_row(&merger->readers[merger->heap[0]], row, len) == 0) merger->heap[0] = merger->heap[--merger->heap_size];
+		if (merger->heap_size > 0) merger_sift_down(merger, 0);
+	}
+	
+	if (merger->heap_size == 0) return 0;
+	
+	reader = &merger->readers[merger->heap[0]];
+	*row = reader->row;
+	*len = reader->len;
+	reader_field(reader, merger->column, start, end);
+	merger->pending = 1;
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Ends a merge, the runs themselves are not closed
+ * 
+ * @param merger The merge
+ */
+void close_run_merger(run_merger* merger) {
+	
+	size_t i;
+	
+	for (i = 0; i < merger->nb_readers; i++) {
+		close_csv_reader(&merger->readers[i]);
+	}
+	
+	if (merger->readers != NULL) account_free(merger->accountant, merger->nb_readers * (sizeof(csv_reader) + sizeof(size_t)));
+	
+	free(merger->readers);
+	merger->readers = NULL;
+	free(merger->heap);
+	merger->heap = NULL;
+	merger->nb_readers = 0;
+	merger->heap_size = 0;
+	
+}
+
+/**
+ * @brief Datastructure for type sorted_source, one side of a merge join
+ * 		  seen as rows in the order of their key. A file known to be
+ * 		  sorted is read as it is, its order being checked on the way.
+ * 		  Otherwise its rows are sorted by blocks that fit in the memory
+ * 		  given to the source : a file that fits in one block is given
+ * 		  from memory, else each block is written to a temporary run
+ * 		  and the runs are merged back. Runs are merged by groups of at
+ * 		  most ways, as soon as a group of the same level is complete,
+ * 		  so that few files are open at a time and each row is only
+ * 		  rewritten once per level
+ */
+struct sorted_source_struct {
+	
+	int mode;
+	csv_reader* reader;
+	size_t column;
+	int side;
+	memory_accountant* accountant;
+	size_t base;
+	size_t limit;
+	int error;
+	
+	sort_record* records;
+	size_t nb_records;
+	size_t capacity;
+	size_t next_record;
+	Arena arena;
+	
+	sort_run* runs;
+	size_t nb_runs;
+	size_t runs_capacity;
+	size_t ways;
+	char* buffer;
+	size_t buffer_size;
+	size_t buffer_used;
+	run_merger merger;
+	
+	char* last_key;
+	size_t last_key_len;
+	size_t last_key_capacity;
+	int has_last_key;
+	
+};
+
+typedef struct sorted_source_struct sorted_source;
+
+/**
+ * @brief Returns the number of bytes a source holds
+ * 
+ * @param source The source
+ */
+size_t source_memory(const sorted_source* source) {
+	
+	return source->accountant->current - source->base;
+	
+}
+
+/**
+ * @brief Writes the bytes gathered in the buffer of a source to a
+ * 		  run file. Returns 0 on success
+ * 
+ * @param source The source
+ * 		  run The run file
+ */
+int flush_run(sorted_source* source, FILE* run) {
+	
+	if (source->buffer_used > 0 && fwrite(source->buffer, 1, source->buffer_used, run) != source->buffer_used) {
+		fprintf(stderr, "Erreur dans l'écriture d'un fichier temporaire de tri\n");
+		return 10;
+	}
+	
+	source->buffer_used = 0;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Appends a row and its end of line to a run file, through the
+ * 		  buffer of the source. Returns 0 on success
+ * 
+ * @param source The source
+ * 		  run The run file
+ * 		  row The row
+ * 		  len The length of the row
+ */
+int write_run_row(sorted_source* source, FILE* run, const char* row, size_t len) {
+	
+	int error = 0;
+	
+	if (source->buffer_used + len + 1 > source->buffer_size) error = flush_run(source, run);
+	
+	/* A row bigger than the buffer is written directly */
+	
+	if (error == 0 && len + 1 > source->buffer_size) {
+		if (fwrite(row, 1, len, run) != len || fputc('\n', run) == EOF) {
+			fprintf(stderr, "Erreur dans l'écriture d'un fichier temporaire de tri\n");
+			error = 10;
+		}
+		return error;
+	}
+	
+	if (error == 0) {
+		memcpy(&source->buffer[source->buffer_used], row, len);
+		source->buffer[source->buffer_used + len] = '\n';
+		source->buffer_used += len + 1;
+	}
+	
+	return error;
+	
+}
+
+/**
+ * @brief Creates an empty run file, unbuffered since its rows go
+ * 		  through the buffer of the source. Returns NULL on failure
+ */
+FILE* create_run(void) {
+	
+	FILE* run = tmpfile();
+	
+	if (run == NULL) {
+		fprintf(stderr, "Impossible de créer un fichier temporaire de tri\n");
+		return NULL;
+	}
+	
+	setvbuf(run, NULL, _IONBF, 0);
+	
+	return run;
+	
+}
+
+/**
+ * @brief Merges the last runs of a source into a single run of the
+ * 		  next level, which takes their place. Returns 0 on success
+ * 
+ * @param source The source
+ * 		  nb_runs The number of runs to merge
+ */
+int merge_last_runs(sorted_source* source, size_t nb_runs) {
+	
+	size_t first = source->nb_runs - nb_runs;
+	size_t level = 0;
+	FILE* merged = NULL;
+	run_merger merger;
+	const char* row = NULL;
+	size_t len = 0;
+	size_t start = 0;
+	size_t end = 0;
+	size_t i;
+	int error = 0;
+	
+	merged = create_run();
+	if (merged == NULL) return 10;
+	
+	if (init_run_merger(&merger, &source->runs[first], nb_runs, source->column, source->accountant) != 0) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour la fusion des fichiers triés\n");
+		fclose(merged);
+		return 3;
+	}
+	
+	while (error == 0 && merger_next(&merger, &row, &len, &start, &end) != 0) {
+		error = write_run_row(source, merged, row, len);
+	}
+	if (error == 0) error = flush_run(source, merged);
+	
+	close_run_merger(&merger);
+	
+	for (i = first; i < source->nb_runs; i++) {
+		if (source->runs[i].level > level) level = source->runs[i].level;
+		fclose(source->runs[i].file);
+		source->runs[i].file = NULL;
+	}
+	
+	source->runs[first].file = merged;
+	source->runs[first].level = level + 1;
+	source->nb_runs = first + 1;
+	
+	return error;
+	
+}
+
+/**
+ * @brief Sorts the rows held in memory by a source and writes them to a
+ * 		  new run, then merges the last runs while a whole group of the
+ * 		  same level is complete. The memory of the rows is given back
+ * 		  to be used by the next block. Returns 0 on success
+ * 
+ * @param source The source
+ */
+int spill_sorted_block(sorted_source* source) {
+	
+	sort_run* runs = NULL;
+	FILE* run = NULL;
+	size_t i;
+	int error = 0;
+	
+	if (source->nb_runs == source->runs_capacity) {
+		runs = realloc(source->runs, (source->runs_capacity + SORT_MAX_WAYS) * sizeof(sort_run));
+		if (runs == NULL) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour les fichiers triés\n");
+			return 3;
+		}
+		source->runs = runs;
+		source->runs_capacity += SORT_MAX_WAYS;
+		account_alloc(source->accountant, SORT_MAX_WAYS * sizeof(sort_run));
+	}
+	
+	run = create_run();
+	if (run == NULL) return 10;
+	source->runs[source->nb_runs].file = run;
+	source->runs[source->nb_runs].level = 0;
+	source->nb_runs++;
+	
+	qsort(source->records, source->nb_records, sizeof(sort_record), compare_sort_records);
+	for (i = 0; i < source->nb_records && error == 0; i++) {
+		error = write_run_row(source, run, source->records[i].row, source->records[i].len);
+	}
+	if (error == 0) error = flush_run(source, run);
+	
+	source->nb_records = 0;
+	reset_Arena(&source->arena);
+	
+	while (error == 0 && source->nb_runs >= source->ways && source->runs[source->nb_runs - source->ways].level == source->runs[source->nb_runs - 1].level) {
+		error = merge_last_runs(source, source->ways);
+	}
+	
+	return error;
+	
+}
+
+/**
+ * @brief Reads the rows of an unsorted file into blocks that fit in the
+ * 		  memory of the source, each full block being sorted into a
+ * 		  run. A block always gets at least one row, so that a tiny
+ * 		  budget still makes progress. At the end, the last block is
+ * 		  sorted in memory if it is the only one, otherwise it becomes
+ * 		  a run too and the runs are merged down to a single group.
+ * 		  Returns 0 on success
+ * 
+ * @param source The source
+ */
+int sort_source(sorted_source* source) {
+	
+	csv_reader* reader = source->reader;
+	const char* row = NULL;
+	char* copy = NULL;
+	sort_record* records = NULL;
+	size_t len = 0;
+	size_t start = 0;
+	size_t end = 0;
+	size_t new_capacity = 0;
+	size_t cost = 0;
+	int error = 0;
+	
+	while (error == 0 && reader_next_row(reader, &row, &len) != 0) {
+		
+		if (reader_field(reader, source->column, &start, &end) == 0) {
+			fprintf(stderr, "Clé introuvable dans une ligne à trier\n");
+			return 2;
+		}
+		
+		new_capacity = source->nb_records < source->capacity ? source->capacity : (source->capacity > 0 ? 2 * source->capacity : 1);
+		cost = (new_capacity - source->capacity) * sizeof(sort_record) + (reader->map == NULL ? arena_cost(&source->arena, len) : 0);
+		
+		if (source->nb_records > 0 && (source_memory(source) + cost > source->limit || source->nb_records == UINT32_MAX)) {
+			reader_unread(reader);
+			error = spill_sorted_block(source);
+			continue;
+		}
+		
+		if (new_capacity > source->capacity) {
+			records = realloc(source->records, new_capacity * sizeof(sort_record));
+			if (records == NULL) {
+				fprintf(stderr, "Erreur dans l'allocation de mémoire pour les lignes à trier\n");
+				return 3;
+			}
+			account_alloc(source->accountant, (new_capacity - source->capacity) * sizeof(sort_record));
+			source->records = records;
+			source->capacity = new_capacity;
+		}
+		
+		/* A streamed row is copied in the arena, a mapped one stays a view */
+		
+		if (reader->map == NULL) {
+			copy = arena_alloc(&source->arena, len);
+			if (copy == NULL) {
+				fprintf(stderr, "Erreur dans l'allocation de mémoire pour les lignes à trier\n");
+				return 3;
+			}
+			memcpy(copy, row, len);
+			row = copy;
+		}
+		
+		source->records[source->nb_records].row = row;
+		source->records[source->nb_records].len = len;
+		source->records[source->nb_records].key_start = start;
+		source->records[source->nb_records].key_len = end - start;
+		source->records[source->nb_records].rank = source->nb_records;
+		source->nb_records++;
+		
+	}
+	
+	if (error == 0 && reader_error(reader) != 0) {
+		fprintf(stderr, "Erreur dans la lecture d'un fichier à trier\n");
+		return 4;
+	}
+	if (error != 0) return error;
+	
+	if (source->nb_runs == 0) {
+		qsort(source->records, source->nb_records, sizeof(sort_record), compare_sort_records);
+		source->mode = SOURCE_MEMORY;
+		return 0;
+	}
+	
+	if (source->nb_records > 0) error = spill_sorted_block(source);
+	
+	/* The rows are all in runs now, their memory is given back before the runs are merged */
+	
+	free(source->records);
+	source->records = NULL;
+	account_free(source->accountant, source->capacity * sizeof(sort_record));
+	source->capacity = 0;
+	delete_Arena_content(&source->arena);
+	
+	while (error == 0 && source->nb_runs > source->ways) {
+		error = merge_last_runs(source, source->nb_runs - source->ways + 1 < source->ways ? source->nb_runs - source->ways + 1 : source->ways);
+	}
+	
+	if (error == 0 && init_run_merger(&source->merger, source->runs, source->nb_runs, source->column, source->accountant) != 0) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour la fusion des fichiers triés\n");
+		error = 3;
+	}
+	if (error == 0) source->mode = SOURCE_RUNS;
+	
+	return error;
+	
+}
+
+/**
+ * @brief Opens one side of a merge join on a reader. The rows of a
+ * 		  file that is not known to be sorted are sorted first, with
+ * 		  at most limit bytes counted by the accountant. Returns 0 on
+ * 		  success, an error code of merge_join otherwise
+ * 
+ * @param source The source
+ * 		  reader The reader of the file
+ * 		  column The index of the file's join column
+ * 		  sorted Whether the file is known to be sorted on its join column
+ * 		  side 1 for the first file, 2 for the second one
+ * 		  accountant The accountant
+ * 		  limit The number of bytes the source may hold
+ */
+int open_sorted_source(sorted_source* source, csv_reader* reader, size_t column, int sorted, int side, memory_accountant* accountant, size_t limit) {
+	
+	size_t chunk_size = limit / 16 < ARENA_CHUNK_SIZE ? limit / 16 : ARENA_CHUNK_SIZE;
+	size_t ways = limit / 2 / (sizeof(csv_reader) + sizeof(size_t));
+	
+	source->mode = SOURCE_READER;
+	source->reader = reader;
+	source->column = column;
+	source->side = side;
+	source->accountant = accountant;
+	source->base = accountant->current;
+	source->limit = limit;
+	source->error = 0;
+	source->records = NULL;
+	source->nb_records = 0;
+	source->capacity = 0;
+	source->next_record = 0;
+	init_Arena(&source->arena, chunk_size, accountant);
+	source->runs = NULL;
+	source->nb_runs = 0;
+	source->runs_capacity = 0;
+	source->ways = ways < 2 ? 2 : (ways > SORT_MAX_WAYS ? SORT_MAX_WAYS : ways);
+	source->buffer = NULL;
+	source->buffer_size = 0;
+	source->buffer_used = 0;
+	source->merger.readers = NULL;
+	source->merger.heap = NULL;
+	source->merger.nb_readers = 0;
+	source->merger.heap_size = 0;
+	source->last_key = NULL;
+	source->last_key_len = 0;
+	source->last_key_capacity = 0;
+	source->has_last_key = 0;
+	
+	if (sorted != 0) return 0;
+	
+	/* The buffer of the runs takes a share of what the source may hold */
+	
+	source->buffer_size = limit / SORT_BUFFER_SHARE;
+	if (source->buffer_size < SORT_MIN_BUFFER_SIZE) source->buffer_size = SORT_MIN_BUFFER_SIZE;
+	if (source->buffer_size > BUFSIZ) source->buffer_size = BUFSIZ;
+	
+	source->buffer = malloc(source->buffer_size);
+	if (source->buffer == NULL) {
+		source->buffer_size = 0;
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour les fichiers triés\n");
+		return 3;
+	}
+	account_alloc(accountant, source->buffer_size);
+	
+	return sort_source(source);
+	
+}
+
+/**
+ * @brief Remembers the key of the last row given by a source read as
+ * 		  it is, after checking that it does not come before the key
+ * 		  of the previous row. Returns 0 on success
+ * 
+ * @param source The source
+ * 		  key The key
+ * 		  key_len The length of the key
+ */
+int check_source_order(sorted_source* source, const char* key, size_t key_len) {
+	
+	size_t capacity = source->last_key_capacity > 0 ? source->last_key_capacity : SORT_MIN_BUFFER_SIZE;
+	char* last_key = NULL;
+	
+	if (source->has_last_key != 0 && compare_keys(source->last_key, source->last_key_len, key, key_len) > 0) {
+		fprintf(stderr, "Le %s fichier n'est pas trié selon sa colonne de jointure\n", source->side == 1 ? "premier" : "deuxième");
+		return 12;
+	}
+	
+	if (key_len > source->last_key_capacity) {
+		while (capacity < key_len) capacity *= 2;
+		last_key = realloc(source->last_key, capacity);
+		if (last_key == NULL) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour une clé\n");
+			return 3;
+		}
+		account_alloc(source->accountant, capacity - source->last_key_capacity);
+		source->last_key = last_key;
+		source->last_key_capacity = capacity;
+	}
+	
+	memcpy(source->last_key, key, key_len);
+	source->last_key_len = key_len;
+	source->has_last_key = 1;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Gives the next row of a source, in the order of the keys.
+ * 		  Returns 0 at the end or on an error, which is then kept in
+ * 		  the source, 1 otherwise. The row stays valid until the next
+ * 		  call
+ * 
+ * @param source The source
+ * 		  row The row, set
+ * 		  len The length of the row, set
+ * 		  start The offset of the join column in the row, set
+ * 		  end The offset just after the join column in the row, set
+ */
+int sorted_source_next(sorted_source* source, const char** row, size_t* len, size_t* start, size_t* end) {
+	
+	const sort_record* record = NULL;
+	
+	if (source->error != 0) return 0;
+	
+	if (source->mode == SOURCE_MEMORY) {
+		if (source->next_record == source->nb_records) return 0;
+		record = &source->records[source->next_record++];
+		*row = record->row;
+		*len = record->len;
+		*start = record->key_start;
+		*end = record->key_start + record->key_len;
+		return 1;
+	}
+	
+	if (source->mode == SOURCE_RUNS) return merger_next(&source->merger, row, len, start, end);
+	
+	if (reader_next_row(source->reader, row, len) == 0) {
+		if (reader_error(source->reader) != 0) {
+			fprintf(stderr, "Erreur dans la lecture du %s fichier\n", source->side == 1 ? "premier" : "deuxième");
+			source->error = 4;
+		}
+		return 0;
+	}
+	
+	if (reader_field(source->reader, source->column, start, end) == 0) {
+		fprintf(stderr, "Clé introuvable dans une ligne du %s fichier\n", source->side == 1 ? "premier" : "deuxième");
+		source->error = 2;
+		return 0;
+	}
+	
+	source->error = check_source_order(source, &(*row)[*start], *end - *start);
+	
+	return source->error == 0;
+	
+}
+
+/**
+ * @brief Releases everything a source holds, its runs included
+ * 
+ * @param source The source
+ */
+void close_sorted_source(sorted_source* source) {
+	
+	size_t i;
+	
+	close_run_merger(&source->merger);
+	
+	for (i = 0; i < source->nb_runs; i++) {
+		if (source->runs[i].file != NULL) fclose(source->runs[i].file);
+	}
+	
+	free(source->runs);
+	source->runs = NULL;
+	free(source->records);
+	source->records = NULL;
+	free(source->buffer);
+	source->buffer = NULL;
+	free(source->last_key);
+	source->last_key = NULL;
+	delete_Arena_content(&source->arena);
+	
+	account_free(source->accountant, source->runs_capacity * sizeof(sort_run) + source->capacity * sizeof(sort_record) + source->buffer_size + source->last_key_capacity);
+	source->runs_capacity = 0;
+	source->capacity = 0;
+	source->buffer_size = 0;
+	source->last_key_capacity = 0;
+	
+}
+
+/**
+ * @brief Datastructure for type build_cursor, the side of the first
+ * 		  file of a merge : the row it stands on, a copy of the last
+ * 		  row of a run of rows with the same key, its length and the
+ * 		  bounds of its key, and the row read after that run, not yet
+ * 		  given
+ */
+struct build_cursor_struct {
+	
+	sorted_source* source;
+	output_buffer held;
+	size_t start;
+	size_t end;
+	const char* next_row;
+	size_t next_len;
+	size_t next_start;
+	size_t next_end;
+	int has_next;
+	
+};
+
+typedef struct build_cursor_struct build_cursor;
+
+/**
+ * @brief Moves a cursor to the next run of rows with the same key of
+ * 		  the first file and stands on its last row, which is the one
+ * 		  the hash table keeps. The row is copied, since reading the
+ * 		  one after it may reuse the memory of a streamed row. Returns
+ * 		  0 when there is no row left or on error, 1 otherwise
+ * 
+ * @param cursor The cursor
+ * 		  stats The statistics of the join, the rows read are counted
+ * 		  error Set to 3 if the row cannot be copied
+ */
+int build_cursor_next(build_cursor* cursor, join_stats* stats, int* error) {
+	
+	if (cursor->has_next == 0) return 0;
+	
+	do {
+		
+		cursor->held.size = 0;
+		if (buffer_reserve(&cursor->held, cursor->next_len) != 0) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du premier fichier\n");
+			*error = 3;
+			return 0;
+		}
+		memcpy(cursor->held.data, cursor->next_row, cursor->next_len);
+		cursor->held.size = cursor->next_len;
+		cursor->start = cursor->next_start;
+		cursor->end = cursor->next_end;
+		stats_add_row(stats, cursor->next_len);
+		
+		cursor->has_next = sorted_source_next(cursor->source, &cursor->next_row, &cursor->next_len, &cursor->next_start, &cursor->next_end);
+		
+	} while (cursor->has_next != 0 && compare_keys(&cursor->next_row[cursor->next_start], cursor->next_end - cursor->next_start, &cursor->held.data[cursor->start], cursor->end - cursor->start) == 0);
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Joins two sources given in the order of their keys, reading
+ * 		  each of them once. The row of the first file stays while
+ * 		  the run of rows of the second file with the same key is
+ * 		  written, the side with the smaller key moves otherwise. Of
+ * 		  several rows of the first file with the same key, the last
+ * 		  one is joined, as in the hash join
+ * 
+ * @param build The source of the file that has unique key values
+ * 		  probe The source of the file that can have several same key values
+ * 		  writer The writer of the output
+ * 		  stats The statistics of the join : rows merged and matches
+ */
+int merge_sources(sorted_source* build, sorted_source* probe, output_writer* writer, join_stats* stats) {
+	
+	build_cursor cursor = { build, { NULL, 0, 0 }, 0, 0, NULL, 0, 0, 0, 0 };
+	const char* probe_row = NULL;
+	size_t probe_len = 0;
+	size_t probe_start = 0;
+	size_t probe_end = 0;
+	int has_build = 0;
+	int has_probe = 0;
+	int order = 0;
+	int error = 0;
+	
+	cursor.has_next = sorted_source_next(build, &cursor.next_row, &cursor.next_len, &cursor.next_start, &cursor.next_end);
+	has_build = build_cursor_next(&cursor, stats, &error);
+	has_probe = sorted_source_next(probe, &probe_row, &probe_len, &probe_start, &probe_end);
+	
+	while (has_build != 0 && has_probe != 0 && error == 0) {
+		
+		order = compare_keys(&cursor.held.data[cursor.start], cursor.end - cursor.start, &probe_row[probe_start], probe_end - probe_start);
+		
+		if (order < 0) {
+			has_build = build_cursor_next(&cursor, stats, &error);
+		} else {
+			if (order == 0) {
+				error = writer_append_rows(writer, cursor.held.data, cursor.held.size, probe_row, probe_len, probe_start, probe_end);
+				if (error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour le fichier résultat\n");
+				if (error == 11) fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+				stats->matches++;
+			}
+			stats_add_row(stats, probe_len);
+			has_probe = sorted_source_next(probe, &probe_row, &probe_len, &probe_start, &probe_end);
+		}
+		
+	}
+	
+	/* The row each side stopped on was read too, the ones after it are not */
+	
+	if (cursor.has_next != 0) stats_add_row(stats, cursor.next_len);
+	if (has_probe != 0) stats_add_row(stats, probe_len);
+	
+	free(cursor.held.data);
+	cursor.held.data = NULL;
+	
+	if (error != 0) return error;
+	
+	return build->error != 0 ? build->error : probe->error;
+	
+}
+
+/**
+ * @brief Join two files thanks to their column of the same type of
+ * 		  content, by merging them in the order of their keys. A file
+ * 		  known to be sorted on its join column, byte after byte, is
+ * 		  streamed once in constant memory, an other one is sorted
+ * 		  first, in memory or into temporary runs when it does not
+ * 		  fit. Each file gets half of the budget for its sort. Only
+ * 		  inner joins are merged
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ * 		  max_memory The maximum authorized memory for the sorts
+ * 		  options Whether each file is sorted, the background writer
+ * 		  of the output and whether the join is reported
+ */
+int merge_join_with_options(FILE* first_file, FILE* second_file, FILE* output_file, size_t column_first_file, size_t column_second_file, size_t max_memory, const join_options* options) {
+	
+	if (first_file == NULL || second_file == NULL || output_file == NULL) {
+		fprintf(stderr, "Un ou plusieurs fichiers déstinés à être écrits ou lus sont invalides");
+		return 9;
+	}
+	
+	memory_accountant accountant = { max_memory, 0, 0 };
+	join_stats stats;
+	output_writer writer;
+	csv_reader first_reader;
+	csv_reader second_reader;
+	sorted_source build;
+	sorted_source probe;
+	uint64_t start = 0;
+	int error = 0;
+	
+	init_join_stats(&stats, options->report);
+	start = stats_clock(&stats);
+	
+	if (options->mode != JOIN_INNER) {
+		fprintf(stderr, "Mode de jointure invalide\n");
+		return 14;
+	}
+	
+	error = join_headers(first_file, second_file, output_file, column_first_file, column_second_file);
+	if (error != 0) return error;
+	
+	if (init_output_writer(&writer, output_file, options->background_writer, &stats) != 0) {
+		fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+		close_output_writer(&writer);
+		return 11;
+	}
+	
+	init_csv_reader(&first_reader, first_file);
+	init_csv_reader(&second_reader, second_file);
+	
+	error = open_sorted_source(&build, &first_reader, column_first_file, options->first_sorted, 1, &accountant, max_memory / 2);
+	if (error == 0) {
+		error = open_sorted_source(&probe, &second_reader, column_second_file, options->second_sorted, 2, &accountant, max_memory - max_memory / 2);
+		if (error == 0) error = merge_sources(&build, &probe, &writer, &stats);
+		close_sorted_source(&probe);
+	}
+	close_sorted_source(&build);
+	close_csv_reader(&first_reader);
+	close_csv_reader(&second_reader);
+	
+	if (close_output_writer(&writer) != 0 && error == 0) {
+		fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+		error = 11;
+	}
+	
+	if (options->report != 0) print_join_report(&stats, &accountant, stats_clock(&stats) - start);
+	
+	return error;
+	
+}
+
+/**
+ * @brief Join two files already sorted on their join column, byte
+ * 		  after byte, by streaming both of them once in constant memory
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ * 		  max_memory The maximum authorized memory
+ */
+int merge_join(FILE* first_file, FILE* second_file, FILE* output_file, size_t column_first_file, size_t column_second_file, size_t max_memory) {
+	
+	join_options options;
+	
+	default_join_options(&options);
+	options.first_sorted = 1;
+	options.second_sorted = 1;
+	
+	return merge_join_with_options(first_file, second_file, output_file, column_first_file, column_second_file, max_memory, &options);
+	
+}
+
+/**
+ * @brief Returns the number of bytes left to read in a regular file,
+ * 		  or -1 if it is not known
+ * 
+ * @param f The file
+ */
+long file_bytes_left(FILE* f) {
+	
+	struct stat file_stat;
+	long position = ftell(f);
+	
+	if (position < 0 || fstat(fileno(f), &file_stat) != 0 || S_ISREG(file_stat.st_mode) == 0) return -1;
+	
+	return file_stat.st_size > position ? file_stat.st_size - position : 0;
+	
+}
+
+/**
+ * @brief Estimates the number of bytes the sort of a mapped file
+ * 		  writes and reads back : nothing if it fits in memory, else
+ * 		  the whole file once for the runs and once more for every
+ * 		  level of merges before the last one
+ * 
+ * @param bytes The size of the file
+ * 		  memory The memory of the sort
+ */
+double sort_cost(double bytes, size_t memory) {
+	
+	double nb_runs = bytes / JOIN_ROW_SIZE_ESTIMATE * sizeof(sort_record) / (memory > 0 ? memory : 1);
+	double cost = 0.0;
+	
+	while (nb_runs > 1) {
+		cost += 2 * bytes;
+		nb_runs /= SORT_MAX_WAYS;
+	}
+	
+	return cost;
+	
+}
+
+/**
+ * @brief Picks the join of two files : the merge join when both are
+ * 		  known to be sorted, the hash join when the first one should
+ * 		  fit in memory or the sizes are not known, and otherwise the
+ * 		  one that writes and reads back the fewest bytes, between the
+ * 		  partitions of the hash join and the runs of the sorts
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  max_memory The maximum authorized memory
+ * 		  options Whether each file is sorted
+ */
+int plan_join(FILE* first_file, FILE* second_file, size_t max_memory, const join_options* options) {
+	
+	long first_bytes = file_bytes_left(first_file);
+	long second_bytes = file_bytes_left(second_file);
+	double hash_cost = 0.0;
+	double merge_cost = 0.0;
+	
+	/* The merge join only writes the pairs of an inner join, with unique keys in the first file */
+	
+	if (options->mode != JOIN_INNER || options->duplicate_keys != 0) return JOIN_HASH;
+	if (options->first_sorted != 0 && options->second_sorted != 0) return JOIN_MERGE;
+	
+	if (first_bytes < 0 || second_bytes < 0) return JOIN_HASH;
+	if (first_bytes / JOIN_ROW_SIZE_ESTIMATE <= Htable_size_for_budget(max_memory) * HASH_TABLE_LOAD_FACTOR) return JOIN_HASH;
+	
+	/* The partitioned hash join writes both files once and reads them back */
+	
+	hash_cost = 2.0 * ((double) first_bytes + second_bytes);
+	if (options->first_sorted == 0) merge_cost += sort_cost(first_bytes, max_memory / 2);
+	if (options->second_sorted == 0) merge_cost += sort_cost(second_bytes, max_memory - max_memory / 2);
+	
+	return merge_cost < hash_cost ? JOIN_MERGE : JOIN_HASH;
+	
+}
+
+/**
+ * @brief Join two files thanks to their column of the same type of
+ * 		  content, with the join picked by plan_join
+ * 
+ * @param first_file The file that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ * 		  max_memory The maximum authorized memory
+ * 		  options The options of the join
+ */
+int planned_join(FILE* first_file, FILE* second_file, FILE* output_file, size_t column_first_file, size_t column_second_file, size_t max_memory, const join_options* options) {
+	
+	if (first_file != NULL && second_file != NULL && plan_join(first_file, second_file, max_memory, options) == JOIN_MERGE) {
+		return merge_join_with_options(first_file, second_file, output_file, column_first_file, column_second_file, max_memory, options);
+	}
+	
+	return hash_join_with_options(first_file, second_file, output_file, column_first_file, column_second_file, max_memory, options);
+	
+}
+
+/* ======================================================================
+ * Part IV -- Persistent index
+ * ======================================================================
+ */
+
+#define INDEX_MAGIC "CSVJIDX1"
+#define INDEX_MAGIC_SIZE 8
+#define INDEX_HASH_WORDS 0
+
+/**
+ * @brief Datastructure for type index_header, the beginning of an index
+ * 		  file : its magic, written last so that a partial file is
+ * 		  never taken for an index, the size and modification time of
+ * 		  the indexed file, the number of slots, a power of two, and of
+ * 		  rows, where the key area starts in the index, the hash
+ * 		  function of the keys, and the key that was indexed : its
+ * 		  columns in the indexed file and their types
+ */
+struct index_header_struct {
+	
+	char magic[INDEX_MAGIC_SIZE];
+	uint64_t source_size;
+	int64_t source_mtime_sec;
+	int64_t source_mtime_nsec;
+	uint64_t nb_slots;
+	uint64_t nb_rows;
+	uint64_t keys_offset;
+	uint32_t hash_function;
+	uint32_t nb_columns;
+	uint32_t columns[KEY_MAX_COLUMNS];
+	uint32_t types[KEY_MAX_COLUMNS];
+	
+};
+
+typedef struct index_header_struct index_header;
+
+/**
+ * @brief Datastructure for type index_slot, a slot of the flat array of
+ * 		  an index, found by linear probing from the low bits of the
+ * 		  hash of its key : the offset and length of the row in the
+ * 		  indexed file, the offset and length of its key, in the
+ * 		  indexed file for a raw key, in the key area of the index for
+ * 		  an encoded one, the low 32 bits of the hash of the key, and
+ * 		  whether the slot is used. A slot takes 32 bytes
+ */
+struct index_slot_struct {
+	
+	uint64_t row;
+	uint64_t key;
+	uint32_t row_len;
+	uint32_t key_len;
+	uint32_t hash;
+	uint32_t used;
+	
+};
+
+typedef struct index_slot_struct index_slot;
+
+/**
+ * @brief Datastructure for type join_index, an index file mapped in
+ * 		  memory, its slots, the base of the offsets of its keys, in
+ * 		  the indexed file or in its key area, and the reader of the
+ * 		  indexed file, mapped too
+ */
+struct join_index_struct {
+	
+	const char* map;
+	size_t map_size;
+	const index_header* header;
+	const index_slot* slots;
+	const char* key_base;
+	csv_reader source;
+	
+};
+
+typedef struct join_index_struct join_index;
+
+/**
+ * @brief Sets the size and modification time of the indexed file in
+ * 		  the header of an index, which tell if the index is stale.
+ * 		  Returns 0 on success
+ * 
+ * @param file The indexed file
+ * 		  header The header
+ */
+int index_source_identity(FILE* file, index_header* header) {
+	
+	struct stat file_stat;
+	
+	if (fstat(fileno(file), &file_stat) != 0) return 1;
+	
+	header->source_size = file_stat.st_size;
+	header->source_mtime_sec = file_stat.st_mtim.tv_sec;
+	header->source_mtime_nsec = file_stat.st_mtim.tv_nsec;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Sets the key of the join in the header of an index. Returns 0
+ * 		  if it was already the key of the index, 1 otherwise
+ * 
+ * @param header The header
+ * 		  keys The key of the join
+ */
+int index_set_keys(index_header* header, const join_keys* keys) {
+	
+	int changed = header->nb_columns != keys->nb_columns;
+	size_t i;
+	
+	header->nb_columns = keys->nb_columns;
+	for (i = 0; i < KEY_MAX_COLUMNS; i++) {
+		changed |= header->columns[i] != (i < keys->nb_columns ? keys->columns_first[i] : 0);
+		changed |= header->types[i] != (uint32_t) (i < keys->nb_columns ? keys->types[i] : 0);
+		header->columns[i] = i < keys->nb_columns ? keys->columns_first[i] : 0;
+		header->types[i] = i < keys->nb_columns ? keys->types[i] : 0;
+	}
+	
+	return changed;
+	
+}
+
+/**
+ * @brief Returns the slot of an index that holds a key, or the empty
+ * 		  slot where it would go
+ * 
+ * @param slots The slots
+ * 		  nb_slots The number of slots, a power of two
+ * 		  key_base The base of the offsets of the keys of the slots
+ * 		  hash The hash of the key
+ * 		  key The key
+ * 		  key_len The length of the key
+ */
+const index_slot* find_index_slot(const index_slot* slots, size_t nb_slots, const char* key_base, uint64_t hash, const char* key, size_t key_len) {
+	
+	size_t i = hash & (nb_slots - 1);
+	
+	while (slots[i].used != 0) {
+		if (slots[i].hash == (uint32_t) hash && slots[i].key_len == key_len && memcmp(&key_base[slots[i].key], key, key_len) == 0) break;
+		i = (i + 1) & (nb_slots - 1);
+	}
+	
+	return &slots[i];
+	
+}
+
+/**
+ * @brief Writes an index of the rows of a file, after its header, for
+ * 		  a given key. The file must be a regular one, whose rows are
+ * 		  given as offsets in it. The slots are filled to at most
+ * 		  HASH_TABLE_LOAD_FACTOR, and a later row with the same key
+ * 		  replaces an earlier one, as in the hash table of the join.
+ * 		  The index is built in memory, outside of any budget, then
+ * 		  written with its magic last. Returns 0 on success, an error
+ * 		  code of hash_join otherwise
+ * 
+ * @param first_file The file to index, that has unique key values
+ * 		  index_name The name of the index file
+ * 		  keys The key of the join
+ */
+int build_join_index(FILE* first_file, const char* index_name, const join_keys* keys) {
+	
+	index_header header;
+	csv_reader reader;
+	csv_row first_row = NULL;
+	index_slot* entries = NULL;
+	index_slot* slots = NULL;
+	index_slot* grown = NULL;
+	index_slot* slot = NULL;
+	output_buffer key_area = { NULL, 0, 0 };
+	output_buffer scratch = { NULL, 0, 0 };
+	const char* row = NULL;
+	size_t len = 0;
+	const char* key = NULL;
+	size_t key_len = 0;
+	size_t capacity = 0;
+	size_t count = 0;
+	size_t i;
+	FILE* index_file = NULL;
+	long position = 0;
+	int raw = keys_are_raw(keys);
+	int error = 0;
+	
+	memset(&header, 0, sizeof(header));
+	index_set_keys(&header, keys);
+	header.hash_function = INDEX_HASH_WORDS;
+	
+	if (index_source_identity(first_file, &header) != 0) {
+		fprintf(stderr, "Erreur dans la lecture du premier fichier\n");
 		return 4;
 	}
-	if (feof(first_file) != 0) {
-		fprintf(stderr, "Absence des données dans le premier fichier\n");
-		free(row1);
-		row1 = NULL;
-		return 5;
+	
+	first_row = read_row(first_file);
+	if (first_row == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du premier fichier\n");
+		return 3;
+	}
+	free(first_row);
+	first_row = NULL;
+	
+	/* A file with only its header is not mapped, and gives an empty index */
+	
+	position = ftell(first_file);
+	init_csv_reader(&reader, first_file);
+	if (reader.map == NULL && (position < 0 || (uint64_t) position < header.source_size)) {
+		fprintf(stderr, "Seul un fichier ordinaire peut être indexé\n");
+		close_csv_reader(&reader);
+		return 15;
+	}
+	
+	while (error == 0 && reader_next_row(&reader, &row, &len) != 0) {
+		
+		error = row_key(keys, keys->columns_first, row, len, &reader.fields, &scratch, &key, &key_len);
+		if (error != 0) {
+			print_key_error(error, "du premier fichier");
+			break;
+		}
+		
+		if (count == capacity) {
+			capacity = capacity > 0 ? 2 * capacity : HTABLE_INITIAL_SIZE;
+			grown = realloc(entries, capacity * sizeof(index_slot));
+			if (grown == NULL) {
+				fprintf(stderr, "Erreur dans l'allocation de mémoire pour l'index\n");
+				error = 3;
+				break;
+			}
+			entries = grown;
+		}
+		
+		/* A raw key is an offset in the indexed file, an encoded one is copied in the key area */
+		
+		entries[count].row = row - reader.map;
+		entries[count].row_len = len;
+		entries[count].key_len = key_len;
+		entries[count].hash = DEFAULT_KEY_HASH(key, key_len);
+		entries[count].used = 1;
+		if (raw != 0) {
+			entries[count].key = key - reader.map;
+		} else if (buffer_reserve(&key_area, key_len) != 0) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour l'index\n");
+			error = 3;
+			break;
+		} else {
+			entries[count].key = key_area.size;
+			memcpy(&key_area.data[key_area.size], key, key_len);
+			key_area.size += key_len;
+		}
+		count++;
+		
+	}
+	
+	if (error == 0 && reader_error(&reader) != 0) {
+		fprintf(stderr, "Erreur dans la lecture du premier fichier\n");
+		error = 4;
+	}
+	
+	/* The slots are filled once all the keys are known, so that the key area does not move any more. */
+	/* A row whose key is already there replaces the earlier one, only the rows kept are counted */
+	
+	header.nb_rows = 0;
+	header.nb_slots = round_up_power_of_two(count / HASH_TABLE_LOAD_FACTOR + 2);
+	header.keys_offset = sizeof(index_header) + header.nb_slots * sizeof(index_slot);
+	
+	if (error == 0) {
+		slots = calloc(header.nb_slots, sizeof(index_slot));
+		if (slots == NULL) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour l'index\n");
+			error = 3;
+		}
+	}
+	
+	for (i = 0; i < count && error == 0; i++) {
+		key = raw != 0 ? reader.map : key_area.data;
+		slot = (index_slot*) find_index_slot(slots, header.nb_slots, key, entries[i].hash, &key[entries[i].key], entries[i].key_len);
+		if (slot->used == 0) header.nb_rows++;
+		*slot = entries[i];
+	}
+	
+	if (error == 0) {
+		index_file = fopen(index_name, "wb");
+		if (index_file == NULL) {
+			fprintf(stderr, "Impossible de créer l'index \"%s\"\n", index_name);
+			error = 15;
+		}
+	}
+	
+	if (error == 0) {
+		
+		/* The magic is written last, once everything else is on the disk */
+		
+		memcpy(header.magic, "\0\0\0\0\0\0\0\0", INDEX_MAGIC_SIZE);
+		if (fwrite(&header, sizeof(header), 1, index_file) != 1 || fwrite(slots, sizeof(index_slot), header.nb_slots, index_file) != header.nb_slots || (key_area.size > 0 && fwrite(key_area.data, 1, key_area.size, index_file) != key_area.size) || fflush(index_file) != 0) error = 15;
+		memcpy(header.magic, INDEX_MAGIC, INDEX_MAGIC_SIZE);
+		if (error == 0 && (fseek(index_file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, index_file) != 1)) error = 15;
+		if (fclose(index_file) != 0) error = 15;
+		if (error != 0) fprintf(stderr, "Erreur dans l'écriture de l'index \"%s\"\n", index_name);
+		
+	}
+	
+	close_csv_reader(&reader);
+	free(entries);
+	entries = NULL;
+	free(slots);
+	slots = NULL;
+	free(key_area.data);
+	key_area.data = NULL;
+	free(scratch.data);
+	scratch.data = NULL;
+	
+	return error;
+	
+}
+
+/**
+ * @brief Tells if a range of bytes lies within an area, without
+ * 		  overflowing
+ * 
+ * @param offset The offset of the range
+ * 		  len The length of the range
+ * 		  size The size of the area
+ */
+int range_within(uint64_t offset, uint64_t len, uint64_t size) {
+	
+	return offset <= size && len <= size - offset;
+	
+}
+
+/**
+ * @brief Checks the slots of a mapped index before they are followed :
+ * 		  each used slot must have its row in the indexed file and its
+ * 		  key in the indexed file or in the key area, there must be as
+ * 		  many used slots as rows, and at least one empty slot so that
+ * 		  a lookup always ends. Returns 0 if they are sound, 15
+ * 		  otherwise
+ * 
+ * @param index The index, with its slots and its key base set
+ * 		  keys The key of the join
+ */
+int check_index_slots(const join_index* index, const join_keys* keys) {
+	
+	const index_slot* slot = NULL;
+	uint64_t key_area_size = keys_are_raw(keys) != 0 ? index->source.map_size : index->map_size - index->header->keys_offset;
+	uint64_t nb_used = 0;
+	size_t i;
+	
+	for (i = 0; i < index->header->nb_slots; i++) {
+		slot = &index->slots[i];
+		if (slot->used == 0) continue;
+		if (slot->used != 1 || index->source.map == NULL) return 15;
+		if (range_within(slot->row, slot->row_len, index->source.map_size) == 0) return 15;
+		if (range_within(slot->key, slot->key_len, key_area_size) == 0) return 15;
+		nb_used++;
+	}
+	
+	return nb_used == index->header->nb_rows && nb_used < index->header->nb_slots ? 0 : 15;
+	
+}
+
+/**
+ * @brief Maps an index file and the file it indexes, and checks that
+ * 		  the index is sound, its slots included, is for the given
+ * 		  key, and is not stale : the indexed file must have the size
+ * 		  and modification time it had when the index was built.
+ * 		  Returns 0 on success, 15
+ * 		  if the index cannot be read or is not an index for this
+ * 		  key, 16 if it is stale
+ * 
+ * @param index The index, set
+ * 		  index_name The name of the index file
+ * 		  first_file The indexed file, before or after its header
+ * 		  keys The key of the join
+ */
+int open_join_index(join_index* index, const char* index_name, FILE* first_file, const join_keys* keys) {
+	
+	FILE* index_file = fopen(index_name, "rb");
+	struct stat file_stat;
+	index_header expected;
+	void* map = MAP_FAILED;
+	const index_header* header = NULL;
+	
+	index->map = NULL;
+	index->map_size = 0;
+	index->source.map = NULL;
+	index->source.line = NULL;
+	
+	if (index_file == NULL) return 15;
+	
+	if (fstat(fileno(index_file), &file_stat) == 0 && (size_t) file_stat.st_size >= sizeof(index_header)) {
+		map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fileno(index_file), 0);
 	}
+	fclose(index_file);
+	if (map == MAP_FAILED) return 15;
 	
-	row2 = read_row(second_file);
-	if (row2 == NULL) {
-		fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du deuxième fichier\n");
-		free(row1);
-		row1 = NULL;
-		return 3;
+	index->map = map;
+	index->map_size = file_stat.st_size;
+	index->header = header = map;
+	
+	/* The sizes are checked before anything else is trusted */
+	
+	if (memcmp(header->magic, INDEX_MAGIC, INDEX_MAGIC_SIZE) != 0 || header->hash_function != INDEX_HASH_WORDS || header->nb_slots == 0 || (header->nb_slots & (header->nb_slots - 1)) != 0 || header->nb_slots > (index->map_size - sizeof(index_header)) / sizeof(index_slot) || header->keys_offset != sizeof(index_header) + header->nb_slots * sizeof(index_slot)) return 15;
+	
+	expected = *header;
+	if (index_set_keys(&expected, keys) != 0) return 15;
+	if (index_source_identity(first_file, &expected) != 0 || expected.source_size != header->source_size || expected.source_mtime_sec != header->source_mtime_sec || expected.source_mtime_nsec != header->source_mtime_nsec) return 16;
+	
+	init_csv_reader(&index->source, first_file);
+	if (header->nb_rows > 0 && (index->source.map == NULL || index->source.map_size != header->source_size)) return 16;
+	
+	/* The rows of the indexed file are read in the order of the probe file, not in their own */
+	
+	if (index->source.map != NULL) posix_madvise((void*) index->source.map, index->source.map_size, POSIX_MADV_RANDOM);
+	index->slots = (const index_slot*) &index->map[sizeof(index_header)];
+	index->key_base = keys_are_raw(keys) != 0 ? index->source.map : &index->map[header->keys_offset];
+	
+	return check_index_slots(index, keys);
+	
+}
+
+/**
+ * @brief Unmaps an index and the file it indexes
+ * 
+ * @param index The index
+ */
+void close_join_index(join_index* index) {
+	
+	close_csv_reader(&index->source);
+	
+	if (index->map != NULL) {
+		munmap((void*) index->map, index->map_size);
+		index->map = NULL;
 	}
-	if (ferror(second_file) != 0) { 
-		fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
-		free(row1);
-		row1 = NULL;
-		free(row2);
-		row2 = NULL;
-		return 4;
+	
+}
+
+/**
+ * @brief Gives the rows of the indexed file without a match, or with
+ * 		  one, to the output as the mode of the join says, once the
+ * 		  probe file is read
+ * 
+ * @param index The index
+ * 		  marks The bits of the matched slots
+ * 		  context The context of the join
+ */
+int write_index_build_side(const join_index* index, const unsigned char* marks, const join_context* context) {
+	
+	const index_slot* slot = NULL;
+	bucket found_elem;
+	size_t i;
+	int error = 0;
+	
+	for (i = 0; i < index->header->nb_slots && error == 0; i++) {
+		slot = &index->slots[i];
+		if (slot->used != 0) {
+			found_elem.value = &index->source.map[slot->row];
+			found_elem.value_len = slot->row_len;
+			error = writer_append_build(context->writer, &found_elem, (marks[i >> 3] >> (i & 7)) & 1, context);
+		}
 	}
-	if (feof(second_file) != 0) {
-		fprintf(stderr, "Absence des données dans le deuxième fichier\n");
-		free(row1);
-		row1 = NULL;
-		free(row2);
-		row2 = NULL;
-		return 5;
+	
+	return error;
+	
+}
+
+/**
+ * @brief Join two files thanks to the index of the first one, built
+ * 		  before by build_join_index : there is no build phase, each
+ * 		  row of the second file is looked up in the mapped slots and
+ * 		  the matching rows are read from the mapped first file. The
+ * 		  second file is read once, in a single thread, and the only
+ * 		  memory taken is the writer and, for the modes that need
+ * 		  them, one bit per slot
+ * 
+ * @param first_file The indexed file, that has unique key values
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  index_name The name of the index file
+ * 		  keys The key of the join
+ * 		  options The order of the output, its background writer, the
+ * 		  mode of the join and whether it is reported
+ */
+int index_join(FILE* first_file, FILE* second_file, FILE* output_file, const char* index_name, const join_keys* keys, const join_options* options) {
+	
+	if (first_file == NULL || second_file == NULL || output_file == NULL) {
+		fprintf(stderr, "Un ou plusieurs fichiers déstinés à être écrits ou lus sont invalides");
+		return 9;
 	}
 	
-	id1 = row_element(row1, column_first_file);
-	id2 = row_element(row2, column_second_file);
-	if (id1 == NULL || id2 == NULL) {
+	memory_accountant accountant = { SIZE_MAX, 0, 0 };
+	join_stats stats;
+	output_writer writer;
+	join_context context = { &writer, keys, 0, 0, &accountant, options, &stats };
+	join_index index;
+	csv_reader probe;
+	unsigned char* marks = NULL;
+	output_buffer scratch = { NULL, 0, 0 };
+	const index_slot* slot = NULL;
+	bucket found_elem;
+	const char* row = NULL;
+	size_t len = 0;
+	const char* key = NULL;
+	size_t key_len = 0;
+	uint64_t hash = 0;
+	uint64_t phase_start = 0;
+	uint64_t start = 0;
+	int error = 0;
+	
+	if (keys->nb_columns == 0 || keys->nb_columns > KEY_MAX_COLUMNS) {
 		fprintf(stderr, "Indexes entrés invalides\n");
-		free(id1);
-		id1 = NULL;
-		free(row1);
-		row1 = NULL;
-		free(id2);
-		id2 = NULL;
-		free(row2);
-		row2 = NULL;
 		return 6;
 	}
-	if (strcmp(id1, id2) != 0) {
-		fprintf(stderr, "Colonnes aux types de contenu différents\n");
-		free(id1);
-		id1 = NULL;
-		free(row1);
-		row1 = NULL;
-		free(id2);
-		id2 = NULL;
-		free(row2);
-		row2 = NULL;
-		return 7;
+	
+	if (options->mode < JOIN_INNER || options->mode > JOIN_RIGHT_ANTI) {
+		fprintf(stderr, "Mode de jointure invalide\n");
+		return 14;
 	}
 	
-	write_rows(output_file, row1, row2, column_second_file);
+	init_join_stats(&stats, options->report);
+	phase_start = stats_clock(&stats);
 	
-	free(id1);
-	id1 = NULL;
-	free(row1);
-	row1 = NULL;
-	free(id2);
-	id2 = NULL;
-	free(row2);
-	row2 = NULL;
+	/* The index is checked before anything is written, a failed join leaves the output empty */
+	
+	error = open_join_index(&index, index_name, first_file, keys);
+	if (error == 15) fprintf(stderr, "Index \"%s\" illisible ou construit pour une autre clé\n", index_name);
+	if (error == 16) fprintf(stderr, "Index \"%s\" périmé, le premier fichier a changé depuis sa construction\n", index_name);
+	if (error == 0) error = join_key_headers(first_file, second_file, output_file, keys, options->mode, &context.nb_fields_first, &context.second_padding);
+	if (error != 0) {
+		close_join_index(&index);
+		return error;
+	}
+	
+	if (join_marks_matches(options->mode) != 0) {
+		marks = calloc(match_marks_bytes(index.header->nb_slots), 1);
+		if (marks == NULL) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour les marques des lignes appariées\n");
+			close_join_index(&index);
+			return 3;
+		}
+		account_alloc(&accountant, match_marks_bytes(index.header->nb_slots));
+	}
 	
-	while (feof(first_file) == 0) {
+	if (init_output_writer(&writer, output_file, options->background_writer, &stats) != 0) {
+		fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+		close_output_writer(&writer);
+		close_join_index(&index);
+		free(marks);
+		marks = NULL;
+		return 11;
+	}
+	
+	init_csv_reader(&probe, second_file);
+	start = stats_clock(&stats);
+	
+	while (error == 0 && reader_next_row(&probe, &row, &len) != 0) {
 		
-		row1 = read_row(first_file);
-		id1 = row_element(row1, column_first_file);
+		stats_add_time(&stats, JOIN_PHASE_READ, start);
+		stats_add_row(&stats, len);
 		
-		if (ferror(first_file) != 0 || (strcmp(row1, "\0") != 0 && (row1 == NULL || id1 == NULL))) {
-			if (hash_table != NULL) delete_Htable_and_content(&hash_table);
-			if (id1 == NULL) { 
-				fprintf(stderr, "Erreur dans l'allocation de mémoire pour une clé du premier fichier\n"); 
-				if (row1 != NULL) {
-					free(row1);
-					row1 = NULL;
-				}
-				return 2;
-			}
-			if (row1 == NULL) { 
-				fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du premier fichier\n"); 
-				free(id1);
-				id1 = NULL;
-				return 3;
-			}
-			if (ferror(first_file) != 0) {
-				fprintf(stderr, "Erreur dans la lecture du premier fichier\n");
-				free(id1);
-				id1 = NULL;
-				free(row1);
-				row1 = NULL;
-				return 4;
-			}
+		start = stats_clock(&stats);
+		error = row_key(keys, keys->columns_second, row, len, &probe.fields, &scratch, &key, &key_len);
+		stats_add_time(&stats, JOIN_PHASE_PARSE, start);
+		if (error != 0) {
+			print_key_error(error, "du deuxième fichier");
+			break;
 		}
 		
-		if (strcmp(row1, "\0") != 0) {
-			if (hash_table == NULL) hash_table = construct_Htable(size_given);
-			add_Htable_value(hash_table, row_element(row1, column_first_file), row1);
-			count++;
-		} else {
-			if (hash_table == NULL) break;
-		}
-		
-		if (count >= hash_table->size * HASH_TABLE_LOAD_FACTOR || (feof(first_file) != 0)) {
-
-			while (feof(second_file) == 0) {
-				
-				row2 = read_row(second_file);
-				id2 = row_element(row2, column_second_file);
-				
-				if (ferror(second_file) != 0 || (strcmp(row2, "\0") != 0 && (row2 == NULL || id2 == NULL))) {
-					delete_Htable_and_content(&hash_table);
-					if (id2 == NULL) { 
-						fprintf(stderr, "Erreur dans l'allocation de mémoire pour une clé du deuxième fichier\n");
-						free(id1);
-						id1 = NULL;
-						free(row1);
-						row1 = NULL;
-						if (row2 != NULL) {
-							free(row2);
-							row2 = NULL;
-						}
-						return 2;
-					}
-					if (row2 == NULL) {
-						fprintf(stderr, "Erreur dans l'allocation de mémoire pour une ligne du deuxième fichier\n");
-						free(id1);
-						id1 = NULL;
-						free(row1);
-						row1 = NULL;
-						free(id2);
-						id2 = NULL;
-						return 3;
-					}
-					if (ferror(second_file) != 0) {
-						fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n"); 
-						free(id1);
-						id1 = NULL;
-						free(row1);
-						row1 = NULL;
-						free(id2);
-						id2 = NULL;
-						free(row2);
-						row2 = NULL;
-						return 4;
-					}
-				}
-				
-				if (strcmp(row2, "\0") != 0) {		
-					found_elem = get_Htable_value(hash_table, row_element(row2, column_second_file));			
-					if (found_elem != NULL) write_rows(output_file, found_elem, row2, column_second_file);
-				}
-				
-				free(id2);
-				id2 = NULL;
-				free(row2);
-				row2 = NULL;
-				
-			}
-			
-			fseek(second_file, 0, SEEK_SET);
-			delete_Htable_and_content(&hash_table);
-			count = 0;
-			
+		hash = DEFAULT_KEY_HASH(key, key_len);
+		slot = find_index_slot(index.slots, index.header->nb_slots, index.key_base, hash, key, key_len);
+		
+		/* The slot is seen as a slot of the hash table, so that the output is the one of the hash join */
+		
+		if (slot->used != 0) {
+			found_elem.value = &index.source.map[slot->row];
+			found_elem.value_len = slot->row_len;
+			if (marks != NULL) marks[(slot - index.slots) >> 3] |= 1U << ((slot - index.slots) & 7);
+			stats_add_match(&stats, (((slot - index.slots) - hash) & (index.header->nb_slots - 1)) + 1);
 		}
 		
+		error = writer_append_probe(&writer, slot->used != 0 ? &found_elem : NULL, row, len, &probe.fields, &context);
+		if (error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour le fichier résultat\n");
+		if (error == 11) fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+		
+		start = stats_clock(&stats);
+		
 	}
 	
-	free(id1);
-	id1 = NULL;
-	free(row1);
-	row1 = NULL;
+	if (error == 0 && reader_error(&probe) != 0) {
+		fprintf(stderr, "Erreur dans la lecture du deuxième fichier\n");
+		error = 4;
+	}
+	
+	if (error == 0 && marks != NULL) {
+		error = write_index_build_side(&index, marks, &context);
+		if (error == 3) fprintf(stderr, "Erreur dans l'allocation de mémoire pour le fichier résultat\n");
+		if (error == 11) fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+	}
+	
+	close_csv_reader(&probe);
+	close_join_index(&index);
+	free(marks);
+	marks = NULL;
+	free(scratch.data);
+	scratch.data = NULL;
+	
+	if (close_output_writer(&writer) != 0 && error == 0) {
+		fprintf(stderr, "Erreur dans l'écriture du fichier résultat\n");
+		error = 11;
+	}
+	
+	/* There is no build phase, the whole join is the probe of the index */
+	
+	stats_add_time(&stats, JOIN_PHASE_PROBE, phase_start);
+	if (options->report != 0) print_join_report(&stats, &accountant, stats.phase_ns[JOIN_PHASE_PROBE]);
+	
+	return error;
+	
+}
+
+/* ======================================================================
+ * Part V -- Command line
+ * ======================================================================
+ */
+
+#define CLI_DEFAULT_BUDGET ((size_t) 64 << 20)
+
+/* The names of the modes of join, in the order of their constants */
+
+const char* join_mode_names[] = { "inner", "left", "right", "full", "left-semi", "left-anti", "right-semi", "right-anti" };
+
+/**
+ * @brief Reads a decimal number from an argument of the command line.
+ * 		  Returns 0 on success, 1 if the argument is not a number
+ * 
+ * @param text The argument
+ * 		  value The number, set
+ */
+int parse_size(const char* text, size_t* value) {
+	
+	char* end = NULL;
+	unsigned long long parsed = 0;
+	
+	if (text[0] < '0' || text[0] > '9') return 1;
+	
+	errno = 0;
+	parsed = strtoull(text, &end, 10);
+	if (errno != 0 || *end != '\0' || parsed > SIZE_MAX) return 1;
+	
+	*value = parsed;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Adds a column to the key of a join from an argument of the
+ * 		  command line, "c1:c2" or "c1:c2:type", where c1 and c2 are
+ * 		  the indexes of the column in each file and type is "text",
+ * 		  the default, or "int". Returns 0 on success, 1 otherwise
+ * 
+ * @param spec The argument
+ * 		  keys The key of the join, updated
+ */
+int parse_key_columns(const char* spec, join_keys* keys) {
+	
+	char text[64] = "";
+	char* second = NULL;
+	char* type = NULL;
+	size_t i = keys->nb_columns;
+	
+	if (i >= KEY_MAX_COLUMNS || strlen(spec) >= sizeof(text)) return 1;
+	
+	strcpy(text, spec);
+	second = strchr(text, ':');
+	if (second == NULL) return 1;
+	*second++ = '\0';
+	type = strchr(second, ':');
+	if (type != NULL) *type++ = '\0';
+	
+	if (parse_size(text, &keys->columns_first[i]) != 0 || parse_size(second, &keys->columns_second[i]) != 0) return 1;
+	
+	if (type == NULL || strcmp(type, "text") == 0) keys->types[i] = KEY_TEXT;
+	else if (strcmp(type, "int") == 0) keys->types[i] = KEY_INTEGER;
+	else return 1;
+	
+	keys->nb_columns++;
 	
 	return 0;
 	
 }
 
+/**
+ * @brief Reads the mode of a join from its name. Returns 0 on
+ * 		  success, 1 if the name is unknown
+ * 
+ * @param name The name
+ * 		  mode The mode, set
+ */
+int parse_join_mode(const char* name, int* mode) {
+	
+	int i;
+	
+	for (i = JOIN_INNER; i <= JOIN_RIGHT_ANTI; i++) {
+		if (strcmp(name, join_mode_names[i]) == 0) {
+			*mode = i;
+			return 0;
+		}
+	}
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Opens a file named on the command line, "-" being the standard
+ * 		  input or output. Returns NULL if it cannot be opened
+ * 
+ * @param name The name of the file
+ * 		  mode "r" or "w"
+ */
+FILE* open_argument(const char* name, const char* mode) {
+	
+	FILE* file = NULL;
+	
+	if (strcmp(name, "-") == 0) return mode[0] == 'r' ? stdin : stdout;
+	
+	file = fopen(name, mode);
+	if (file == NULL) fprintf(stderr, "Impossible d'ouvrir le fichier \"%s\" en mode \"%s\"\n", name, mode);
+	
+	return file;
+	
+}
+
+/**
+ * @brief Closes a file opened by open_argument. The standard output is
+ * 		  only flushed
+ * 
+ * @param file The file, or NULL
+ */
+void close_argument(FILE* file) {
+	
+	if (file == stdout) fflush(file);
+	else if (file != NULL && file != stdin) fclose(file);
+	
+}
+
+/**
+ * @brief Prints how to use the command line
+ * 
+ * @param program The name of the program
+ */
+void print_usage(const char* program) {
+	
+	fprintf(stderr, "Usage : %s [options] premier_fichier second_fichier\n", program);
+	fprintf(stderr, "  -o fichier       fichier résultat, la sortie standard par défaut\n");
+	fprintf(stderr, "  -k c1:c2[:type]  colonne de la clé dans chaque fichier, de type text ou int,\n");
+	fprintf(stderr, "                   à répéter pour une clé composée, 0:0 par défaut\n");
+	fprintf(stderr, "  -m octets        budget mémoire, %zu par défaut\n", CLI_DEFAULT_BUDGET);
+	fprintf(stderr, "  -j mode          inner, left, right, full, left-semi, left-anti, right-semi ou right-anti\n");
+	fprintf(stderr, "  -t threads       nombre de threads de sondage\n");
+	fprintf(stderr, "  -u               lignes écrites dès qu'elles sont trouvées, sans garder l'ordre\n");
+	fprintf(stderr, "  -r               rapport JSON de la jointure sur la sortie d'erreur : mémoire, lignes, phases\n");
+	fprintf(stderr, "  -d               clés en double dans le premier fichier, toutes leurs lignes sont jointes\n");
+	fprintf(stderr, "  -s, -S           premier, second fichier déjà trié sur sa clé\n");
+	fprintf(stderr, "  -x index         jointure par l'index du premier fichier, construit ou reconstruit\n");
+	fprintf(stderr, "                   s'il manque, est périmé ou est pour une autre clé\n");
+	fprintf(stderr, "Un des fichiers peut être l'entrée standard, nommée \"-\". Ses lignes n'ont pas de longueur maximale\n");
+	fprintf(stderr, "et sont jointes comme celles d'un fichier nommé. Elle n'est lue qu'une fois :\n");
+	fprintf(stderr, "quand le premier fichier dépasse le budget, elle est partitionnée dans des fichiers temporaires.\n");
+	
+}
+
+/**
+ * @brief Joins two files through the index of the first one, that is
+ * 		  built first when it is missing, stale, or for another key.
+ * 		  Returns an error code of hash_join
+ * 
+ * @param first_file The indexed file, a regular one
+ * 		  second_file The file that can have several same key values
+ * 		  output_file The file where the result is written
+ * 		  index_name The name of the index file
+ * 		  keys The key of the join
+ * 		  options The order of the output, its background writer and
+ * 		  the mode of the join
+ */
+int indexed_join(FILE* first_file, FILE* second_file, FILE* output_file, const char* index_name, const join_keys* keys, const join_options* options) {
+	
+	join_index index;
+	int error = open_join_index(&index, index_name, first_file, keys);
+	
+	close_join_index(&index);
+	
+	if (error != 0) {
+		rewind(first_file);
+		error = build_join_index(first_file, index_name, keys);
+		if (error != 0) return error;
+	}
+	
+	rewind(first_file);
+	
+	return index_join(first_file, second_file, output_file, index_name, keys, options);
+	
+}
+
+/**
+ * @brief Joins the files named on the command line, without asking
+ * 		  anything. With an index, the join goes through it, else a
+ * 		  single text key goes through the planner, a composite or
+ * 		  typed one through the hash join. Returns an error code of
+ * 		  hash_join, or EXIT_FAILURE if the arguments are invalid or
+ * 		  a file cannot be opened
+ * 
+ * @param argc The number of arguments
+ * 		  argv The arguments
+ */
+int command_line_join(int argc, char** argv) {
+	
+	join_options options;
+	join_keys keys;
+	size_t max_memory = CLI_DEFAULT_BUDGET;
+	const char* output_name = "-";
+	const char* index_name = NULL;
+	FILE* first_file = NULL;
+	FILE* second_file = NULL;
+	FILE* output_file = NULL;
+	int option = 0;
+	int error = 0;
+	
+	default_join_options(&options);
+	keys.nb_columns = 0;
+	opterr = 0;
+	
+	while (error == 0 && (option = getopt(argc, argv, "o:k:m:j:t:x:rdusS")) != -1) {
+		
+		if (option == 'o') {
+			output_name = optarg;
+		} else if (option == 'k') {
+			error = parse_key_columns(optarg, &keys);
+			if (error != 0) fprintf(stderr, "Colonnes de clé invalides : %s\n", optarg);
+		} else if (option == 'm') {
+			error = parse_size(optarg, &max_memory);
+			if (error != 0) fprintf(stderr, "Budget mémoire invalide : %s\n", optarg);
+		} else if (option == 'j') {
+			error = parse_join_mode(optarg, &options.mode);
+			if (error != 0) fprintf(stderr, "Mode de jointure inconnu : %s\n", optarg);
+		} else if (option == 't') {
+			error = parse_size(optarg, &options.nb_threads) != 0 || options.nb_threads == 0;
+			if (error != 0) fprintf(stderr, "Nombre de threads invalide : %s\n", optarg);
+		} else if (option == 'x') {
+			index_name = optarg;
+		} else if (option == 'r') {
+			options.report = 1;
+		} else if (option == 'd') {
+			options.duplicate_keys = 1;
+		} else if (option == 'u') {
+			options.ordered_output = 0;
+		} else if (option == 's') {
+			options.first_sorted = 1;
+		} else if (option == 'S') {
+			options.second_sorted = 1;
+		} else {
+			fprintf(stderr, "Option invalide : -%c\n", optopt);
+			error = 1;
+		}
+		
+	}
+	
+	if (error == 0 && argc - optind != 2) {
+		fprintf(stderr, "Il faut deux fichiers à joindre\n");
+		error = 1;
+	}
+	if (error == 0 && strcmp(argv[optind], "-") == 0 && strcmp(argv[optind + 1], "-") == 0) {
+		fprintf(stderr, "Un seul des deux fichiers peut être l'entrée standard\n");
+		error = 1;
+	}
+	if (error == 0 && index_name != NULL && strcmp(argv[optind], "-") == 0) {
+		fprintf(stderr, "Le premier fichier ne peut pas être indexé depuis l'entrée standard\n");
+		error = 1;
+	}
+	if (error == 0 && index_name != NULL && options.duplicate_keys != 0) {
+		fprintf(stderr, "L'index ne garde qu'une ligne par clé, il ne sert pas avec des clés en double\n");
+		error = 1;
+	}
+	if (error != 0) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	
+	if (keys.nb_columns == 0) single_join_keys(&keys, 0, 0);
+	
+	first_file = open_argument(argv[optind], "r");
+	second_file = open_argument(argv[optind + 1], "r");
+	output_file = open_argument(output_name, "w");
+	
+	if (first_file == NULL || second_file == NULL || output_file == NULL) {
+		error = EXIT_FAILURE;
+	} else if (index_name != NULL) {
+		error = indexed_join(first_file, second_file, output_file, index_name, &keys, &options);
+	} else if (keys_are_raw(&keys) != 0) {
+		error = planned_join(first_file, second_file, output_file, keys.columns_first[0], keys.columns_second[0], max_memory, &options);
+	} else {
+		error = hash_join_on_keys(first_file, second_file, output_file, &keys, max_memory, &options);
+	}
+	
+	close_argument(first_file);
+	close_argument(second_file);
+	close_argument(output_file);
+	
+	return error;
+	
+}
+
 /* ======================================================================
  * Provided: main()
  * ======================================================================
  */
 
-int main(void)
+int main(int argc, char** argv)
 {
+    if (argc > 1) {
+        return command_line_join(argc, argv);
+    }
+
     FILE* in1 = ask_filename_and_open("Entrez le nom du premier fichier : ", "r");
     if (in1 == NULL) {
         return EXIT_FAILURE;
@@ -0,0 +1,1067 @@
+/* ======================================================================
+ * Benchmarks for csv_join.c
+ * 
+ * Compile with : gcc -std=c99 -O2 -pthread -o csv_join_bench csv_join_bench.c -lm
+ * Usage        : ./csv_join_bench htable [number of keys]
+ *                ./csv_join_bench parse <CSV file>
+ *                ./csv_join_bench hash [number of keys]
+ *                ./csv_join_bench generate <prefix> <build rows> <probe rows>
+ *                                 [cardinality] [zipf exponent] [field width]
+ *                                 [match rate] [seed]
+ *                ./csv_join_bench join <first file> <second file> <column 1>
+ *                                 <column 2> [budget ...]
+ *                ./csv_join_bench suite [directory] [build rows]
+ *                ./csv_join_bench stream [directory] [build rows]
+ * 
+ * The suite prints one line per dataset and budget. Between two commits,
+ * the rows, output rows and checksums must not change, and the columns of
+ * throughput show the regressions :
+ *                ./csv_join_bench suite /tmp > before.txt
+ *                ./csv_join_bench suite /tmp > after.txt
+ *                diff before.txt after.txt
+ *
+ * The stream check joins files with rows longer than a kilobyte through
+ * the command line, each one named and then piped on the standard input,
+ * and fails if a piped run does not give the rows of the named one.
+ * ======================================================================
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <math.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/* csv_join.c is compiled in directly, its main() is renamed out of the way */
+
+#define main csv_join_main
+#include "csv_join.c"
+#undef main
+
+/* ======================================================================
+ * Reference: the former chained hash table
+ * ======================================================================
+ */
+
+typedef struct chained_bucket_struct {
+	const char* key;
+	const void* value;
+	struct chained_bucket_struct* next_elem;
+} chained_bucket;
+
+typedef struct {
+	size_t size;
+	chained_bucket** content;
+} chained_Htable;
+
+chained_Htable* construct_chained_Htable(size_t size) {
+	
+	chained_Htable* hash_table = malloc(sizeof(chained_Htable));
+	
+	if (hash_table == NULL) return NULL;
+	
+	hash_table->size = size;
+	hash_table->content = calloc(size, sizeof(chained_bucket*));
+	
+	if (hash_table->content == NULL) {
+		free(hash_table);
+		return NULL;
+	}
+	
+	return hash_table;
+	
+}
+
+void delete_chained_Htable(chained_Htable* hash_table) {
+	
+	size_t i;
+	chained_bucket* elem_to_delete = NULL;
+	
+	for (i = 0; i < hash_table->size; i++) {
+		while (hash_table->content[i] != NULL) {
+			elem_to_delete = hash_table->content[i];
+			hash_table->content[i] = elem_to_delete->next_elem;
+			free(elem_to_delete);
+		}
+	}
+	
+	free(hash_table->content);
+	free(hash_table);
+	
+}
+
+void add_chained_Htable_value(chained_Htable* hash_table, const char* key, const void* value) {
+	
+	size_t hash_key_value = hash_function(key, hash_table->size);
+	chained_bucket* current_elem = hash_table->content[hash_key_value];
+	chained_bucket* previous_elem = NULL;
+	chained_bucket* added_pair = NULL;
+	
+	while (current_elem != NULL && strcmp(key, current_elem->key) != 0) {
+		previous_elem = current_elem;
+		current_elem = current_elem->next_elem;
+	}
+	
+	if (current_elem != NULL) {
+		current_elem->value = value;
+	} else if ((added_pair = malloc(sizeof(chained_bucket))) != NULL) {
+		added_pair->key = key;
+		added_pair->value = value;
+		added_pair->next_elem = NULL;
+		if (previous_elem == NULL) hash_table->content[hash_key_value] = added_pair;
+		else previous_elem->next_elem = added_pair;
+	}
+	
+}
+
+const void* get_chained_Htable_value(chained_Htable* hash_table, const char* key) {
+	
+	chained_bucket* current_elem = hash_table->content[hash_function(key, hash_table->size)];
+	
+	while (current_elem != NULL && strcmp(key, current_elem->key) != 0) {
+		current_elem = current_elem->next_elem;
+	}
+	
+	return current_elem != NULL ? current_elem->value : NULL;
+	
+}
+
+/* ======================================================================
+ * Benchmarks
+ * ======================================================================
+ */
+
+/**
+ * @brief Returns the current time in seconds
+ */
+double now(void) {
+	
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+	
+}
+
+/**
+ * @brief Builds keys "K0" ... "K<2n-1>", the first half is inserted
+ * 		  in the tables and the second half is only used to miss
+ * 
+ * @param nb_keys The number of keys to insert
+ */
+char** make_keys(size_t nb_keys) {
+	
+	char** keys = calloc(2 * nb_keys, sizeof(char*));
+	size_t i;
+	
+	if (keys == NULL) return NULL;
+	
+	for (i = 0; i < 2 * nb_keys; i++) {
+		keys[i] = malloc(24);
+		if (keys[i] == NULL) return NULL;
+		sprintf(keys[i], "K%zu", (i * 2654435761u) % (1000 * nb_keys));
+	}
+	
+	return keys;
+	
+}
+
+/**
+ * @brief Compares the probe throughput of the open addressing table
+ * 		  with the former chained table, at the join's load factor,
+ * 		  for a 50 % hit rate
+ * 
+ * @param nb_keys The number of keys in the tables
+ */
+int bench_htable(size_t nb_keys) {
+	
+	size_t size = nb_keys / HASH_TABLE_LOAD_FACTOR + 1;
+	size_t nb_probes = 10 * nb_keys;
+	size_t found = 0;
+	size_t i;
+	double start = 0.0;
+	double build_time = 0.0;
+	double probe_time = 0.0;
+	
+	char** keys = make_keys(nb_keys);
+	Htable* table = construct_Htable(size);
+	chained_Htable* chained_table = construct_chained_Htable(size);
+	
+	if (keys == NULL || table == NULL || chained_table == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour le benchmark\n");
+		return 3;
+	}
+	
+	printf("table              keys      build (Mkeys/s)  probe (Mprobes/s)\n");
+	
+	start = now();
+	for (i = 0; i < nb_keys; i++) add_chained_Htable_value(chained_table, keys[i], keys[i]);
+	build_time = now() - start;
+	start = now();
+	for (i = 0; i < nb_probes; i++) found += get_chained_Htable_value(chained_table, keys[(i * 7) % (2 * nb_keys)]) != NULL;
+	probe_time = now() - start;
+	printf("chained     %11zu  %15.2f  %17.2f\n", nb_keys, nb_keys / build_time * 1e-6, nb_probes / probe_time * 1e-6);
+	
+	start = now();
+	for (i = 0; i < nb_keys; i++) add_Htable_value(table, keys[i], keys[i]);
+	build_time = now() - start;
+	start = now();
+	for (i = 0; i < nb_probes; i++) found -= get_Htable_value(table, keys[(i * 7) % (2 * nb_keys)]) != NULL;
+	probe_time = now() - start;
+	printf("robin hood  %11zu  %15.2f  %17.2f\n", nb_keys, nb_keys / build_time * 1e-6, nb_probes / probe_time * 1e-6);
+	
+	/* Both tables must agree on every probe */
+	
+	if (found != 0) {
+		fprintf(stderr, "Les deux tables ne donnent pas les mêmes résultats\n");
+		return 1;
+	}
+	
+	/* The keys were not allocated in the table's arena, they are freed separately */
+	
+	delete_Htable_and_content(&table);
+	delete_chained_Htable(chained_table);
+	for (i = 0; i < 2 * nb_keys; i++) free(keys[i]);
+	free(keys);
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Scans all the rows of a mapped file and builds the index of
+ * 		  their fields, with the vectorized or the scalar scanner.
+ * 		  Returns the number of fields seen
+ * 
+ * @param map The mapping
+ * 		  map_size The size of the mapping
+ * 		  scalar Whether to use the scalar scanner
+ */
+size_t scan_all_rows(const char* map, size_t map_size, int scalar) {
+	
+	csv_fields fields;
+	size_t position = 0;
+	size_t len = 0;
+	size_t nb_fields = 0;
+	
+	while (position < map_size) {
+		if (scalar != 0) {
+			fields.nb_separators = 0;
+			fields.overflow = 0;
+			len = csv_scan_row_scalar(&map[position], map_size - position, 0, &fields);
+		} else {
+			len = csv_scan_row(&map[position], map_size - position, &fields);
+		}
+		nb_fields += fields.nb_separators + 1;
+		position += len + 1;
+	}
+	
+	return nb_fields;
+	
+}
+
+/**
+ * @brief Measures the parsing throughput, in GB/s, of the scalar and
+ * 		  of the vectorized row scanners on a CSV file. The vectorized
+ * 		  one is named after the scanner picked for this processor.
+ * 		  The file should be a few GB, so that the page cache and not
+ * 		  the disk is timed after the first pass
+ * 
+ * @param filename The name of the file
+ */
+int bench_parse(const char* filename) {
+	
+	FILE* f = fopen(filename, "r");
+	csv_reader reader;
+	size_t nb_fields[2] = { 0, 0 };
+	double start = 0.0;
+	double elapsed = 0.0;
+	int scalar;
+	
+	if (f == NULL) {
+		fprintf(stderr, "Oops, je n'ai pas réussi à ouvrir le fichier \"%s\"\n", filename);
+		return EXIT_FAILURE;
+	}
+	
+	init_csv_reader(&reader, f);
+	if (reader.map == NULL) {
+		fprintf(stderr, "Le fichier \"%s\" n'a pas pu être projeté en mémoire\n", filename);
+		fclose(f);
+		return EXIT_FAILURE;
+	}
+	
+	/* A first pass brings the file in the page cache */
+	
+	scan_all_rows(reader.map, reader.map_size, 0);
+	
+	printf("scanner        size (MB)    GB/s\n");
+	for (scalar = 1; scalar >= 0; scalar--) {
+		start = now();
+		nb_fields[scalar] = scan_all_rows(reader.map, reader.map_size, scalar);
+		elapsed = now() - start;
+		printf("%-10s  %12.1f  %6.2f\n", scalar != 0 ? "scalar" : csv_scan_engine(), reader.map_size * 1e-6, reader.map_size / elapsed * 1e-9);
+	}
+	
+	close_csv_reader(&reader);
+	fclose(f);
+	
+	if (nb_fields[0] != nb_fields[1]) {
+		fprintf(stderr, "Les deux analyseurs ne trouvent pas les mêmes champs\n");
+		return 1;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Hashes keys of a buffer with a key hash function. Returns the
+ * 		  combination of the hashes, so that none of them is optimized
+ * 		  out
+ * 
+ * @param key_hash The function
+ * 		  text The buffer the keys are taken from
+ * 		  offsets The offset of each key in the buffer
+ * 		  lengths The length of each key
+ * 		  nb_keys The number of keys
+ */
+uint64_t hash_all_keys(key_hash_function key_hash, const char* text, const uint32_t* offsets, const uint8_t* lengths, size_t nb_keys) {
+	
+	uint64_t combined = 0;
+	size_t i;
+	
+	for (i = 0; i < nb_keys; i++) {
+		combined += key_hash(&text[offsets[i]], lengths[i]);
+	}
+	
+	return combined;
+	
+}
+
+/**
+ * @brief Measures the throughput, in millions of keys and in MB per
+ * 		  second, of the former Jenkins hash and of the word at a time
+ * 		  hash used by the join, for keys of 4, 8, 16, 32 and 64 bytes
+ * 		  and for keys of mixed lengths from 1 to 64 bytes
+ * 
+ * @param nb_keys The number of keys hashed for each length
+ */
+int bench_hash(size_t nb_keys) {
+	
+	const size_t key_lengths[] = { 4, 8, 16, 32, 64, 0 };
+	const key_hash_function functions[] = { hash_jenkins, hash_words };
+	const char* names[] = { "jenkins", "words" };
+	size_t text_size = 1 << 20;
+	char* text = malloc(text_size + 64);
+	uint32_t* offsets = malloc(nb_keys * sizeof(uint32_t));
+	uint8_t* lengths = malloc(nb_keys);
+	uint64_t combined = 0;
+	uint64_t random = 88172645463325252ULL;
+	size_t nb_bytes = 0;
+	size_t i;
+	size_t l;
+	size_t f;
+	double start = 0.0;
+	double elapsed = 0.0;
+	
+	if (text == NULL || offsets == NULL || lengths == NULL) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour les clés\n");
+		free(text);
+		free(offsets);
+		free(lengths);
+		return EXIT_FAILURE;
+	}
+	
+	/* The keys are views at random offsets in a buffer of printable characters, as in a CSV file */
+	
+	for (i = 0; i < text_size + 64; i++) {
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		text[i] = 'A' + random % 58;
+	}
+	
+	printf("key length    function    Mkeys/s      MB/s\n");
+	for (l = 0; l < sizeof(key_lengths) / sizeof(key_lengths[0]); l++) {
+		nb_bytes = 0;
+		for (i = 0; i < nb_keys; i++) {
+			random ^= random << 13;
+			random ^= random >> 7;
+			random ^= random << 17;
+			offsets[i] = random % text_size;
+			lengths[i] = key_lengths[l] != 0 ? key_lengths[l] : 1 + (random >> 32) % 64;
+			nb_bytes += lengths[i];
+		}
+		for (f = 0; f < 2; f++) {
+			start = now();
+			combined += hash_all_keys(functions[f], text, offsets, lengths, nb_keys);
+			elapsed = now() - start;
+			if (key_lengths[l] != 0) printf("%10zu  ", key_lengths[l]);
+			else printf("%10s  ", "1 to 64");
+			printf("%10s  %9.1f  %8.1f\n", names[f], nb_keys / elapsed * 1e-6, nb_bytes / elapsed * 1e-6);
+		}
+	}
+	
+	/* Printed so that the hashes can't be optimized out */
+	
+	printf("(%llx)\n", (unsigned long long) combined);
+	
+	free(text);
+	text = NULL;
+	free(offsets);
+	offsets = NULL;
+	free(lengths);
+	lengths = NULL;
+	
+	return 0;
+	
+}
+
+/* ======================================================================
+ * Joins on generated data
+ * ======================================================================
+ */
+
+#define BENCH_KEY_COLUMN_BUILD 0
+#define BENCH_KEY_COLUMN_PROBE 1
+#define BENCH_DEFAULT_SEED 42
+
+/**
+ * @brief Datastructure for type bench_dataset, how a pair of CSV files
+ * 		  is generated : the rows of each file, the number of distinct
+ * 		  keys the second file draws from, the exponent of their Zipf
+ * 		  law, 0 for a uniform one, the width of the other fields, the
+ * 		  share of the second file's rows that have a match, and the
+ * 		  seed of the generator. The same dataset always gives the same
+ * 		  files
+ */
+struct bench_dataset_struct {
+	
+	const char* name;
+	size_t build_rows;
+	size_t probe_rows;
+	size_t cardinality;
+	double zipf;
+	size_t width;
+	double match_rate;
+	uint64_t seed;
+	
+};
+
+typedef struct bench_dataset_struct bench_dataset;
+
+/**
+ * @brief Returns the next number of a xorshift64* generator
+ * 
+ * @param state The state of the generator, updated
+ */
+uint64_t bench_random(uint64_t* state) {
+	
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	
+	return *state * 2685821657736338717ULL;
+	
+}
+
+/**
+ * @brief Returns a number in [0, 1) from a xorshift64* generator
+ * 
+ * @param state The state of the generator, updated
+ */
+double bench_uniform(uint64_t* state) {
+	
+	return (bench_random(state) >> 11) * (1.0 / 9007199254740992.0);
+	
+}
+
+/**
+ * @brief Returns the key of a rank. The mixing is a bijection, so that
+ * 		  different ranks give different keys, spread over the hash
+ * 		  table whatever their order
+ * 
+ * @param rank The rank
+ */
+uint64_t bench_key(uint64_t rank) {
+	
+	rank += 0x9E3779B97F4A7C15ULL;
+	rank = (rank ^ (rank >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	rank = (rank ^ (rank >> 27)) * 0x94D049BB133111EBULL;
+	
+	return rank ^ (rank >> 31);
+	
+}
+
+/**
+ * @brief Returns the cumulative distribution of a Zipf law over a
+ * 		  number of ranks, to be freed, or NULL if it could not be
+ * 		  allocated
+ * 
+ * @param nb_ranks The number of ranks
+ * 		  exponent The exponent of the law, 0 for a uniform law
+ */
+double* zipf_distribution(size_t nb_ranks, double exponent) {
+	
+	double* cumulative = malloc(nb_ranks * sizeof(double));
+	double total = 0.0;
+	size_t i;
+	
+	if (cumulative == NULL) return NULL;
+	
+	for (i = 0; i < nb_ranks; i++) {
+		total += exponent != 0.0 ? pow(i + 1, -exponent) : 1.0;
+		cumulative[i] = total;
+	}
+	for (i = 0; i < nb_ranks; i++) {
+		cumulative[i] /= total;
+	}
+	
+	return cumulative;
+	
+}
+
+/**
+ * @brief Draws a rank from a cumulative distribution
+ * 
+ * @param cumulative The cumulative distribution
+ * 		  nb_ranks The number of ranks
+ * 		  state The state of the generator, updated
+ */
+size_t zipf_draw(const double* cumulative, size_t nb_ranks, uint64_t* state) {
+	
+	double u = bench_uniform(state);
+	size_t low = 0;
+	size_t high = nb_ranks - 1;
+	size_t middle = 0;
+	
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		if (cumulative[middle] < u) low = middle + 1;
+		else high = middle;
+	}
+	
+	return low;
+	
+}
+
+/**
+ * @brief Writes a field of random lowercase letters
+ * 
+ * @param f The file
+ * 		  width The width of the field
+ * 		  state The state of the generator, updated
+ */
+void write_random_field(FILE* f, size_t width, uint64_t* state) {
+	
+	uint64_t bits = 0;
+	size_t i;
+	
+	for (i = 0; i < width; i++) {
+		if (i % 8 == 0) bits = bench_random(state);
+		fputc('a' + (bits & 0xFF) % 26, f);
+		bits >>= 8;
+	}
+	
+}
+
+/**
+ * @brief Generates the pair of files of a dataset. The first file has
+ * 		  the keys of the ranks 0 to build_rows - 1, in its column
+ * 		  BENCH_KEY_COLUMN_BUILD. Each row of the second file draws a
+ * 		  rank from the Zipf law of the dataset, and takes its key from
+ * 		  the first file with a probability of match_rate, from ranks
+ * 		  beyond it otherwise, in its column BENCH_KEY_COLUMN_PROBE.
+ * 		  Returns 0 on success
+ * 
+ * @param dataset The dataset
+ * 		  build_name The name of the first file
+ * 		  probe_name The name of the second file
+ */
+int generate_dataset(const bench_dataset* dataset, const char* build_name, const char* probe_name) {
+	
+	size_t nb_ranks = dataset->cardinality < dataset->build_rows ? dataset->cardinality : dataset->build_rows;
+	double* cumulative = NULL;
+	FILE* build = NULL;
+	FILE* probe = NULL;
+	uint64_t state = dataset->seed != 0 ? dataset->seed : BENCH_DEFAULT_SEED;
+	size_t rank = 0;
+	size_t i;
+	int error = 0;
+	
+	if (nb_ranks == 0) {
+		fprintf(stderr, "Il faut au moins une ligne et une clé dans le premier fichier\n");
+		return 1;
+	}
+	
+	cumulative = zipf_distribution(nb_ranks, dataset->zipf);
+	build = fopen(build_name, "w");
+	probe = fopen(probe_name, "w");
+	
+	if (cumulative == NULL || build == NULL || probe == NULL) {
+		fprintf(stderr, "Impossible de générer les fichiers \"%s\" et \"%s\"\n", build_name, probe_name);
+		error = 1;
+	}
+	
+	if (error == 0) {
+		
+		fprintf(build, "key,name,payload\n");
+		for (i = 0; i < dataset->build_rows; i++) {
+			fprintf(build, "%016llx,", (unsigned long long) bench_key(i));
+			write_random_field(build, dataset->width, &state);
+			fputc(',', build);
+			write_random_field(build, dataset->width, &state);
+			fputc('\n', build);
+		}
+		
+		/* The missing keys follow the same law, over ranks that the first file does not have */
+		
+		fprintf(probe, "id,key,value\n");
+		for (i = 0; i < dataset->probe_rows; i++) {
+			rank = zipf_draw(cumulative, nb_ranks, &state);
+			if (bench_uniform(&state) >= dataset->match_rate) rank += dataset->build_rows;
+			fprintf(probe, "%zu,%016llx,", i, (unsigned long long) bench_key(rank));
+			write_random_field(probe, dataset->width, &state);
+			fputc('\n', probe);
+		}
+		
+		if (ferror(build) != 0 || ferror(probe) != 0) {
+			fprintf(stderr, "Erreur dans l'écriture des fichiers \"%s\" et \"%s\"\n", build_name, probe_name);
+			error = 1;
+		}
+		
+	}
+	
+	if (build != NULL && fclose(build) != 0) error = 1;
+	if (probe != NULL && fclose(probe) != 0) error = 1;
+	free(cumulative);
+	cumulative = NULL;
+	
+	return error;
+	
+}
+
+/**
+ * @brief Returns the sum of the FNV-1a hashes of the rows of a file,
+ * 		  from its beginning, so that the outputs of two runs can be
+ * 		  compared whatever the order of their rows, which depends on
+ * 		  the partitions of the join
+ * 
+ * @param f The file
+ */
+uint64_t file_checksum(FILE* f) {
+	
+	char block[BUFSIZ];
+	uint64_t checksum = 0;
+	uint64_t row_hash = 14695981039346656037ULL;
+	size_t nb_read = 0;
+	size_t i;
+	
+	rewind(f);
+	while ((nb_read = fread(block, 1, sizeof(block), f)) > 0) {
+		for (i = 0; i < nb_read; i++) {
+			if (block[i] == '\n') {
+				checksum += row_hash;
+				row_hash = 14695981039346656037ULL;
+			} else {
+				row_hash = (row_hash ^ (unsigned char) block[i]) * 1099511628211ULL;
+			}
+		}
+	}
+	
+	return checksum;
+	
+}
+
+/**
+ * @brief Joins two files with hash_join and a budget, in a child
+ * 		  process so that its peak resident memory is its own, and
+ * 		  prints a line of results : the rows read per second, the
+ * 		  megabytes read per second, the peak resident memory, and the
+ * 		  number of rows and the checksum of the output, which must
+ * 		  not change between two versions of the join nor between two
+ * 		  budgets. The output is a
+ * 		  temporary file, read for the checksum once the join is timed.
+ * 		  Returns 0 on success
+ * 
+ * @param label The name of the dataset in the results
+ * 		  build_name The name of the first file
+ * 		  probe_name The name of the second file
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ * 		  budget The memory budget of the join
+ */
+int bench_join_run(const char* label, const char* build_name, const char* probe_name, size_t column_first_file, size_t column_second_file, size_t budget) {
+	
+	pid_t child = 0;
+	int status = 0;
+	
+	fflush(stdout);
+	child = fork();
+	
+	if (child < 0) {
+		fprintf(stderr, "Impossible de lancer la jointure\n");
+		return 1;
+	}
+	
+	if (child == 0) {
+		
+		FILE* build = fopen(build_name, "r");
+		FILE* probe = fopen(probe_name, "r");
+		FILE* output = tmpfile();
+		struct rusage usage;
+		struct stat build_stat;
+		struct stat probe_stat;
+		double start = 0.0;
+		double elapsed = 0.0;
+		size_t nb_rows = 0;
+		size_t out_rows = 0;
+		char block[BUFSIZ];
+		size_t nb_read = 0;
+		size_t i;
+		int error = 0;
+		
+		if (build == NULL || probe == NULL || output == NULL || fstat(fileno(build), &build_stat) != 0 || fstat(fileno(probe), &probe_stat) != 0) {
+			fprintf(stderr, "Impossible d'ouvrir les fichiers \"%s\" et \"%s\"\n", build_name, probe_name);
+			_exit(1);
+		}
+		
+		/* The rows are counted before the join, which then finds the files in the page cache */
+		
+		while ((nb_read = fread(block, 1, sizeof(block), build)) > 0) for (i = 0; i < nb_read; i++) nb_rows += block[i] == '\n';
+		while ((nb_read = fread(block, 1, sizeof(block), probe)) > 0) for (i = 0; i < nb_read; i++) nb_rows += block[i] == '\n';
+		rewind(build);
+		rewind(probe);
+		
+		start = now();
+		error = hash_join(build, probe, output, column_first_file, column_second_file, budget);
+		fflush(output);
+		elapsed = now() - start;
+		
+		getrusage(RUSAGE_SELF, &usage);
+		rewind(output);
+		while ((nb_read = fread(block, 1, sizeof(block), output)) > 0) for (i = 0; i < nb_read; i++) out_rows += block[i] == '\n';
+		
+		printf("%-16s %12zu %12zu %10.3f %10.2f %10.1f %10.1f %12zu %016llx\n", label, budget, nb_rows, elapsed, nb_rows / elapsed * 1e-6, (build_stat.st_size + probe_stat.st_size) / elapsed * 1e-6, usage.ru_maxrss / 1024.0, out_rows, (unsigned long long) file_checksum(output));
+		fflush(stdout);
+		
+		fclose(build);
+		fclose(probe);
+		fclose(output);
+		_exit(error != 0);
+		
+	}
+	
+	if (waitpid(child, &status, 0) != child || WIFEXITED(status) == 0 || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "La jointure de \"%s\" avec un budget de %zu octets a échoué\n", label, budget);
+		return 1;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Prints the header of the results of bench_join_run
+ */
+void print_join_results_header(void) {
+	
+	printf("%-16s %12s %12s %10s %10s %10s %10s %12s %16s\n", "dataset", "budget", "rows", "seconds", "Mrows/s", "MB/s", "RSS (MB)", "out rows", "checksum");
+	
+}
+
+/**
+ * @brief Joins two files with every budget of a list
+ * 
+ * @param label The name of the dataset in the results
+ * 		  build_name The name of the first file
+ * 		  probe_name The name of the second file
+ * 		  column_first_file The index of the first file's join column
+ * 		  column_second_file The index of the second file's join column
+ * 		  budgets The budgets
+ * 		  nb_budgets The number of budgets
+ */
+int bench_join_budgets(const char* label, const char* build_name, const char* probe_name, size_t column_first_file, size_t column_second_file, const size_t* budgets, size_t nb_budgets) {
+	
+	size_t i;
+	int error = 0;
+	
+	for (i = 0; i < nb_budgets; i++) {
+		error |= bench_join_run(label, build_name, probe_name, column_first_file, column_second_file, budgets[i]);
+	}
+	
+	return error;
+	
+}
+
+/**
+ * @brief Generates the datasets of the suite in a directory, if they
+ * 		  are not there yet, and joins each of them with a matrix of
+ * 		  budgets, from one that needs several levels of partitions to
+ * 		  one that holds the whole first file. The results of two
+ * 		  versions of the join can be compared with diff : the rows,
+ * 		  output rows and checksums must be the same, the throughputs
+ * 		  tell the regressions
+ * 
+ * @param directory The directory of the datasets
+ * 		  scale The number of rows of the first file, the second one
+ * 		  has four times more
+ */
+int bench_suite(const char* directory, size_t scale) {
+	
+	const bench_dataset datasets[] = {
+		{ "uniform", scale, 4 * scale, scale, 0.0, 8, 1.0, 1 },
+		{ "half-match", scale, 4 * scale, scale, 0.0, 8, 0.5, 2 },
+		{ "zipf-1.1", scale, 4 * scale, scale, 1.1, 8, 0.9, 3 },
+		{ "few-keys", scale, 4 * scale, 1000, 0.0, 8, 0.9, 4 },
+		{ "wide", scale / 4, scale, scale / 4, 0.0, 120, 0.9, 5 }
+	};
+	const size_t budgets[] = { (size_t) 1 << 20, (size_t) 16 << 20, (size_t) 256 << 20 };
+	char build_name[4096];
+	char probe_name[4096];
+	struct stat file_stat;
+	size_t d;
+	int error = 0;
+	
+	print_join_results_header();
+	
+	for (d = 0; d < sizeof(datasets) / sizeof(datasets[0]) && error == 0; d++) {
+		
+		snprintf(build_name, sizeof(build_name), "%s/%s-%zu-build.csv", directory, datasets[d].name, scale);
+		snprintf(probe_name, sizeof(probe_name), "%s/%s-%zu-probe.csv", directory, datasets[d].name, scale);
+		
+		/* The files are kept between runs, the generator always gives the same ones */
+		
+		if (stat(build_name, &file_stat) != 0 || stat(probe_name, &file_stat) != 0) {
+			error = generate_dataset(&datasets[d], build_name, probe_name);
+		}
+		
+		if (error == 0) error = bench_join_budgets(datasets[d].name, build_name, probe_name, BENCH_KEY_COLUMN_BUILD, BENCH_KEY_COLUMN_PROBE, budgets, sizeof(budgets) / sizeof(budgets[0]));
+		
+	}
+	
+	return error;
+	
+}
+
+/**
+ * @brief Runs the command line join in a child process, with its
+ * 		  output in a temporary file, and gives the number of rows and
+ * 		  the checksum of that output. The file of one side can be
+ * 		  written by another process in a pipe read as the standard
+ * 		  input, named "-" on the command line. Returns 0 on success
+ * 
+ * @param build_name The name of the first file
+ * 		  probe_name The name of the second file
+ * 		  piped_side 1 or 2 to pipe the first or the second file,
+ * 		  0 to name both
+ * 		  budget The memory budget of the join
+ * 		  out_rows The number of rows of the output, set
+ * 		  checksum The checksum of the output, set
+ */
+int bench_command_line_run(const char* build_name, const char* probe_name, int piped_side, const char* budget, size_t* out_rows, uint64_t* checksum) {
+	
+	FILE* output = tmpfile();
+	char block[BUFSIZ];
+	size_t nb_read = 0;
+	size_t i;
+	pid_t child = 0;
+	int status = 0;
+	
+	if (output == NULL) return 1;
+	
+	fflush(stdout);
+	child = fork();
+	
+	if (child < 0) {
+		fclose(output);
+		return 1;
+	}
+	
+	if (child == 0) {
+		
+		char* arguments[] = { "csv_join", "-k", "0:1", "-m", (char*) budget, (char*) build_name, (char*) probe_name, NULL };
+		FILE* piped = NULL;
+		pid_t writer = 0;
+		int pipe_ends[2];
+		int error = 0;
+		
+		if (dup2(fileno(output), STDOUT_FILENO) < 0) _exit(1);
+		
+		if (piped_side != 0) {
+			
+			piped = fopen(piped_side == 1 ? build_name : probe_name, "r");
+			if (piped == NULL || pipe(pipe_ends) != 0) _exit(1);
+			
+			writer = fork();
+			if (writer < 0) _exit(1);
+			if (writer == 0) {
+				close(pipe_ends[0]);
+				while ((nb_read = fread(block, 1, sizeof(block), piped)) > 0) {
+					if (write(pipe_ends[1], block, nb_read) != (ssize_t) nb_read) _exit(1);
+				}
+				_exit(0);
+			}
+			
+			fclose(piped);
+			close(pipe_ends[1]);
+			if (dup2(pipe_ends[0], STDIN_FILENO) < 0) _exit(1);
+			close(pipe_ends[0]);
+			arguments[piped_side == 1 ? 5 : 6] = "-";
+			
+		}
+		
+		/* A join that stops reading early must not leave the writer blocked on the pipe */
+		
+		error = command_line_join(7, arguments);
+		fflush(stdout);
+		close(STDIN_FILENO);
+		if (writer > 0) waitpid(writer, NULL, 0);
+		_exit(error);
+		
+	}
+	
+	if (waitpid(child, &status, 0) != child || WIFEXITED(status) == 0 || WEXITSTATUS(status) != 0) {
+		fclose(output);
+		return 1;
+	}
+	
+	*out_rows = 0;
+	rewind(output);
+	while ((nb_read = fread(block, 1, sizeof(block), output)) > 0) for (i = 0; i < nb_read; i++) *out_rows += block[i] == '\n';
+	*checksum = file_checksum(output);
+	fclose(output);
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Checks that rows longer than a kilobyte join the same whether
+ * 		  their file is mapped or streamed : a dataset with wide fields
+ * 		  is joined through the command line with both files named,
+ * 		  then with the first and with the second one piped, under a
+ * 		  budget that partitions the first file and one that holds it.
+ * 		  Prints a line per run, and returns 1 if a piped run does not
+ * 		  give the rows of the named one
+ * 
+ * @param directory The directory of the dataset
+ * 		  scale The number of rows of the first file, the second one
+ * 		  has four times more
+ */
+int bench_stream(const char* directory, size_t scale) {
+	
+	const bench_dataset dataset = { "long-rows", scale, 4 * scale, scale, 0.0, 1100, 0.9, 6 };
+	const char* budgets[] = { "1000000", "268435456" };
+	const char* sides[] = { "named", "first piped", "second piped" };
+	char build_name[4096];
+	char probe_name[4096];
+	size_t file_rows = 0;
+	size_t out_rows = 0;
+	uint64_t file_sum = 0;
+	uint64_t checksum = 0;
+	size_t b;
+	int side;
+	int error = 0;
+	
+	snprintf(build_name, sizeof(build_name), "%s/%s-%zu-build.csv", directory, dataset.name, scale);
+	snprintf(probe_name, sizeof(probe_name), "%s/%s-%zu-probe.csv", directory, dataset.name, scale);
+	
+	if (generate_dataset(&dataset, build_name, probe_name) != 0) return 1;
+	
+	printf("%-16s %12s %12s %16s\n", "input", "budget", "out rows", "checksum");
+	
+	for (b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+		for (side = 0; side < 3; side++) {
+			
+			if (bench_command_line_run(build_name, probe_name, side, budgets[b], &out_rows, &checksum) != 0) {
+				fprintf(stderr, "La jointure \"%s\" avec un budget de %s octets a échoué\n", sides[side], budgets[b]);
+				error = 1;
+				continue;
+			}
+			
+			printf("%-16s %12s %12zu %016llx\n", sides[side], budgets[b], out_rows, (unsigned long long) checksum);
+			
+			if (side == 0) {
+				file_rows = out_rows;
+				file_sum = checksum;
+			} else if (out_rows != file_rows || checksum != file_sum) {
+				fprintf(stderr, "La jointure \"%s\" ne donne pas les lignes de la jointure \"%s\"\n", sides[side], sides[0]);
+				error = 1;
+			}
+			
+		}
+	}
+	
+	return error;
+	
+}
+
+int main(int argc, char* argv[]) {
+	
+	const size_t default_budgets[] = { (size_t) 1 << 20, (size_t) 16 << 20, (size_t) 256 << 20 };
+	size_t budgets[64];
+	size_t nb_budgets = 0;
+	bench_dataset dataset = { "generated", 0, 0, SIZE_MAX, 0.0, 8, 1.0, BENCH_DEFAULT_SEED };
+	char build_name[4096];
+	char probe_name[4096];
+	size_t nb_keys = 1000000;
+	
+	if (argc >= 3 && (strcmp(argv[1], "htable") == 0 || strcmp(argv[1], "hash") == 0)) nb_keys = strtoul(argv[2], NULL, 10);
+	
+	if (argc >= 2 && strcmp(argv[1], "htable") == 0 && nb_keys > 0) {
+		return bench_htable(nb_keys);
+	}
+	
+	if (argc >= 2 && strcmp(argv[1], "hash") == 0 && nb_keys > 0) {
+		return bench_hash(argc >= 3 ? nb_keys : 10 * nb_keys);
+	}
+	
+	if (argc >= 3 && strcmp(argv[1], "parse") == 0) {
+		return bench_parse(argv[2]);
+	}
+	
+	if (argc >= 5 && strcmp(argv[1], "generate") == 0) {
+		dataset.build_rows = strtoul(argv[3], NULL, 10);
+		dataset.probe_rows = strtoul(argv[4], NULL, 10);
+		if (argc >= 6) dataset.cardinality = strtoul(argv[5], NULL, 10);
+		if (argc >= 7) dataset.zipf = strtod(argv[6], NULL);
+		if (argc >= 8) dataset.width = strtoul(argv[7], NULL, 10);
+		if (argc >= 9) dataset.match_rate = strtod(argv[8], NULL);
+		if (argc >= 10) dataset.seed = strtoull(argv[9], NULL, 10);
+		snprintf(build_name, sizeof(build_name), "%s-build.csv", argv[2]);
+		snprintf(probe_name, sizeof(probe_name), "%s-probe.csv", argv[2]);
+		return generate_dataset(&dataset, build_name, probe_name);
+	}
+	
+	if (argc >= 6 && strcmp(argv[1], "join") == 0) {
+		for (nb_budgets = 0; nb_budgets < 64 && 6 + (int) nb_budgets < argc; nb_budgets++) {
+			budgets[nb_budgets] = strtoul(argv[6 + nb_budgets], NULL, 10);
+		}
+		if (nb_budgets == 0) {
+			nb_budgets = sizeof(default_budgets) / sizeof(default_budgets[0]);
+			memcpy(budgets, default_budgets, sizeof(default_budgets));
+		}
+		print_join_results_header();
+		return bench_join_budgets(argv[2], argv[2], argv[3], strtoul(argv[4], NULL, 10), strtoul(argv[5], NULL, 10), budgets, nb_budgets);
+	}
+	
+	if (argc >= 2 && strcmp(argv[1], "suite") == 0) {
+		return bench_suite(argc >= 3 ? argv[2] : ".", argc >= 4 ? strtoul(argv[3], NULL, 10) : 500000);
+	}
+	
+	if (argc >= 2 && strcmp(argv[1], "stream") == 0) {
+		return bench_stream(argc >= 3 ? argv[2] : ".", argc >= 4 ? strtoul(argv[3], NULL, 10) : 2000);
+	}
+	
+	fprintf(stderr, "Usage : %s htable [nombre de clés]\n", argv[0]);
+	fprintf(stderr, "        %s parse <fichier CSV>\n", argv[0]);
+	fprintf(stderr, "        %s hash [nombre de clés]\n", argv[0]);
+	fprintf(stderr, "        %s generate <préfixe> <lignes du premier fichier> <lignes du second>\n", argv[0]);
+	fprintf(stderr, "                 [clés distinctes] [exposant de Zipf] [largeur des champs] [taux de correspondance] [graine]\n");
+	fprintf(stderr, "        %s join <premier fichier> <second fichier> <colonne 1> <colonne 2> [budget ...]\n", argv[0]);
+	fprintf(stderr, "        %s suite [répertoire] [lignes du premier fichier]\n", argv[0]);
+	fprintf(stderr, "        %s stream [répertoire] [lignes du premier fichier]\n", argv[0]);
+	return EXIT_FAILURE;
+	
+}
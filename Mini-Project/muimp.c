@@ -1,8 +1,21 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CONVOLUTION_X86
+#endif
 
-#define MAX_IMAGE_HEIGHT 100
-#define MAX_IMAGE_WIDTH 100
+#define IMAGE_ALIGNMENT 64
+#define CONVOLUTION_MAX_SIZE 31
+#define SEPARABLE_MIN_SIZE 5
+#define SEPARABLE_TOLERANCE 1e-12
+#define FLOAT_SEPARABLE_TOLERANCE 1e-6f
 
 /**
  * @brief Definition of type Pixel which is similar to a double value
@@ -10,36 +23,174 @@
 typedef double Pixel;
 
 /**
- * @brief Datastructure for type Image with the height, the width,
- * 		  and a double entry array for the pixels
+ * @brief Datastructure for type Image with the height, the width, the
+ * 		  first pixel of the image and the stride, which is the number
+ * 		  of pixels from the start of a row to the start of the next
+ * 		  one. The rows are stored one after the other on the heap and
+ * 		  each one starts on IMAGE_ALIGNMENT bytes. The block is the
+ * 		  memory allocated for the pixels, NULL for a view on the
+ * 		  pixels of another image
  */
 typedef struct MyImageStruct {
-	Pixel pixelTab[MAX_IMAGE_HEIGHT][MAX_IMAGE_WIDTH];
+	Pixel* pixels;
 	int height;
 	int width;
+	int stride;
+	void* block;
 } Image;
 
+/**
+ * @brief Definition of type FloatPixel, the single precision pixel of
+ * 		  the convolutions on FloatImage
+ */
+typedef float FloatPixel;
+
+/**
+ * @brief Datastructure for type FloatImage, laid out like Image with
+ * 		  single precision pixels
+ */
+typedef struct MyFloatImageStruct {
+	FloatPixel* pixels;
+	int height;
+	int width;
+	int stride;
+	void* block;
+} FloatImage;
+
+/**
+ * @brief Computes the columns first to last - 1 of a row of a
+ * 		  convolved image, for which the kernel does not wrap around
+ * 		  the row. rows[k] is the row of the image met by the row k
+ * 		  of the kernel and taps are the kernel_height * kernel_width
+ * 		  values of the kernel, row after row. The separable
+ * 		  convolutions use kernels of a single row or column
+ */
+typedef void (*convolution_row_function)(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int first, int last, Pixel* convolvedRow);
+typedef void (*float_convolution_row_function)(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int first, int last, FloatPixel* convolvedRow);
+
+/**
+ * @brief Datastructure for a convolution engine, the row functions
+ * 		  for both pixel types with one instruction set, and whether
+ * 		  the processor running the program supports it
+ */
+typedef struct {
+	const char* name;
+	int (*supported)(void);
+	convolution_row_function row;
+	float_convolution_row_function float_row;
+} convolution_engine;
+
 /* Here are the prototypes of the auxiliary functions */
 
-Image diamond(Image img, int diag);
+int allocate_pixels(void** block, int height, int width, size_t pixel_size, int* stride);
+
+int create_image(Image* img, int height, int width);
+
+void destroy_image(Image* img);
+
+int create_float_image(FloatImage* img, int height, int width);
+
+void destroy_float_image(FloatImage* img);
+
+FloatPixel* float_image_row(const FloatImage* img, int i);
+
+int view_image(Image* view, const Image* img, int top, int left, int height, int width);
+
+Pixel* image_row(const Image* img, int i);
+
+int pixels_overlap(const void* first1, const void* end1, const void* first2, const void* end2);
+
+int images_overlap(const Image* img1, const Image* img2);
+
+int float_images_overlap(const FloatImage* img1, const FloatImage* img2);
+
+void clear_image(Image* img);
+
+void diamond(Image* img, int diag);
+
+void display(const Image* img, FILE* flot);
+
+int write_to_file(const char* nom_fichier, const Image* img);
+
+int read_from_file(const char* nom_fichier, Image* img);
+
+void build_mask(Image* mask);
 
-void display(Image img, FILE* flot);
+int engine_always_supported(void);
 
-int write_to_file(char* nom_fichier, Image img);
+void convolution_row_scalar(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int first, int last, Pixel* convolvedRow);
 
-Image read_from_file(char* nom_fichier);
+void float_convolution_row_scalar(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int first, int last, FloatPixel* convolvedRow);
 
-Image filter(Image img, Image mask);
+#ifdef CONVOLUTION_X86
+
+int cpu_has_sse2(void);
+
+int cpu_has_avx2(void);
+
+void convolution_row_sse2(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int first, int last, Pixel* convolvedRow);
+
+void float_convolution_row_sse2(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int first, int last, FloatPixel* convolvedRow);
+
+void convolution_row_avx2(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int first, int last, Pixel* convolvedRow);
+
+void float_convolution_row_avx2(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int first, int last, FloatPixel* convolvedRow);
+
+#endif
+
+const convolution_engine* best_convolution_engine(void);
+
+int wrap_index(int index, int n);
+
+int check_convolution(int height, int width, int kernel_height, int kernel_width, int convolved_height, int convolved_width, int overlap);
+
+Pixel convolution_pixel(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int width, int j);
+
+FloatPixel float_convolution_pixel(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int width, int j);
+
+int convolve(const convolution_engine* engine, const Image* img, const Image* kernel, Image* convolvedImg);
+
+int convolve_float(const convolution_engine* engine, const FloatImage* img, const FloatImage* kernel, FloatImage* convolvedImg);
+
+int separate_kernel(const Image* kernel, Pixel* column, Pixel* row);
+
+int float_separate_kernel(const FloatImage* kernel, FloatPixel* column, FloatPixel* row);
+
+void convolve_line(const convolution_engine* engine, const Pixel* line, const Pixel* taps, int size, int width, Pixel* convolvedLine);
+
+void float_convolve_line(const convolution_engine* engine, const FloatPixel* line, const FloatPixel* taps, int size, int width, FloatPixel* convolvedLine);
+
+int convolve_separable(const convolution_engine* engine, const Image* img, const Pixel* column, const Pixel* row, int size, Image* convolvedImg);
+
+int convolve_separable_float(const convolution_engine* engine, const FloatImage* img, const FloatPixel* column, const FloatPixel* row, int size, FloatImage* convolvedImg);
+
+int filter(const Image* img, const Image* mask, Image* filteredImg);
+
+int filter_float(const FloatImage* img, const FloatImage* mask, FloatImage* filteredImg);
+
+/* Here are the convolution engines, from the slowest to the fastest */
+
+const convolution_engine convolution_engines[] = {
+	{ "scalar", engine_always_supported, convolution_row_scalar, float_convolution_row_scalar },
+#ifdef CONVOLUTION_X86
+	{ "sse2", cpu_has_sse2, convolution_row_sse2, float_convolution_row_sse2 },
+	{ "avx2", cpu_has_avx2, convolution_row_avx2, float_convolution_row_avx2 },
+#endif
+};
+
+#define NB_CONVOLUTION_ENGINES ((int) (sizeof(convolution_engines) / sizeof(convolution_engines[0])))
 
 /* Here is our Main function */
 
 int main (void) {
 	
 	Image img;
-	img.height = 0;
-	img.width = 0;		
-	int diag = -1;
+	Image readImg;
+	Image filteredImg;
 	Image mask;
+	int height = 0;
+	int width = 0;
+	int diag = -1;
 	
 	int k;
 	
@@ -58,24 +209,24 @@ int main (void) {
 	/* We ask the user for the height, the width, and the length of the diagonal */
 	
 	do {
-		printf("Donnez la hauteur de l'image (100 > entier > 0) : ");
+		printf("Donnez la hauteur de l'image (entier > 0) : ");
 		fflush(stdout);
-		k = scanf("%d", &img.height);
+		k = scanf("%d", &height);
 		if (k != 1) {
 			printf("Je vous ai demandé un entier positif !\n");
 			while (!feof(stdin) && !ferror(stdin) && getc(stdin) != '\n');
 		}
-	} while ((img.height <= 0 || img.height >= MAX_IMAGE_HEIGHT) && !feof(stdin) && !ferror(stdin));
+	} while (height <= 0 && !feof(stdin) && !ferror(stdin));
 	
 	do {
-		printf("Donnez la largeur de l'image (100 > entier > 0) : ");
+		printf("Donnez la largeur de l'image (entier > 0) : ");
 		fflush(stdout);
-		k = scanf("%d", &img.width);
+		k = scanf("%d", &width);
 		if (k != 1) {
 			printf("Je vous ai demandé un entier positif !\n");
 			while (!feof(stdin) && !ferror(stdin) && getc(stdin) != '\n');
 		}
-	} while ((img.width <= 0 || img.width >= MAX_IMAGE_WIDTH) && !feof(stdin) && !ferror(stdin));
+	} while (width <= 0 && !feof(stdin) && !ferror(stdin));
 	
 	do {
 		printf("Donnez la diagonale du losange (entier >= 0 et doit être < hauteur de l'image et < largeur de l'image) : "); 
@@ -85,7 +236,7 @@ int main (void) {
 			printf("Je vous ai demandé un entier positif ou nul inférieur à la largeur et inférieur à la hauteur !\n");
 			while (!feof(stdin) && !ferror(stdin) && getc(stdin) != '\n');
 		}
-	} while ((diag < 0 || diag > img.height - 1 || diag > img.width - 1) && !feof(stdin) && !ferror(stdin));
+	} while ((diag < 0 || diag > height - 1 || diag > width - 1) && !feof(stdin) && !ferror(stdin));
 	
 	/* Part 1 */
 	
@@ -93,76 +244,344 @@ int main (void) {
 	printf("Création de l'image via la méthode diamond\n");
 	printf("(si la valeur entrée pour la hauteur, ou la largeur, est paire, elle sera augmentée de 1)\n");
 	printf("...\n");
-	img = diamond(img, diag);
+	if (create_image(&img, height | 1, width | 1) != 0) {
+		return 1;
+	}
+	diamond(&img, diag);
 	printf("Création de l'image terminée !\n");
 	
 	/* Part 2 */
 	
 	printf("\nPartie 2 :\n\n");
 	printf("Affichage de l'image précédemment créée sur la sortie standard via la méthode display :\n\n");
-	display(img, stdout);
+	display(&img, stdout);
 	
 	/* Part 3 */
 	
 	printf("\nPartie 3 :\n\n");
 	printf("Ecriture dans le fichier de la largeur, de la hauteur, et du dessin de l'image, via la méthode write_to_file\n");
 	printf("...\n");
-	if (write_to_file(nom_fichier, img) == 0) {
+	if (write_to_file(nom_fichier, &img) == 0) {
 		printf("Ecriture réussie !\n\n");
 		printf("Lecture du fichier, et affichage du dessin qui y est contenu, via la méthode read_to_file :\n");
 		printf("(si une erreur est détéctée, une image de hauteur 0 et de largeur 0 sera retournée)\n\n");
-		display(read_from_file(nom_fichier), stdout);
+		read_from_file(nom_fichier, &readImg);
+		display(&readImg, stdout);
+		destroy_image(&readImg);
 	}
 	
 	/* Part 4 */
 	
 	printf("\nPartie 4 :\n\n");
 	printf("Affichage de l'image filtrée, avec le masque prédéfini, via la méthode filter :\n\n");
-	display(filter(img, mask), stdout);
+	if (create_image(&mask, 3, 3) != 0 || create_image(&filteredImg, img.height, img.width) != 0) {
+		destroy_image(&mask);
+		destroy_image(&img);
+		return 1;
+	}
+	build_mask(&mask);
+	if (filter(&img, &mask, &filteredImg) == 0) {
+		display(&filteredImg, stdout);
+	}
+	
+	destroy_image(&filteredImg);
+	destroy_image(&mask);
+	destroy_image(&img);
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Allocates the pixels of an image of the given dimensions,
+ * 		  whose pixels are not initialized. Each row is padded up to
+ * 		  a multiple of IMAGE_ALIGNMENT bytes, the number of pixels
+ * 		  from a row to the next one is put in stride. Returns 0, or
+ * 		  1 if the dimensions are invalid or the memory could not be
+ * 		  allocated
+ * 
+ * @param block The memory allocated
+ * 		  height The height
+ * 		  width The width
+ * 		  pixel_size The size of a pixel, which divides IMAGE_ALIGNMENT
+ * 		  stride The stride
+ */
+int allocate_pixels(void** block, int height, int width, size_t pixel_size, int* stride) {
+	
+	int pixels_per_alignment = (int) (IMAGE_ALIGNMENT / pixel_size);
+	
+	*block = NULL;
+	*stride = 0;
+	
+	if (height <= 0 || width <= 0 || width > INT32_MAX - IMAGE_ALIGNMENT) {
+		fprintf(stderr, "Erreur : dimensions de l'image invalides\n");
+		return 1;
+	}
+	
+	/* We round the width up so that every row starts on the alignment */
+	
+	*stride = (width + pixels_per_alignment - 1) & ~(pixels_per_alignment - 1);
+	
+	if ((size_t) height > SIZE_MAX / pixel_size / *stride || posix_memalign(block, IMAGE_ALIGNMENT, (size_t) height * *stride * pixel_size) != 0) {
+		fprintf(stderr, "Erreur : impossible d'allouer une image de hauteur %d et de largeur %d\n", height, width);
+		*block = NULL;
+		*stride = 0;
+		return 1;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Allocates in img an image of the given dimensions, whose
+ * 		  pixels are not initialized, see allocate_pixels. Returns 0,
+ * 		  or 1 and an image of height 0 and of width 0 if the
+ * 		  dimensions are invalid or the memory could not be allocated
+ * 
+ * @param img The image to allocate
+ * 		  height The height
+ * 		  width The width
+ */
+int create_image(Image* img, int height, int width) {
+	
+	img->pixels = NULL;
+	img->height = 0;
+	img->width = 0;
+	img->stride = 0;
+	img->block = NULL;
+	
+	if (allocate_pixels(&img->block, height, width, sizeof(Pixel), &img->stride) != 0) {
+		return 1;
+	}
+	
+	img->pixels = img->block;
+	img->height = height;
+	img->width = width;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Frees the pixels of an image created by create_image, and
+ * 		  leaves it with a height of 0 and a width of 0. The pixels
+ * 		  of a view belong to another image and are not freed
+ * 
+ * @param img The image
+ */
+void destroy_image(Image* img) {
+	
+	free(img->block);
+	img->block = NULL;
+	img->pixels = NULL;
+	img->height = 0;
+	img->width = 0;
+	img->stride = 0;
+	
+}
+
+/**
+ * @brief Allocates in img a single precision image, see create_image
+ * 
+ * @param img The image to allocate
+ * 		  height The height
+ * 		  width The width
+ */
+int create_float_image(FloatImage* img, int height, int width) {
+	
+	img->pixels = NULL;
+	img->height = 0;
+	img->width = 0;
+	img->stride = 0;
+	img->block = NULL;
+	
+	if (allocate_pixels(&img->block, height, width, sizeof(FloatPixel), &img->stride) != 0) {
+		return 1;
+	}
+	
+	img->pixels = img->block;
+	img->height = height;
+	img->width = width;
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Frees the pixels of a single precision image, see
+ * 		  destroy_image
+ * 
+ * @param img The image
+ */
+void destroy_float_image(FloatImage* img) {
+	
+	free(img->block);
+	img->block = NULL;
+	img->pixels = NULL;
+	img->height = 0;
+	img->width = 0;
+	img->stride = 0;
+	
+}
+
+/**
+ * @brief Returns the first pixel of a row of a single precision image
+ * 
+ * @param img The image
+ * 		  i The row
+ */
+FloatPixel* float_image_row(const FloatImage* img, int i) {
+	
+	return img->pixels + (size_t) i * img->stride;
+	
+}
+
+/**
+ * @brief Makes view a view on a rectangle of an image : it shares
+ * 		  the pixels and the stride of the image, so that nothing is
+ * 		  copied and what is written in the view is written in the
+ * 		  image. Returns 0, or 1 and an image of height 0 and of
+ * 		  width 0 if the rectangle is not inside the image
+ * 
+ * @param view The view
+ * 		  img The image
+ * 		  top The row of the top left pixel of the rectangle
+ * 		  left The column of the top left pixel of the rectangle
+ * 		  height The height of the rectangle
+ * 		  width The width of the rectangle
+ */
+int view_image(Image* view, const Image* img, int top, int left, int height, int width) {
+	
+	if (top < 0 || left < 0 || height <= 0 || width <= 0 || top > img->height - height || left > img->width - width) {
+		fprintf(stderr, "Erreur : le rectangle de la vue n'est pas dans l'image\n");
+		view->pixels = NULL;
+		view->height = 0;
+		view->width = 0;
+		view->stride = 0;
+		view->block = NULL;
+		return 1;
+	}
+	
+	view->pixels = image_row(img, top) + left;
+	view->height = height;
+	view->width = width;
+	view->stride = img->stride;
+	view->block = NULL;
 	
 	return 0;
 	
 }
 
 /**
- * @brief Gives a value to each pixel of the image 
- * 		  to design a diamond form
+ * @brief Returns the first pixel of a row of the image
+ * 
+ * @param img The image
+ * 		  i The row
+ */
+Pixel* image_row(const Image* img, int i) {
+	
+	return img->pixels + (size_t) i * img->stride;
+	
+}
+
+/**
+ * @brief Returns 1 if the two ranges of memory, from their first
+ * 		  byte to just after their last one, overlap, and 0 otherwise
+ * 
+ * @param first1 The start of the first range
+ * 		  end1 The end of the first range
+ * 		  first2 The start of the second range
+ * 		  end2 The end of the second range
+ */
+int pixels_overlap(const void* first1, const void* end1, const void* first2, const void* end2) {
+	
+	return (uintptr_t) first1 < (uintptr_t) end2 && (uintptr_t) first2 < (uintptr_t) end1;
+	
+}
+
+/**
+ * @brief Returns 1 if the two images share some pixels, as an image
+ * 		  and a view on it, and 0 otherwise
+ * 
+ * @param img1 The first image
+ * 		  img2 The second image
+ */
+int images_overlap(const Image* img1, const Image* img2) {
+	
+	if (img1->height == 0 || img2->height == 0) {
+		return 0;
+	}
+	
+	/* We compare the ranges of addresses from the first pixel to the last one */
+	
+	return pixels_overlap(img1->pixels, image_row(img1, img1->height - 1) + img1->width, img2->pixels, image_row(img2, img2->height - 1) + img2->width);
+	
+}
+
+/**
+ * @brief Returns 1 if the two single precision images share some
+ * 		  pixels, and 0 otherwise
+ * 
+ * @param img1 The first image
+ * 		  img2 The second image
+ */
+int float_images_overlap(const FloatImage* img1, const FloatImage* img2) {
+	
+	if (img1->height == 0 || img2->height == 0) {
+		return 0;
+	}
+	
+	return pixels_overlap(img1->pixels, float_image_row(img1, img1->height - 1) + img1->width, img2->pixels, float_image_row(img2, img2->height - 1) + img2->width);
+	
+}
+
+/**
+ * @brief Sets all the pixels of the image to 0.0
  * 
  * @param img The image
- * 		  diag The diagonal
  */
-Image diamond(Image img, int diag) {
+void clear_image(Image* img) {
 	
 	int i;
-	int j;
 	
-	/* We make sure that the width and the height are odd */
+	for (i = 0; i < img->height; i++) {
+		memset(image_row(img, i), 0, img->width * sizeof(Pixel));
+	}
+	
+}
+
+/**
+ * @brief Gives a value to each pixel of the image, in place, to
+ * 		  design a diamond form centered on it. The height and the
+ * 		  width of the image should be odd
+ * 
+ * @param img The image
+ * 		  diag The diagonal, smaller than the height and the width
+ */
+void diamond(Image* img, int diag) {
 	
-	img.height |= 1;
-	img.width |= 1;
+	Pixel* row;
+	int i;
+	int j;
 	
 	/* We first set all the pixels to 0.0 to get like a blank page */
 	
-	for (i = 0; i < img.height; i++) {
-		for (j = 0; j < img.width; j++) {
-			img.pixelTab[i][j] = 0.0;
-		}
-	}
+	clear_image(img);
 	
 	/* We then set to 1.0 the pixels of the diamond symmetrically to reduce the number of iterations */
 	
-	for (i = (img.width/2) - (diag/2); i <= (img.width/2) + (diag/2); i++) {
-		img.pixelTab[img.height/2][i] = 1.0;
+	row = image_row(img, img->height/2);
+	for (i = (img->width/2) - (diag/2); i <= (img->width/2) + (diag/2); i++) {
+		row[i] = 1.0;
 	}
-	for (i = (img.height/2) + 1; i <= (img.height/2) + (diag/2); i++) {
-		for (j = (img.width/2) - (diag/2) + (i - (img.height/2)); j <= (img.width/2) + (diag/2) - (i - (img.height/2)); j++) {
-			img.pixelTab[i][j] = 1.0;
-			img.pixelTab[(img.height - 1) - i][j] = 1.0;
+	for (i = (img->height/2) + 1; i <= (img->height/2) + (diag/2); i++) {
+		for (j = (img->width/2) - (diag/2) + (i - (img->height/2)); j <= (img->width/2) + (diag/2) - (i - (img->height/2)); j++) {
+			image_row(img, i)[j] = 1.0;
+			image_row(img, (img->height - 1) - i)[j] = 1.0;
 		}
 	}
 	
-	return img;
-	
 }
 
 /**
@@ -171,24 +590,26 @@ Image diamond(Image img, int diag) {
  * @param img The image
  * 		  flot The flot
  */
-void display(Image img, FILE* flot) {
+void display(const Image* img, FILE* flot) {
 	
+	const Pixel* row;
 	int i;
 	int j;
 	
 	/* We put in the flot the associated symbol of the analyzed pixel */
 	
-	for (i = 0; i < img.height; i++) {
-		for (j = 0; j < img.width; j++) {
-			if (img.pixelTab[i][j] == 0.0) {
-				fputs(".", flot);
-			} else if (img.pixelTab[i][j] == 1.0) {
-				fputs("+", flot);
+	for (i = 0; i < img->height; i++) {
+		row = image_row(img, i);
+		for (j = 0; j < img->width; j++) {
+			if (row[j] == 0.0) {
+				putc('.', flot);
+			} else if (row[j] == 1.0) {
+				putc('+', flot);
 			} else {
-				fputs("*", flot);
+				putc('*', flot);
 			}	
 		}
-		fputs("\n", flot);
+		putc('\n', flot);
 	}
 	
 }
@@ -200,7 +621,7 @@ void display(Image img, FILE* flot) {
  * @param nom_fichier The file
  * 		  img The image
  */
-int write_to_file(char* nom_fichier, Image img) {
+int write_to_file(const char* nom_fichier, const Image* img) {
 	
 	FILE* myFile = NULL;
 	
@@ -212,7 +633,7 @@ int write_to_file(char* nom_fichier, Image img) {
 			fprintf(stderr, "Erreur : impossible d'écrire dans le fichier %s\n", nom_fichier);
 			return 1;
 		} else {
-			fprintf(myFile, "Largeur : %d\nLongueur : %d\n", img.width, img.height);
+			fprintf(myFile, "Largeur : %d\nLongueur : %d\n", img->width, img->height);
 			display(img, myFile);
 			fclose(myFile);
 		}
@@ -224,15 +645,24 @@ int write_to_file(char* nom_fichier, Image img) {
 
 /**
  * @brief Reads the image and its dimensions from the given 
- * 		  file and returns it
+ * 		  file and creates it in img. Returns 0, or 1 and an
+ * 		  image of height 0 and of width 0 if an error occurs
  * 
  * @param nom_fichier The file
+ * 		  img The image to create
  */
-Image read_from_file(char* nom_fichier) {
+int read_from_file(const char* nom_fichier, Image* img) {
 	
-	Image img;
 	FILE* myFile = NULL;
-	char c;
+	int height;
+	int width;
+	int c;
+	
+	img->pixels = NULL;
+	img->height = 0;
+	img->width = 0;
+	img->stride = 0;
+	img->block = NULL;
 	
 	/* We open the file, check for errors, and build the image */
 	
@@ -241,124 +671,951 @@ Image read_from_file(char* nom_fichier) {
 	if (myFile == NULL) {
 		
 		fprintf(stderr, "Erreur : impossible de lire le fichier %s\n", nom_fichier);
-		img.width = 0;
-		img.height = 0;
-		return img;
+		return 1;
 		
 	} else {
 		
-		if (fscanf(myFile, "Largeur : %d\n", &img.width) != 1) {
+		if (fscanf(myFile, "Largeur : %d\n", &width) != 1) {
 			fprintf(stderr, "Erreur : impossible de lire la valeur de la largeur de l'image\n");
-			img.width = 0;
-			img.height = 0;
-			return img;
-		}
-		if (img.width > MAX_IMAGE_WIDTH) {
-			fprintf(stderr, "Erreur : valeur de la largeur trop élevée\n");
-			img.width = 0;
-			img.height = 0;
-			return img;
+			fclose(myFile);
+			return 1;
 		}
-		if (fscanf(myFile, "Longueur : %d\n", &img.height) != 1) {
+		if (fscanf(myFile, "Longueur : %d\n", &height) != 1) {
 			fprintf(stderr, "Erreur : impossible de lire la valeur de la hauteur de l'image\n");
-			img.width = 0;
-			img.height = 0;
-			return img;
+			fclose(myFile);
+			return 1;
 		}
-		if (img.height > MAX_IMAGE_HEIGHT) {
-			fprintf(stderr, "Erreur : valeur de la hauteur trop élevée\n");
-			img.width = 0;
-			img.height = 0;
-			return img;
+		
+		if (create_image(img, height, width) != 0) {
+			fclose(myFile);
+			return 1;
 		}
 		
+		/* The pixels missing from the file are left to 0.0 */
+		
+		clear_image(img);
+		
 		/* We decided to associate the value 2.0 to '*' symbols */
 		
 		int i = 0;
 		int j = 0;
 		while((c = fgetc(myFile)) != EOF){
-			if (c == '.') {
-				img.pixelTab[i][j] = 0.0;
+			if ((c == '.' || c == '+' || c == '*') && (i >= img->height || j >= img->width)) {
+				fprintf(stderr, "Erreur : le dessin dépasse les dimensions de l'image\n");
+				destroy_image(img);
+				fclose(myFile);
+				return 1;
+			} else if (c == '.') {
+				image_row(img, i)[j] = 0.0;
 				j += 1;
 			} else if (c == '+') {
-				img.pixelTab[i][j] = 1.0;
+				image_row(img, i)[j] = 1.0;
 				j += 1;
 			} else if (c == '*') {
-				img.pixelTab[i][j] = 2.0;
+				image_row(img, i)[j] = 2.0;
 				j += 1;
 			} else if (c == '\n') {
 				i += 1;
 				j = 0;
 			} else {
 				fprintf(stderr, "Erreur : impossible de lire toute l'image car le symbole %c ne correspond pas à un pixel\n", c);
-				img.width = 0;
-				img.height = 0;
-				return img;
+				destroy_image(img);
+				fclose(myFile);
+				return 1;
 			}
 		}
 		
 		fclose(myFile);
-		return img;
+		return 0;
 		
 	}
 	
 }
 
 /**
- * @brief Returns a filtered image from a given image
- * 		  on which we apply a given mask
+ * @brief Gives to the pixels of the mask, of height 3 and of
+ * 		  width 3, the values of the predefined mask
  * 
- * @param img The image
- * 		  mask The mask
+ * @param mask The mask
  */
-Image filter(Image img, Image mask) {
-	
-	Image filteredImg;
+void build_mask(Image* mask) {
 	
 	int i;
 	int j;
+	
+	for (i = 0; i < mask->height; i++) {
+		for (j = 0; j < mask->width; j++) {
+			image_row(mask, i)[j] = -2.0 + 2.0*i;
+		}
+	}
+	
+}
+
+/**
+ * @brief Returns 1, the scalar engine runs on every processor
+ */
+int engine_always_supported(void) {
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Computes the columns first to last - 1 of a row of a
+ * 		  convolved image one pixel at a time, see
+ * 		  convolution_row_function
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  first The first column
+ * 		  last The column after the last one
+ * 		  convolvedRow The row of the convolved image
+ */
+void convolution_row_scalar(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int first, int last, Pixel* convolvedRow) {
+	
+	Pixel sum;
+	int half = kernel_width / 2;
+	int j;
+	int k;
+	int l;
+	
+	for (j = first; j < last; j++) {
+		sum = 0.0;
+		for (k = 0; k < kernel_height; k++) {
+			for (l = 0; l < kernel_width; l++) {
+				sum += rows[k][j + half - l] * taps[k * kernel_width + l];
+			}
+		}
+		convolvedRow[j] = sum;
+	}
+	
+}
+
+/**
+ * @brief Computes the columns first to last - 1 of a row of a single
+ * 		  precision convolved image one pixel at a time, see
+ * 		  convolution_row_scalar
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  first The first column
+ * 		  last The column after the last one
+ * 		  convolvedRow The row of the convolved image
+ */
+void float_convolution_row_scalar(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int first, int last, FloatPixel* convolvedRow) {
+	
+	FloatPixel sum;
+	int half = kernel_width / 2;
+	int j;
 	int k;
 	int l;
 	
-	/* We build the mask */
-	
-	mask.height = 3;
-	mask.width = 3;
-	for (i = 0; i < mask.height; i++) {
-		for (j = 0; j < mask.width; j++) {
-			mask.pixelTab[i][j] = -2.0 + 2.0*i;
-		}
-	}
-	
-	/* We set the height and the width of the filtered image */
-	
-	filteredImg.height = img.height;
-	filteredImg.width = img.width;
-	
-	/* We do the computation with the given formula */
-	
-	for (i = 0; i < img.height; i++) {
-		for (j = 0; j < img.width; j++) {
-			for (k = 0; k < mask.height; k++) {
-				for (l = 0; l < mask.width; l++) {
-					
-					/* For the negative index values, because applying on them the operator % in C doesn't give the wanted result, our computation will be a bit different */
-					
-					if ((i + (3/2) - k) < 0 && (j + (3/2) - l) >= 0) {
-						filteredImg.pixelTab[i][j] += img.pixelTab[(i + (3/2) - k + img.height)%img.height][(j + (3/2) - l)%img.width] * mask.pixelTab[k][l];
-					} else if ((i + (3/2) - k) >= 0 && (j + (3/2) - l) < 0) {
-						filteredImg.pixelTab[i][j] += img.pixelTab[(i + (3/2) - k)%img.height][(j + (3/2) - l + img.width)%img.width] * mask.pixelTab[k][l];
-					} else if ((i + (3/2) - k) < 0 && (j + (3/2) - l) < 0) {
-						filteredImg.pixelTab[i][j] += img.pixelTab[(i + (3/2) - k + img.height)%img.height][(j + (3/2) - l + img.width)%img.width] * mask.pixelTab[k][l];
-					} else {
-						filteredImg.pixelTab[i][j] += img.pixelTab[(i + (3/2) - k)%img.height][(j + (3/2) - l)%img.width] * mask.pixelTab[k][l];
-					}
-					
-				}
+	for (j = first; j < last; j++) {
+		sum = 0.0f;
+		for (k = 0; k < kernel_height; k++) {
+			for (l = 0; l < kernel_width; l++) {
+				sum += rows[k][j + half - l] * taps[k * kernel_width + l];
 			}
 		}
+		convolvedRow[j] = sum;
+	}
+	
+}
+
+#ifdef CONVOLUTION_X86
+
+/**
+ * @brief Returns 1 if the processor supports SSE2, and 0 otherwise
+ */
+int cpu_has_sse2(void) {
+	
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2") != 0;
+	
+}
+
+/**
+ * @brief Returns 1 if the processor supports AVX2, and 0 otherwise
+ */
+int cpu_has_avx2(void) {
+	
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+	
+}
+
+/**
+ * @brief Computes the columns first to last - 1 of a row of a
+ * 		  convolved image with SSE2, see convolution_row_scalar. Four
+ * 		  pixels are computed at once, in two vectors of two, each
+ * 		  tap being multiplied then added in the order of the scalar
+ * 		  engine so that the results are the same. The remaining
+ * 		  pixels are left to the scalar engine
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  first The first column
+ * 		  last The column after the last one
+ * 		  convolvedRow The row of the convolved image
+ */
+__attribute__((target("sse2")))
+void convolution_row_sse2(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int first, int last, Pixel* convolvedRow) {
+	
+	const Pixel* row;
+	__m128d tap;
+	__m128d sum0;
+	__m128d sum1;
+	int half = kernel_width / 2;
+	int j = first;
+	int k;
+	int l;
+	
+	for (; j + 4 <= last; j += 4) {
+		sum0 = _mm_setzero_pd();
+		sum1 = _mm_setzero_pd();
+		for (k = 0; k < kernel_height; k++) {
+			row = rows[k] + j + half;
+			for (l = 0; l < kernel_width; l++) {
+				tap = _mm_set1_pd(taps[k * kernel_width + l]);
+				sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(row - l), tap));
+				sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(row - l + 2), tap));
+			}
+		}
+		_mm_storeu_pd(convolvedRow + j, sum0);
+		_mm_storeu_pd(convolvedRow + j + 2, sum1);
+	}
+	
+	convolution_row_scalar(rows, taps, kernel_height, kernel_width, j, last, convolvedRow);
+	
+}
+
+/**
+ * @brief Computes the columns first to last - 1 of a row of a single
+ * 		  precision convolved image with SSE2, eight pixels at once,
+ * 		  see convolution_row_sse2
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  first The first column
+ * 		  last The column after the last one
+ * 		  convolvedRow The row of the convolved image
+ */
+__attribute__((target("sse2")))
+void float_convolution_row_sse2(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int first, int last, FloatPixel* convolvedRow) {
+	
+	const FloatPixel* row;
+	__m128 tap;
+	__m128 sum0;
+	__m128 sum1;
+	int half = kernel_width / 2;
+	int j = first;
+	int k;
+	int l;
+	
+	for (; j + 8 <= last; j += 8) {
+		sum0 = _mm_setzero_ps();
+		sum1 = _mm_setzero_ps();
+		for (k = 0; k < kernel_height; k++) {
+			row = rows[k] + j + half;
+			for (l = 0; l < kernel_width; l++) {
+				tap = _mm_set1_ps(taps[k * kernel_width + l]);
+				sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(row - l), tap));
+				sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(row - l + 4), tap));
+			}
+		}
+		_mm_storeu_ps(convolvedRow + j, sum0);
+		_mm_storeu_ps(convolvedRow + j + 4, sum1);
+	}
+	
+	float_convolution_row_scalar(rows, taps, kernel_height, kernel_width, j, last, convolvedRow);
+	
+}
+
+/**
+ * @brief Computes the columns first to last - 1 of a row of a
+ * 		  convolved image with AVX2, eight pixels at once in two
+ * 		  vectors of four, see convolution_row_sse2. The taps are not
+ * 		  fused in a single multiply-add, which would round them
+ * 		  differently from the other engines
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  first The first column
+ * 		  last The column after the last one
+ * 		  convolvedRow The row of the convolved image
+ */
+__attribute__((target("avx2")))
+void convolution_row_avx2(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int first, int last, Pixel* convolvedRow) {
+	
+	const Pixel* row;
+	__m256d tap;
+	__m256d sum0;
+	__m256d sum1;
+	int half = kernel_width / 2;
+	int j = first;
+	int k;
+	int l;
+	
+	for (; j + 8 <= last; j += 8) {
+		sum0 = _mm256_setzero_pd();
+		sum1 = _mm256_setzero_pd();
+		for (k = 0; k < kernel_height; k++) {
+			row = rows[k] + j + half;
+			for (l = 0; l < kernel_width; l++) {
+				tap = _mm256_set1_pd(taps[k * kernel_width + l]);
+				sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(row - l), tap));
+				sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(row - l + 4), tap));
+			}
+		}
+		_mm256_storeu_pd(convolvedRow + j, sum0);
+		_mm256_storeu_pd(convolvedRow + j + 4, sum1);
+	}
+	
+	convolution_row_sse2(rows, taps, kernel_height, kernel_width, j, last, convolvedRow);
+	
+}
+
+/**
+ * @brief Computes the columns first to last - 1 of a row of a single
+ * 		  precision convolved image with AVX2, sixteen pixels at
+ * 		  once, see convolution_row_avx2
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  first The first column
+ * 		  last The column after the last one
+ * 		  convolvedRow The row of the convolved image
+ */
+__attribute__((target("avx2")))
+void float_convolution_row_avx2(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int first, int last, FloatPixel* convolvedRow) {
+	
+	const FloatPixel* row;
+	__m256 tap;
+	__m256 sum0;
+	__m256 sum1;
+	int half = kernel_width / 2;
+	int j = first;
+	int k;
+	int l;
+	
+	for (; j + 16 <= last; j += 16) {
+		sum0 = _mm256_setzero_ps();
+		sum1 = _mm256_setzero_ps();
+		for (k = 0; k < kernel_height; k++) {
+			row = rows[k] + j + half;
+			for (l = 0; l < kernel_width; l++) {
+				tap = _mm256_set1_ps(taps[k * kernel_width + l]);
+				sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(row - l), tap));
+				sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(row - l + 8), tap));
+			}
+		}
+		_mm256_storeu_ps(convolvedRow + j, sum0);
+		_mm256_storeu_ps(convolvedRow + j + 8, sum1);
+	}
+	
+	float_convolution_row_sse2(rows, taps, kernel_height, kernel_width, j, last, convolvedRow);
+	
+}
+
+#endif
+
+/**
+ * @brief Returns the fastest convolution engine supported by the
+ * 		  processor, which is looked for only once
+ */
+const convolution_engine* best_convolution_engine(void) {
+	
+	static const convolution_engine* best = NULL;
+	int e;
+	
+	if (best == NULL) {
+		for (e = NB_CONVOLUTION_ENGINES - 1; e > 0 && !convolution_engines[e].supported(); e--);
+		best = &convolution_engines[e];
+	}
+	
+	return best;
+	
+}
+
+/**
+ * @brief Returns the index in [0, n) equal to index modulo n, also
+ * 		  for the negative indexes
+ * 
+ * @param index The index
+ * 		  n The number of indexes
+ */
+int wrap_index(int index, int n) {
+	
+	index %= n;
+	return (index < 0) ? index + n : index;
+	
+}
+
+/**
+ * @brief Checks the dimensions of a convolution : the kernel must be
+ * 		  square, of odd size at most CONVOLUTION_MAX_SIZE, and the
+ * 		  convolved image must have the dimensions of the image and
+ * 		  not overlap it. Returns 0, or 1 and prints the error
+ * 
+ * @param height The height of the image
+ * 		  width The width of the image
+ * 		  kernel_height The height of the kernel
+ * 		  kernel_width The width of the kernel
+ * 		  convolved_height The height of the convolved image
+ * 		  convolved_width The width of the convolved image
+ * 		  overlap Whether the convolved image shares pixels with the image or the kernel
+ */
+int check_convolution(int height, int width, int kernel_height, int kernel_width, int convolved_height, int convolved_width, int overlap) {
+	
+	if (kernel_height != kernel_width || kernel_height % 2 == 0 || kernel_height > CONVOLUTION_MAX_SIZE) {
+		fprintf(stderr, "Erreur : le masque doit être carré, de taille impaire et au plus %d\n", CONVOLUTION_MAX_SIZE);
+		return 1;
+	}
+	if (convolved_height != height || convolved_width != width) {
+		fprintf(stderr, "Erreur : l'image filtrée doit avoir les dimensions de l'image\n");
+		return 1;
+	}
+	if (overlap) {
+		fprintf(stderr, "Erreur : l'image filtrée ne doit pas partager ses pixels avec l'image ou le masque\n");
+		return 1;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Returns the pixel j of a row of a convolved image, the
+ * 		  columns wrapping around the row, with the sums done in the
+ * 		  order of the engines
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  width The width of the rows
+ * 		  j The column
+ */
+Pixel convolution_pixel(const Pixel* const rows[], const Pixel* taps, int kernel_height, int kernel_width, int width, int j) {
+	
+	Pixel sum = 0.0;
+	int half = kernel_width / 2;
+	int k;
+	int l;
+	
+	for (k = 0; k < kernel_height; k++) {
+		for (l = 0; l < kernel_width; l++) {
+			sum += rows[k][wrap_index(j + half - l, width)] * taps[k * kernel_width + l];
+		}
+	}
+	
+	return sum;
+	
+}
+
+/**
+ * @brief Returns the pixel j of a row of a single precision convolved
+ * 		  image, see convolution_pixel
+ * 
+ * @param rows The rows of the image met by the rows of the kernel
+ * 		  taps The values of the kernel
+ * 		  kernel_height The height of the kernel, odd
+ * 		  kernel_width The width of the kernel, odd
+ * 		  width The width of the rows
+ * 		  j The column
+ */
+FloatPixel float_convolution_pixel(const FloatPixel* const rows[], const FloatPixel* taps, int kernel_height, int kernel_width, int width, int j) {
+	
+	FloatPixel sum = 0.0f;
+	int half = kernel_width / 2;
+	int k;
+	int l;
+	
+	for (k = 0; k < kernel_height; k++) {
+		for (l = 0; l < kernel_width; l++) {
+			sum += rows[k][wrap_index(j + half - l, width)] * taps[k * kernel_width + l];
+		}
+	}
+	
+	return sum;
+	
+}
+
+/**
+ * @brief Writes in convolvedImg the image convolved with the kernel,
+ * 		  the image wrapping around its borders : the pixel (i, j)
+ * 		  is the sum of the pixels (i + size/2 - k, j + size/2 - l)
+ * 		  times the values (k, l) of the kernel, in this order. Each
+ * 		  row is computed by the engine where the kernel does not
+ * 		  wrap around it, and pixel by pixel on its borders. Returns
+ * 		  0, or 1 if one of the images does not fit
+ * 
+ * @param engine The engine, NULL for the fastest one of the processor
+ * 		  img The image
+ * 		  kernel The kernel, square and of odd size
+ * 		  convolvedImg The convolved image
+ */
+int convolve(const convolution_engine* engine, const Image* img, const Image* kernel, Image* convolvedImg) {
+	
+	const Pixel* rows[CONVOLUTION_MAX_SIZE];
+	Pixel taps[CONVOLUTION_MAX_SIZE * CONVOLUTION_MAX_SIZE];
+	Pixel* convolvedRow;
+	int size = kernel->height;
+	int half = size / 2;
+	int i;
+	int j;
+	int k;
+	int l;
+	
+	if (check_convolution(img->height, img->width, kernel->height, kernel->width, convolvedImg->height, convolvedImg->width, images_overlap(img, convolvedImg) || images_overlap(kernel, convolvedImg)) != 0) {
+		return 1;
+	}
+	if (engine == NULL) {
+		engine = best_convolution_engine();
+	}
+	
+	for (k = 0; k < size; k++) {
+		for (l = 0; l < size; l++) {
+			taps[k * size + l] = image_row(kernel, k)[l];
+		}
+	}
+	
+	for (i = 0; i < img->height; i++) {
+		
+		/* The row k of the kernel meets the row i + size/2 - k of the image, which wraps around it */
+		
+		for (k = 0; k < size; k++) {
+			rows[k] = image_row(img, wrap_index(i + half - k, img->height));
+		}
+		convolvedRow = image_row(convolvedImg, i);
+		
+		if (img->width - half > half) {
+			engine->row(rows, taps, size, size, half, img->width - half, convolvedRow);
+		}
+		
+		/* On the borders, the columns wrap around the row */
+		
+		for (j = 0; j < half && j < img->width; j++) {
+			convolvedRow[j] = convolution_pixel(rows, taps, size, size, img->width, j);
+		}
+		for (j = (img->width - half > half) ? img->width - half : half; j < img->width; j++) {
+			convolvedRow[j] = convolution_pixel(rows, taps, size, size, img->width, j);
+		}
+		
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Writes in convolvedImg the single precision image convolved
+ * 		  with the kernel, see convolve
+ * 
+ * @param engine The engine, NULL for the fastest one of the processor
+ * 		  img The image
+ * 		  kernel The kernel, square and of odd size
+ * 		  convolvedImg The convolved image
+ */
+int convolve_float(const convolution_engine* engine, const FloatImage* img, const FloatImage* kernel, FloatImage* convolvedImg) {
+	
+	const FloatPixel* rows[CONVOLUTION_MAX_SIZE];
+	FloatPixel taps[CONVOLUTION_MAX_SIZE * CONVOLUTION_MAX_SIZE];
+	FloatPixel* convolvedRow;
+	int size = kernel->height;
+	int half = size / 2;
+	int i;
+	int j;
+	int k;
+	int l;
+	
+	if (check_convolution(img->height, img->width, kernel->height, kernel->width, convolvedImg->height, convolvedImg->width, float_images_overlap(img, convolvedImg) || float_images_overlap(kernel, convolvedImg)) != 0) {
+		return 1;
+	}
+	if (engine == NULL) {
+		engine = best_convolution_engine();
+	}
+	
+	for (k = 0; k < size; k++) {
+		for (l = 0; l < size; l++) {
+			taps[k * size + l] = float_image_row(kernel, k)[l];
+		}
+	}
+	
+	for (i = 0; i < img->height; i++) {
+		for (k = 0; k < size; k++) {
+			rows[k] = float_image_row(img, wrap_index(i + half - k, img->height));
+		}
+		convolvedRow = float_image_row(convolvedImg, i);
+		
+		if (img->width - half > half) {
+			engine->float_row(rows, taps, size, size, half, img->width - half, convolvedRow);
+		}
+		for (j = 0; j < half && j < img->width; j++) {
+			convolvedRow[j] = float_convolution_pixel(rows, taps, size, size, img->width, j);
+		}
+		for (j = (img->width - half > half) ? img->width - half : half; j < img->width; j++) {
+			convolvedRow[j] = float_convolution_pixel(rows, taps, size, size, img->width, j);
+		}
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Looks whether the kernel is separable, that is the outer
+ * 		  product of a column and a row : the value (k, l) is
+ * 		  column[k] * row[l], up to SEPARABLE_TOLERANCE times the
+ * 		  largest value. The row is taken through the largest value,
+ * 		  divided by it, and the column is the column of the largest
+ * 		  value. Returns 1 and fills column and row if the kernel is
+ * 		  square, of odd size at most CONVOLUTION_MAX_SIZE and
+ * 		  separable, and 0 otherwise
+ * 
+ * @param kernel The kernel
+ * 		  column The column, of the size of the kernel
+ * 		  row The row, of the size of the kernel
+ */
+int separate_kernel(const Image* kernel, Pixel* column, Pixel* row) {
+	
+	Pixel largest = 0.0;
+	Pixel difference;
+	int size = kernel->height;
+	int p = 0;
+	int q = 0;
+	int k;
+	int l;
+	
+	if (kernel->width != size || size % 2 == 0 || size > CONVOLUTION_MAX_SIZE) {
+		return 0;
+	}
+	
+	for (k = 0; k < size; k++) {
+		for (l = 0; l < size; l++) {
+			if (fabs(image_row(kernel, k)[l]) > largest) {
+				largest = fabs(image_row(kernel, k)[l]);
+				p = k;
+				q = l;
+			}
+		}
+	}
+	
+	for (k = 0; k < size; k++) {
+		column[k] = image_row(kernel, k)[q];
+		row[k] = (largest == 0.0) ? 0.0 : image_row(kernel, p)[k] / image_row(kernel, p)[q];
+	}
+	
+	/* The kernel is rebuilt from the column and the row, and must not move away from it */
+	
+	for (k = 0; k < size; k++) {
+		for (l = 0; l < size; l++) {
+			difference = fabs(image_row(kernel, k)[l] - column[k] * row[l]);
+			if (!(difference <= SEPARABLE_TOLERANCE * largest)) {
+				return 0;
+			}
+		}
+	}
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Looks whether the single precision kernel is separable, up to
+ * 		  FLOAT_SEPARABLE_TOLERANCE times the largest value, see
+ * 		  separate_kernel
+ * 
+ * @param kernel The kernel
+ * 		  column The column, of the size of the kernel
+ * 		  row The row, of the size of the kernel
+ */
+int float_separate_kernel(const FloatImage* kernel, FloatPixel* column, FloatPixel* row) {
+	
+	FloatPixel largest = 0.0f;
+	FloatPixel difference;
+	int size = kernel->height;
+	int p = 0;
+	int q = 0;
+	int k;
+	int l;
+	
+	if (kernel->width != size || size % 2 == 0 || size > CONVOLUTION_MAX_SIZE) {
+		return 0;
+	}
+	
+	for (k = 0; k < size; k++) {
+		for (l = 0; l < size; l++) {
+			if (fabsf(float_image_row(kernel, k)[l]) > largest) {
+				largest = fabsf(float_image_row(kernel, k)[l]);
+				p = k;
+				q = l;
+			}
+		}
+	}
+	
+	for (k = 0; k < size; k++) {
+		column[k] = float_image_row(kernel, k)[q];
+		row[k] = (largest == 0.0f) ? 0.0f : float_image_row(kernel, p)[k] / float_image_row(kernel, p)[q];
+	}
+	
+	for (k = 0; k < size; k++) {
+		for (l = 0; l < size; l++) {
+			difference = fabsf(float_image_row(kernel, k)[l] - column[k] * row[l]);
+			if (!(difference <= FLOAT_SEPARABLE_TOLERANCE * largest)) {
+				return 0;
+			}
+		}
+	}
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Convolves a line with a one dimensional kernel, the line
+ * 		  wrapping around its ends : the pixel j is the sum of the
+ * 		  pixels j + size/2 - l times taps[l]. The engine computes
+ * 		  the line as a row convolved with a kernel of a single row
+ * 		  where the kernel does not wrap around the line, the ends
+ * 		  are computed pixel by pixel
+ * 
+ * @param engine The engine
+ * 		  line The line
+ * 		  taps The values of the kernel
+ * 		  size The size of the kernel, odd
+ * 		  width The width of the line
+ * 		  convolvedLine The convolved line
+ */
+void convolve_line(const convolution_engine* engine, const Pixel* line, const Pixel* taps, int size, int width, Pixel* convolvedLine) {
+	
+	int half = size / 2;
+	int j;
+	
+	if (width - half > half) {
+		engine->row(&line, taps, 1, size, half, width - half, convolvedLine);
+	}
+	
+	for (j = 0; j < half && j < width; j++) {
+		convolvedLine[j] = convolution_pixel(&line, taps, 1, size, width, j);
+	}
+	for (j = (width - half > half) ? width - half : half; j < width; j++) {
+		convolvedLine[j] = convolution_pixel(&line, taps, 1, size, width, j);
+	}
+	
+}
+
+/**
+ * @brief Convolves a single precision line with a one dimensional
+ * 		  kernel, see convolve_line
+ * 
+ * @param engine The engine
+ * 		  line The line
+ * 		  taps The values of the kernel
+ * 		  size The size of the kernel, odd
+ * 		  width The width of the line
+ * 		  convolvedLine The convolved line
+ */
+void float_convolve_line(const convolution_engine* engine, const FloatPixel* line, const FloatPixel* taps, int size, int width, FloatPixel* convolvedLine) {
+	
+	int half = size / 2;
+	int j;
+	
+	if (width - half > half) {
+		engine->float_row(&line, taps, 1, size, half, width - half, convolvedLine);
+	}
+	
+	for (j = 0; j < half && j < width; j++) {
+		convolvedLine[j] = float_convolution_pixel(&line, taps, 1, size, width, j);
+	}
+	for (j = (width - half > half) ? width - half : half; j < width; j++) {
+		convolvedLine[j] = float_convolution_pixel(&line, taps, 1, size, width, j);
+	}
+	
+}
+
+/**
+ * @brief Writes in convolvedImg the image convolved with the
+ * 		  separable kernel whose value (k, l) is column[k] * row[l],
+ * 		  see convolve, in two passes of size taps per pixel instead
+ * 		  of size * size : each row of the image is convolved with
+ * 		  row, then each column of the result with column. The rows
+ * 		  of the first pass are kept in a buffer of size rows, where
+ * 		  the row x of the image, before wrapping, goes to the line
+ * 		  x modulo size. Returns 0, or 1 if one of the images does
+ * 		  not fit or the buffer could not be allocated
+ * 
+ * @param engine The engine, NULL for the fastest one of the processor
+ * 		  img The image
+ * 		  column The column of the kernel
+ * 		  row The row of the kernel
+ * 		  size The size of the kernel, odd
+ * 		  convolvedImg The convolved image
+ */
+int convolve_separable(const convolution_engine* engine, const Image* img, const Pixel* column, const Pixel* row, int size, Image* convolvedImg) {
+	
+	const Pixel* rows[CONVOLUTION_MAX_SIZE];
+	int lines[CONVOLUTION_MAX_SIZE];
+	Image buffer;
+	int half = size / 2;
+	int line;
+	int i;
+	int k;
+	int x;
+	
+	if (check_convolution(img->height, img->width, size, size, convolvedImg->height, convolvedImg->width, images_overlap(img, convolvedImg)) != 0) {
+		return 1;
+	}
+	if (engine == NULL) {
+		engine = best_convolution_engine();
+	}
+	if (create_image(&buffer, size, img->width) != 0) {
+		return 1;
+	}
+	
+	/* No row of the image is in the buffer yet, the rows before wrapping start at -size/2 */
+	
+	for (k = 0; k < size; k++) {
+		lines[k] = -size;
+	}
+	
+	for (i = 0; i < img->height; i++) {
+		
+		/* The row k of the kernel meets the row i + size/2 - k of the image, only the newest one is usually not in the buffer */
+		
+		for (k = 0; k < size; k++) {
+			x = i + half - k;
+			line = wrap_index(x, size);
+			if (lines[line] != x) {
+				convolve_line(engine, image_row(img, wrap_index(x, img->height)), row, size, img->width, image_row(&buffer, line));
+				lines[line] = x;
+			}
+			rows[k] = image_row(&buffer, line);
+		}
+		
+		/* The second pass convolves the rows of the buffer with a kernel of a single column, which never wraps around them */
+		
+		engine->row(rows, column, size, 1, 0, img->width, image_row(convolvedImg, i));
+		
+	}
+	
+	destroy_image(&buffer);
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Writes in convolvedImg the single precision image convolved
+ * 		  with a separable kernel, see convolve_separable
+ * 
+ * @param engine The engine, NULL for the fastest one of the processor
+ * 		  img The image
+ * 		  column The column of the kernel
+ * 		  row The row of the kernel
+ * 		  size The size of the kernel, odd
+ * 		  convolvedImg The convolved image
+ */
+int convolve_separable_float(const convolution_engine* engine, const FloatImage* img, const FloatPixel* column, const FloatPixel* row, int size, FloatImage* convolvedImg) {
+	
+	const FloatPixel* rows[CONVOLUTION_MAX_SIZE];
+	int lines[CONVOLUTION_MAX_SIZE];
+	FloatImage buffer;
+	int half = size / 2;
+	int line;
+	int i;
+	int k;
+	int x;
+	
+	if (check_convolution(img->height, img->width, size, size, convolvedImg->height, convolvedImg->width, float_images_overlap(img, convolvedImg)) != 0) {
+		return 1;
+	}
+	if (engine == NULL) {
+		engine = best_convolution_engine();
+	}
+	if (create_float_image(&buffer, size, img->width) != 0) {
+		return 1;
+	}
+	
+	for (k = 0; k < size; k++) {
+		lines[k] = -size;
+	}
+	
+	for (i = 0; i < img->height; i++) {
+		for (k = 0; k < size; k++) {
+			x = i + half - k;
+			line = wrap_index(x, size);
+			if (lines[line] != x) {
+				float_convolve_line(engine, float_image_row(img, wrap_index(x, img->height)), row, size, img->width, float_image_row(&buffer, line));
+				lines[line] = x;
+			}
+			rows[k] = float_image_row(&buffer, line);
+		}
+		
+		engine->float_row(rows, column, size, 1, 0, img->width, float_image_row(convolvedImg, i));
+	}
+	
+	destroy_float_image(&buffer);
+	
+	return 0;
+	
+}
+/**
+ * @brief Writes in filteredImg the image filtered with the given
+ * 		  mask, with the fastest engine of the processor, see
+ * 		  convolve. A separable mask of size at least
+ * 		  SEPARABLE_MIN_SIZE is applied in two passes, see
+ * 		  convolve_separable. filteredImg must have the height and
+ * 		  the width of the image and must not share pixels with it,
+ * 		  since every pixel is computed from its neighbours. Returns
+ * 		  0, or 1 if one of the images does not fit
+ * 
+ * @param img The image
+ * 		  mask The mask, square and of odd size
+ * 		  filteredImg The filtered image
+ */
+int filter(const Image* img, const Image* mask, Image* filteredImg) {
+	
+	Pixel column[CONVOLUTION_MAX_SIZE];
+	Pixel row[CONVOLUTION_MAX_SIZE];
+	
+	if (mask->height >= SEPARABLE_MIN_SIZE && separate_kernel(mask, column, row)) {
+		return convolve_separable(NULL, img, column, row, mask->height, filteredImg);
+	}
+	
+	return convolve(NULL, img, mask, filteredImg);
+	
+}
+
+/**
+ * @brief Writes in filteredImg the single precision image filtered
+ * 		  with the given mask, see filter
+ * 
+ * @param img The image
+ * 		  mask The mask, square and of odd size
+ * 		  filteredImg The filtered image
+ */
+int filter_float(const FloatImage* img, const FloatImage* mask, FloatImage* filteredImg) {
+	
+	FloatPixel column[CONVOLUTION_MAX_SIZE];
+	FloatPixel row[CONVOLUTION_MAX_SIZE];
+	
+	if (mask->height >= SEPARABLE_MIN_SIZE && float_separate_kernel(mask, column, row)) {
+		return convolve_separable_float(NULL, img, column, row, mask->height, filteredImg);
 	}
 	
-	return filteredImg;
+	return convolve_float(NULL, img, mask, filteredImg);
 	
 }
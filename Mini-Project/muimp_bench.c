@@ -0,0 +1,765 @@
+/* ======================================================================
+ * Benchmarks for muimp.c
+ * 
+ * Compile with : gcc -std=c99 -O2 -o muimp_bench muimp_bench.c
+ * Usage        : ./muimp_bench pipeline [stages] [repetitions] [size]
+ *                ./muimp_bench filter [size] [repetitions]
+ *                ./muimp_bench kernels [size] [repetitions]
+ *                ./muimp_bench separable [size] [repetitions]
+ * 
+ * The pipeline draws a diamond then filters it again and again, with the
+ * former fixed-size images passed and returned by value and with the
+ * images passed by pointer. Both run the same computations, so the
+ * difference is the cost of the copies, and both must give the same
+ * checksum.
+ *
+ * The filter is compared with the former one, which tested how to wrap
+ * around the borders on every tap, on an image of random pixels. Both
+ * must give exactly the same pixels.
+ *
+ * The kernels bench gives the throughput of every convolution engine the
+ * processor supports, for kernels of size 3 to 15, in double and single
+ * precision. Every engine must give the pixels of the scalar one.
+ *
+ * The separable bench compares, for random separable kernels of size 3 to
+ * 31, the convolution in two dimensions with the two passes. The sums are
+ * not done in the same order, the largest difference between the two
+ * images is printed relative to the largest pixel.
+ * ======================================================================
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+
+/* muimp.c is compiled in directly, its main() is renamed out of the way */
+
+#define main muimp_main
+#include "muimp.c"
+#undef main
+
+/* ======================================================================
+ * Reference: the former fixed-size images passed by value
+ * ======================================================================
+ */
+
+#define FIXED_IMAGE_HEIGHT 100
+#define FIXED_IMAGE_WIDTH 100
+
+typedef struct {
+	Pixel pixelTab[FIXED_IMAGE_HEIGHT][FIXED_IMAGE_WIDTH];
+	int height;
+	int width;
+} fixed_Image;
+
+/**
+ * @brief Returns an image sharing the pixels of a fixed-size image,
+ * 		  so that the functions of muimp.c work on it
+ * 
+ * @param img The fixed-size image
+ */
+Image fixed_view(fixed_Image* img) {
+	
+	Image view = { &img->pixelTab[0][0], img->height, img->width, FIXED_IMAGE_WIDTH, NULL };
+	return view;
+	
+}
+
+/* The former calling convention around the current computations, so that only the copies differ */
+
+fixed_Image fixed_diamond(fixed_Image img, int diag) {
+	
+	Image view;
+	
+	img.height |= 1;
+	img.width |= 1;
+	view = fixed_view(&img);
+	diamond(&view, diag);
+	
+	return img;
+	
+}
+
+fixed_Image fixed_filter(fixed_Image img, fixed_Image mask) {
+	
+	fixed_Image filteredImg;
+	Image imgView;
+	Image maskView;
+	Image filteredView;
+	
+	mask.height = 3;
+	mask.width = 3;
+	maskView = fixed_view(&mask);
+	build_mask(&maskView);
+	
+	filteredImg.height = img.height;
+	filteredImg.width = img.width;
+	imgView = fixed_view(&img);
+	filteredView = fixed_view(&filteredImg);
+	filter(&imgView, &maskView, &filteredView);
+	
+	return filteredImg;
+	
+}
+
+/* ======================================================================
+ * Reference: the former filter with four branches and % on every tap
+ * ======================================================================
+ */
+
+int branchy_filter(const Image* img, const Image* mask, Image* filteredImg) {
+	
+	int i;
+	int j;
+	int k;
+	int l;
+	
+	clear_image(filteredImg);
+	
+	for (i = 0; i < img->height; i++) {
+		for (j = 0; j < img->width; j++) {
+			for (k = 0; k < mask->height; k++) {
+				for (l = 0; l < mask->width; l++) {
+					if ((i + (3/2) - k) < 0 && (j + (3/2) - l) >= 0) {
+						image_row(filteredImg, i)[j] += image_row(img, (i + (3/2) - k + img->height)%img->height)[(j + (3/2) - l)%img->width] * image_row(mask, k)[l];
+					} else if ((i + (3/2) - k) >= 0 && (j + (3/2) - l) < 0) {
+						image_row(filteredImg, i)[j] += image_row(img, (i + (3/2) - k)%img->height)[(j + (3/2) - l + img->width)%img->width] * image_row(mask, k)[l];
+					} else if ((i + (3/2) - k) < 0 && (j + (3/2) - l) < 0) {
+						image_row(filteredImg, i)[j] += image_row(img, (i + (3/2) - k + img->height)%img->height)[(j + (3/2) - l + img->width)%img->width] * image_row(mask, k)[l];
+					} else {
+						image_row(filteredImg, i)[j] += image_row(img, (i + (3/2) - k)%img->height)[(j + (3/2) - l)%img->width] * image_row(mask, k)[l];
+					}
+				}
+			}
+		}
+	}
+	
+	return 0;
+	
+}
+
+/* ======================================================================
+ * Benchmarks
+ * ======================================================================
+ */
+
+/**
+ * @brief Returns the current time in seconds
+ */
+double now(void) {
+	
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+	
+}
+
+/**
+ * @brief Returns the sum of the pixels of the image, weighted by
+ * 		  their position so that a misplaced pixel changes it
+ * 
+ * @param img The image
+ */
+double image_checksum(const Image* img) {
+	
+	double sum = 0.0;
+	int i;
+	int j;
+	
+	for (i = 0; i < img->height; i++) {
+		for (j = 0; j < img->width; j++) {
+			sum += image_row(img, i)[j] * (1.0 + ((i * 31 + j) % 97));
+		}
+	}
+	
+	return sum;
+	
+}
+
+/**
+ * @brief Runs the pipeline of the former API : a diamond then
+ * 		  stages filters, each image passed and returned by value.
+ * 		  Returns the checksum of the last image
+ * 
+ * @param size The height and the width, odd and smaller than 100
+ * 		  stages The number of filters
+ * 		  repetitions The number of times the pipeline is run
+ */
+double run_fixed_pipeline(int size, int stages, int repetitions) {
+	
+	static fixed_Image img;
+	static fixed_Image mask;
+	double sum = 0.0;
+	int r;
+	int s;
+	int i;
+	int j;
+	
+	for (r = 0; r < repetitions; r++) {
+		img.height = size;
+		img.width = size;
+		img = fixed_diamond(img, size / 2);
+		for (s = 0; s < stages; s++) {
+			img = fixed_filter(img, mask);
+		}
+	}
+	
+	for (i = 0; i < img.height; i++) {
+		for (j = 0; j < img.width; j++) {
+			sum += img.pixelTab[i][j] * (1.0 + ((i * 31 + j) % 97));
+		}
+	}
+	
+	return sum;
+	
+}
+
+/**
+ * @brief Runs the same pipeline with the images passed by pointer :
+ * 		  the diamond is drawn in place and the filters go back and
+ * 		  forth between two images. Returns the checksum of the last
+ * 		  image
+ * 
+ * @param size The height and the width, odd
+ * 		  stages The number of filters
+ * 		  repetitions The number of times the pipeline is run
+ */
+double run_pointer_pipeline(int size, int stages, int repetitions) {
+	
+	Image images[2];
+	Image mask;
+	double sum = 0.0;
+	int current = 0;
+	int r;
+	int s;
+	
+	if (create_image(&images[0], size, size) != 0 || create_image(&images[1], size, size) != 0 || create_image(&mask, 3, 3) != 0) {
+		return -1.0;
+	}
+	build_mask(&mask);
+	
+	for (r = 0; r < repetitions; r++) {
+		current = 0;
+		diamond(&images[current], size / 2);
+		for (s = 0; s < stages; s++) {
+			filter(&images[current], &mask, &images[1 - current]);
+			current = 1 - current;
+		}
+	}
+	
+	sum = image_checksum(&images[current]);
+	
+	destroy_image(&mask);
+	destroy_image(&images[1]);
+	destroy_image(&images[0]);
+	
+	return sum;
+	
+}
+
+/**
+ * @brief Compares the time per stage of the pipeline with the images
+ * 		  passed by value and by pointer, and the number of pixel
+ * 		  bytes moved between the stages by the calls themselves
+ * 
+ * @param stages The number of filters
+ * 		  repetitions The number of times the pipeline is run
+ * 		  size The height and the width, odd and smaller than 100
+ */
+int bench_pipeline(int stages, int repetitions, int size) {
+	
+	double start = 0.0;
+	double fixed_time = 0.0;
+	double pointer_time = 0.0;
+	double fixed_sum = 0.0;
+	double pointer_sum = 0.0;
+	double nb_stages = (double) repetitions * (stages + 1);
+	
+	start = now();
+	fixed_sum = run_fixed_pipeline(size, stages, repetitions);
+	fixed_time = now() - start;
+	
+	start = now();
+	pointer_sum = run_pointer_pipeline(size, stages, repetitions);
+	pointer_time = now() - start;
+	
+	/* A diamond copies the image in and out, a filter copies the image and the mask in and the result out */
+	
+	printf("api        size  stages  pixel bytes/stage  us/stage      checksum\n");
+	printf("by value  %5d  %6d  %17.0f  %8.2f  %12.6g\n", size, stages, (2.0 + 3.0 * stages) * sizeof(fixed_Image) / (stages + 1), fixed_time / nb_stages * 1e6, fixed_sum);
+	printf("pointer   %5d  %6d  %17d  %8.2f  %12.6g\n", size, stages, 0, pointer_time / nb_stages * 1e6, pointer_sum);
+	printf("\nspeedup : %.2fx\n", fixed_time / pointer_time);
+	
+	if (fixed_sum != pointer_sum) {
+		fprintf(stderr, "Les deux pipelines ne donnent pas la même image\n");
+		return 1;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Fills the image with pseudo-random pixels between -1.0
+ * 		  and 1.0, always the same ones for a given seed
+ * 
+ * @param img The image
+ * 		  seed The seed
+ */
+void random_image(Image* img, uint64_t seed) {
+	
+	int i;
+	int j;
+	
+	for (i = 0; i < img->height; i++) {
+		for (j = 0; j < img->width; j++) {
+			seed = seed * 6364136223846793005u + 1442695040888963407u;
+			image_row(img, i)[j] = (double) (seed >> 11) / (double) (1ull << 52) - 1.0;
+		}
+	}
+	
+}
+
+/**
+ * @brief Returns 1 if the two images have exactly the same pixels,
+ * 		  bit for bit, and 0 otherwise
+ * 
+ * @param img1 The first image
+ * 		  img2 The second image
+ */
+int same_pixels(const Image* img1, const Image* img2) {
+	
+	int i;
+	
+	if (img1->height != img2->height || img1->width != img2->width) return 0;
+	
+	for (i = 0; i < img1->height; i++) {
+		if (memcmp(image_row(img1, i), image_row(img2, i), img1->width * sizeof(Pixel)) != 0) return 0;
+	}
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Compares the throughput of the convolution in two dimensions
+ * 		  with the former filter on a square image of random pixels,
+ * 		  and checks that both give exactly the same pixels
+ * 
+ * @param size The height and the width
+ * 		  repetitions The number of times each filter is run
+ */
+int bench_filter(int size, int repetitions) {
+	
+	Image img;
+	Image mask;
+	Image former;
+	Image filtered;
+	double start = 0.0;
+	double former_time = 0.0;
+	double filter_time = 0.0;
+	double megapixels = (double) size * size * repetitions * 1e-6;
+	int r;
+	int same = 0;
+	
+	if (create_image(&img, size, size) != 0 || create_image(&mask, 3, 3) != 0 || create_image(&former, size, size) != 0 || create_image(&filtered, size, size) != 0) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour le benchmark\n");
+		return 3;
+	}
+	random_image(&img, 42);
+	build_mask(&mask);
+	
+	/* A first run of each filter is not timed, it touches the pages of the filtered images */
+	
+	branchy_filter(&img, &mask, &former);
+	convolve(NULL, &img, &mask, &filtered);
+	
+	start = now();
+	for (r = 0; r < repetitions; r++) branchy_filter(&img, &mask, &former);
+	former_time = now() - start;
+	
+	start = now();
+	for (r = 0; r < repetitions; r++) convolve(NULL, &img, &mask, &filtered);
+	filter_time = now() - start;
+	
+	same = same_pixels(&former, &filtered);
+	
+	printf("filter      size   ms/image      MP/s\n");
+	printf("former    %6d  %9.2f  %8.2f\n", size, former_time / repetitions * 1e3, megapixels / former_time);
+	printf("convolve  %6d  %9.2f  %8.2f\n", size, filter_time / repetitions * 1e3, megapixels / filter_time);
+	printf("\nspeedup : %.2fx\n", former_time / filter_time);
+	
+	destroy_image(&filtered);
+	destroy_image(&former);
+	destroy_image(&mask);
+	destroy_image(&img);
+	
+	if (!same) {
+		fprintf(stderr, "Les deux filtres ne donnent pas la même image\n");
+		return 1;
+	}
+	
+	return 0;
+	
+}
+
+/**
+ * @brief Fills the single precision image with pseudo-random pixels
+ * 		  between -1.0 and 1.0, see random_image
+ * 
+ * @param img The image
+ * 		  seed The seed
+ */
+void random_float_image(FloatImage* img, uint64_t seed) {
+	
+	int i;
+	int j;
+	
+	for (i = 0; i < img->height; i++) {
+		for (j = 0; j < img->width; j++) {
+			seed = seed * 6364136223846793005u + 1442695040888963407u;
+			float_image_row(img, i)[j] = (float) ((double) (seed >> 11) / (double) (1ull << 52) - 1.0);
+		}
+	}
+	
+}
+
+/**
+ * @brief Returns 1 if the two single precision images have exactly the
+ * 		  same pixels, bit for bit, and 0 otherwise
+ * 
+ * @param img1 The first image
+ * 		  img2 The second image
+ */
+int same_float_pixels(const FloatImage* img1, const FloatImage* img2) {
+	
+	int i;
+	
+	if (img1->height != img2->height || img1->width != img2->width) return 0;
+	
+	for (i = 0; i < img1->height; i++) {
+		if (memcmp(float_image_row(img1, i), float_image_row(img2, i), img1->width * sizeof(FloatPixel)) != 0) return 0;
+	}
+	
+	return 1;
+	
+}
+
+/**
+ * @brief Gives the throughput of every convolution engine supported by
+ * 		  the processor for the kernels of size 3 to 15, on a square
+ * 		  image of random pixels, in double and in single precision,
+ * 		  and checks that every engine gives the pixels of the scalar
+ * 		  one
+ * 
+ * @param size The height and the width
+ * 		  repetitions The number of times each convolution is run
+ */
+int bench_kernels(int size, int repetitions) {
+	
+	static const int kernel_sizes[] = { 3, 5, 7, 9, 11, 15 };
+	Image img;
+	Image kernel;
+	Image reference;
+	Image convolved;
+	FloatImage float_img;
+	FloatImage float_kernel;
+	FloatImage float_reference;
+	FloatImage float_convolved;
+	const convolution_engine* engine;
+	double start = 0.0;
+	double double_time = 0.0;
+	double float_time = 0.0;
+	double megapixels = (double) size * size * repetitions * 1e-6;
+	int errors = 0;
+	int e;
+	int s;
+	int r;
+	int k;
+	int l;
+	
+	if (create_image(&img, size, size) != 0 || create_image(&reference, size, size) != 0 || create_image(&convolved, size, size) != 0 || create_float_image(&float_img, size, size) != 0 || create_float_image(&float_reference, size, size) != 0 || create_float_image(&float_convolved, size, size) != 0) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour le benchmark\n");
+		return 3;
+	}
+	random_image(&img, 42);
+	random_float_image(&float_img, 42);
+	
+	printf("engine  kernel  double (MP/s)  float (MP/s)\n");
+	
+	for (s = 0; s < (int) (sizeof(kernel_sizes) / sizeof(kernel_sizes[0])); s++) {
+		
+		if (create_image(&kernel, kernel_sizes[s], kernel_sizes[s]) != 0 || create_float_image(&float_kernel, kernel_sizes[s], kernel_sizes[s]) != 0) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour le benchmark\n");
+			return 3;
+		}
+		random_image(&kernel, 7 + s);
+		for (k = 0; k < kernel.height; k++) {
+			for (l = 0; l < kernel.width; l++) {
+				float_image_row(&float_kernel, k)[l] = (float) image_row(&kernel, k)[l];
+			}
+		}
+		
+		/* The scalar engine gives the reference pixels, it also touches the pages of the convolved images */
+		
+		convolve(&convolution_engines[0], &img, &kernel, &reference);
+		convolve_float(&convolution_engines[0], &float_img, &float_kernel, &float_reference);
+		
+		for (e = 0; e < NB_CONVOLUTION_ENGINES; e++) {
+			engine = &convolution_engines[e];
+			if (!engine->supported()) continue;
+			
+			start = now();
+			for (r = 0; r < repetitions; r++) convolve(engine, &img, &kernel, &convolved);
+			double_time = now() - start;
+			
+			start = now();
+			for (r = 0; r < repetitions; r++) convolve_float(engine, &float_img, &float_kernel, &float_convolved);
+			float_time = now() - start;
+			
+			printf("%-6s  %6d  %13.2f  %12.2f\n", engine->name, kernel_sizes[s], megapixels / double_time, megapixels / float_time);
+			
+			if (!same_pixels(&reference, &convolved) || !same_float_pixels(&float_reference, &float_convolved)) {
+				fprintf(stderr, "Le moteur %s ne donne pas les pixels du moteur scalar pour un masque de taille %d\n", engine->name, kernel_sizes[s]);
+				errors++;
+			}
+		}
+		
+		destroy_float_image(&float_kernel);
+		destroy_image(&kernel);
+		
+	}
+	
+	destroy_float_image(&float_convolved);
+	destroy_float_image(&float_reference);
+	destroy_float_image(&float_img);
+	destroy_image(&convolved);
+	destroy_image(&reference);
+	destroy_image(&img);
+	
+	return errors != 0;
+	
+}
+
+/**
+ * @brief Returns the largest difference between two pixels at the same
+ * 		  place of the images, divided by the largest pixel of the
+ * 		  first image
+ * 
+ * @param img1 The first image
+ * 		  img2 The second image
+ */
+double relative_difference(const Image* img1, const Image* img2) {
+	
+	double largest = 0.0;
+	double difference = 0.0;
+	int i;
+	int j;
+	
+	for (i = 0; i < img1->height; i++) {
+		for (j = 0; j < img1->width; j++) {
+			if (fabs(image_row(img1, i)[j]) > largest) largest = fabs(image_row(img1, i)[j]);
+			if (fabs(image_row(img1, i)[j] - image_row(img2, i)[j]) > difference) difference = fabs(image_row(img1, i)[j] - image_row(img2, i)[j]);
+		}
+	}
+	
+	return (largest == 0.0) ? difference : difference / largest;
+	
+}
+
+/**
+ * @brief Returns the largest difference between two pixels at the same
+ * 		  place of the single precision images, see relative_difference
+ * 
+ * @param img1 The first image
+ * 		  img2 The second image
+ */
+double float_relative_difference(const FloatImage* img1, const FloatImage* img2) {
+	
+	double largest = 0.0;
+	double difference = 0.0;
+	int i;
+	int j;
+	
+	for (i = 0; i < img1->height; i++) {
+		for (j = 0; j < img1->width; j++) {
+			if (fabs(float_image_row(img1, i)[j]) > largest) largest = fabs(float_image_row(img1, i)[j]);
+			if (fabs((double) float_image_row(img1, i)[j] - float_image_row(img2, i)[j]) > difference) difference = fabs((double) float_image_row(img1, i)[j] - float_image_row(img2, i)[j]);
+		}
+	}
+	
+	return (largest == 0.0) ? difference : difference / largest;
+	
+}
+
+/**
+ * @brief Compares, for random separable kernels of size 3 to 31, the
+ * 		  throughput of the convolution in two dimensions and of the
+ * 		  two passes of the separable one, with the fastest engine, in
+ * 		  double and in single precision. Checks that the kernels are
+ * 		  found separable and that both give the same pixels, up to
+ * 		  the rounding
+ * 
+ * @param size The height and the width
+ * 		  repetitions The number of times each convolution is run
+ */
+int bench_separable(int size, int repetitions) {
+	
+	static const int kernel_sizes[] = { 3, 5, 7, 9, 11, 15, 31 };
+	Pixel column[CONVOLUTION_MAX_SIZE];
+	Pixel row[CONVOLUTION_MAX_SIZE];
+	FloatPixel float_column[CONVOLUTION_MAX_SIZE];
+	FloatPixel float_row[CONVOLUTION_MAX_SIZE];
+	Image img;
+	Image vectors;
+	Image kernel;
+	Image reference;
+	Image convolved;
+	FloatImage float_img;
+	FloatImage float_kernel;
+	FloatImage float_reference;
+	FloatImage float_convolved;
+	double start = 0.0;
+	double full_time = 0.0;
+	double separable_time = 0.0;
+	double float_full_time = 0.0;
+	double float_separable_time = 0.0;
+	double difference = 0.0;
+	double float_difference = 0.0;
+	double megapixels = (double) size * size * repetitions * 1e-6;
+	int errors = 0;
+	int s;
+	int r;
+	int k;
+	int l;
+	
+	if (create_image(&img, size, size) != 0 || create_image(&reference, size, size) != 0 || create_image(&convolved, size, size) != 0 || create_float_image(&float_img, size, size) != 0 || create_float_image(&float_reference, size, size) != 0 || create_float_image(&float_convolved, size, size) != 0) {
+		fprintf(stderr, "Erreur dans l'allocation de mémoire pour le benchmark\n");
+		return 3;
+	}
+	random_image(&img, 42);
+	random_float_image(&float_img, 42);
+	
+	printf("engine %s\n", best_convolution_engine()->name);
+	printf("kernel  2d double  sep double  speedup   difference  2d float  sep float  speedup   difference   (MP/s)\n");
+	
+	for (s = 0; s < (int) (sizeof(kernel_sizes) / sizeof(kernel_sizes[0])); s++) {
+		
+		/* The kernel is the outer product of a random column and a random row */
+		
+		if (create_image(&vectors, 2, kernel_sizes[s]) != 0 || create_image(&kernel, kernel_sizes[s], kernel_sizes[s]) != 0 || create_float_image(&float_kernel, kernel_sizes[s], kernel_sizes[s]) != 0) {
+			fprintf(stderr, "Erreur dans l'allocation de mémoire pour le benchmark\n");
+			return 3;
+		}
+		random_image(&vectors, 7 + s);
+		for (k = 0; k < kernel.height; k++) {
+			for (l = 0; l < kernel.width; l++) {
+				image_row(&kernel, k)[l] = image_row(&vectors, 0)[k] * image_row(&vectors, 1)[l];
+				float_image_row(&float_kernel, k)[l] = (float) image_row(&vectors, 0)[k] * (float) image_row(&vectors, 1)[l];
+			}
+		}
+		destroy_image(&vectors);
+		
+		if (!separate_kernel(&kernel, column, row) || !float_separate_kernel(&float_kernel, float_column, float_row)) {
+			fprintf(stderr, "Le masque de taille %d n'est pas reconnu comme séparable\n", kernel_sizes[s]);
+			errors++;
+			destroy_float_image(&float_kernel);
+			destroy_image(&kernel);
+			continue;
+		}
+		
+		/* A first run of each convolution is not timed, it touches the pages of the convolved images */
+		
+		convolve(NULL, &img, &kernel, &reference);
+		convolve_separable(NULL, &img, column, row, kernel.height, &convolved);
+		convolve_float(NULL, &float_img, &float_kernel, &float_reference);
+		convolve_separable_float(NULL, &float_img, float_column, float_row, kernel.height, &float_convolved);
+		
+		start = now();
+		for (r = 0; r < repetitions; r++) convolve(NULL, &img, &kernel, &reference);
+		full_time = now() - start;
+		
+		start = now();
+		for (r = 0; r < repetitions; r++) convolve_separable(NULL, &img, column, row, kernel.height, &convolved);
+		separable_time = now() - start;
+		
+		start = now();
+		for (r = 0; r < repetitions; r++) convolve_float(NULL, &float_img, &float_kernel, &float_reference);
+		float_full_time = now() - start;
+		
+		start = now();
+		for (r = 0; r < repetitions; r++) convolve_separable_float(NULL, &float_img, float_column, float_row, kernel.height, &float_convolved);
+		float_separable_time = now() - start;
+		
+		difference = relative_difference(&reference, &convolved);
+		float_difference = float_relative_difference(&float_reference, &float_convolved);
+		
+		printf("%6d  %9.2f  %10.2f  %6.2fx  %11.2e  %8.2f  %9.2f  %6.2fx  %11.2e\n", kernel.height, megapixels / full_time, megapixels / separable_time, full_time / separable_time, difference, megapixels / float_full_time, megapixels / float_separable_time, float_full_time / float_separable_time, float_difference);
+		
+		if (difference > 1e-12 || float_difference > 1e-4) {
+			fprintf(stderr, "Les deux convolutions ne donnent pas la même image pour un masque de taille %d\n", kernel.height);
+			errors++;
+		}
+		
+		destroy_float_image(&float_kernel);
+		destroy_image(&kernel);
+		
+	}
+	
+	destroy_float_image(&float_convolved);
+	destroy_float_image(&float_reference);
+	destroy_float_image(&float_img);
+	destroy_image(&convolved);
+	destroy_image(&reference);
+	destroy_image(&img);
+	
+	return errors != 0;
+	
+}
+
+int main(int argc, char* argv[]) {
+	
+	int stages = 20;
+	int repetitions = 200;
+	int size = 99;
+	
+	if (argc >= 2 && strcmp(argv[1], "pipeline") == 0) {
+		if (argc >= 3) stages = atoi(argv[2]);
+		if (argc >= 4) repetitions = atoi(argv[3]);
+		if (argc >= 5) size = atoi(argv[4]) | 1;
+		if (stages >= 0 && repetitions > 0 && size > 0 && size < FIXED_IMAGE_HEIGHT) {
+			return bench_pipeline(stages, repetitions, size);
+		}
+	}
+	
+	if (argc >= 2 && strcmp(argv[1], "filter") == 0) {
+		size = (argc >= 3) ? atoi(argv[2]) : 2000;
+		repetitions = (argc >= 4) ? atoi(argv[3]) : 5;
+		if (size > 0 && repetitions > 0) {
+			return bench_filter(size, repetitions);
+		}
+	}
+	
+	if (argc >= 2 && strcmp(argv[1], "kernels") == 0) {
+		size = (argc >= 3) ? atoi(argv[2]) : 1000;
+		repetitions = (argc >= 4) ? atoi(argv[3]) : 3;
+		if (size > 0 && repetitions > 0) {
+			return bench_kernels(size, repetitions);
+		}
+	}
+	
+	if (argc >= 2 && strcmp(argv[1], "separable") == 0) {
+		size = (argc >= 3) ? atoi(argv[2]) : 1000;
+		repetitions = (argc >= 4) ? atoi(argv[3]) : 3;
+		if (size > 0 && repetitions > 0) {
+			return bench_separable(size, repetitions);
+		}
+	}
+	
+	fprintf(stderr, "Usage : %s pipeline [étapes] [répétitions] [taille impaire < %d]\n", argv[0], FIXED_IMAGE_HEIGHT);
+	fprintf(stderr, "        %s filter [taille] [répétitions]\n", argv[0]);
+	fprintf(stderr, "        %s kernels [taille] [répétitions]\n", argv[0]);
+	fprintf(stderr, "        %s separable [taille] [répétitions]\n", argv[0]);
+	return EXIT_FAILURE;
+	
+}